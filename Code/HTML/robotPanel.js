@@ -3,6 +3,7 @@
 export class RobotAdminPanel {
   constructor() {
     this.STATUS_POLL_MS = 9000;
+    this.GCODE_LINE_MS = 120;
     this.statusPollHandle = null;
 
     this.systemState = {
@@ -162,13 +163,25 @@ export class RobotAdminPanel {
   </params>
 </methodCall>`;
 
+    // Ante un 429 el servidor indica en Retry-After cuántos segundos
+    // esperar; se reintenta en vez de dar la orden por fallida
+    const maxReintentos = options.retries ?? 3;
+
     try {
       if (!silent) this.logLine(`📤 Enviando: ${method}`);
-      const response = await fetch(`http://${serverIp}:8080`, {
-        method: 'POST',
-        headers: { 'Content-Type': 'text/xml' },
-        body: xmlBody
-      });
+      let response;
+      for (let intento = 0; ; intento++) {
+        response = await fetch(`http://${serverIp}:8080`, {
+          method: 'POST',
+          headers: { 'Content-Type': 'text/xml' },
+          body: xmlBody
+        });
+        if (response.status !== 429 || intento >= maxReintentos) break;
+        const segundos = parseInt(response.headers.get('Retry-After'), 10);
+        const esperaMs = (Number.isFinite(segundos) && segundos > 0 ? segundos : 1) * 1000;
+        if (!silent) this.logLine(`⏳ ${method}: servidor ocupado, reintento en ${esperaMs / 1000} s`);
+        await new Promise(r => setTimeout(r, esperaMs));
+      }
 
       const responseText = await response.text();
 
@@ -381,7 +394,7 @@ export class RobotAdminPanel {
 
     try {
       this.logLine(`📤 Subiendo archivo: ${file.name} a ${serverIp}`);
-      const res = await fetch(`http://${serverIp}:8080/upload?name=${encodedName}`, {
+      const res = await fetch(`http://${serverIp}:8080/upload?name=${encodedName}&format=json&maxProblems=20`, {
         method: 'POST',
         headers: { 'Content-Type': 'text/csv' },
         body: file
@@ -394,8 +407,18 @@ export class RobotAdminPanel {
         return;
       }
 
+      let reporte = null;
+      try { reporte = JSON.parse(text); } catch (_) { /* servidor viejo: texto plano */ }
+      if (reporte && !reporte.valido) {
+        this.logLine(`⚠️ Validación: ${reporte.lineasConProblemas + reporte.erroresCsv} líneas con problemas de ${reporte.lineas}`);
+        for (const p of reporte.problemas) {
+          this.logLine(`   línea ${p.lineaCsv} (${p.tipo}): ${p.detalle}`);
+        }
+        if (reporte.truncado) this.logLine('   …');
+      }
+
       const base = file.name.replace(/\.[^/.]+$/, '');
-      const gcodePath = `jobs/${base}.gcode`;
+      const gcodePath = (reporte && reporte.gcode) || `jobs/${base}.gcode`;
       const item = document.createElement('div');
       item.textContent = gcodePath;
       item.onclick = () => this.selectFile(item);
@@ -415,7 +438,9 @@ export class RobotAdminPanel {
               this.logLine(`❌ Error al enviar línea: ${l}`);
               break;
             }
-            await new Promise(r => setTimeout(r, 50));
+            // El servidor admite 10 órdenes de movimiento por segundo por
+            // usuario; a este ritmo el envío no agota la ráfaga
+            await new Promise(r => setTimeout(r, this.GCODE_LINE_MS));
           }
           this.logLine(`✅ Ejecución del archivo ${gcodePath} finalizada`);
         } else {
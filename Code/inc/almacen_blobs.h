@@ -0,0 +1,61 @@
+#ifndef ALMACEN_BLOBS_H
+#define ALMACEN_BLOBS_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// Almacén direccionado por contenido: cada contenido distinto se guarda
+// una sola vez en blobs/<aa>/<hash> (hash = gcode::hashContenido) y los
+// nombres visibles (jobs/, uploads/, aprendizajes/, aprendizaje gcode/)
+// son enlaces duros a ese archivo. Subir dos veces lo mismo o exportar
+// una grabación a tres carpetas no ocupa disco de más, y el resto del
+// código sigue abriendo rutas como siempre. Los blobs quedan de sólo
+// lectura: nadie debe escribir sobre un nombre enlazado, se reemplaza
+// con tmp + rename. El conteo de enlaces del sistema de archivos hace de
+// contador de referencias (un blob con st_nlink == 1 ya no se usa).
+// Si dos contenidos distintos comparten hash se guardan como <hash>-1,
+// <hash>-2, ... (se compara byte a byte antes de deduplicar).
+
+struct EstadisticasBlobs {
+    uint64_t blobs = 0;
+    uint64_t bytes = 0;             // ocupado en disco por los blobs
+    uint64_t referencias = 0;       // nombres que apuntan a algún blob
+    uint64_t bytesLogicos = 0;      // lo que ocuparía sin deduplicar
+};
+
+class AlmacenBlobs {
+    mutable std::mutex mtx;
+    std::string directorio;
+
+public:
+    explicit AlmacenBlobs(std::string dir = "blobs");
+
+    // Publica `tmp` (ya escrito y cerrado) con el nombre `destino`. Si el
+    // contenido ya estaba, `tmp` se borra y `destino` pasa a ser otra
+    // referencia al mismo blob. `hash` es el del contenido de `tmp`.
+    bool publicar(const std::string& tmp, uint64_t hash, const std::string& destino);
+    bool publicar(const std::string& tmp, const std::string& destino);
+    // Convierte un archivo existente en referencia (lo mueve al almacén si
+    // su contenido es nuevo). `hash` opcional si ya se conoce.
+    bool ingerir(const std::string& ruta, const uint64_t* hash = nullptr);
+    // `destino` pasa a ser otra referencia al contenido de `origen`
+    bool enlazar(const std::string& origen, const std::string& destino, const uint64_t* hash = nullptr);
+
+    // Borra los blobs sin ninguna referencia; devuelve cuántos
+    uint64_t recolectar();
+    EstadisticasBlobs estadisticas() const;
+
+    static bool hashArchivo(const std::string& ruta, uint64_t& hash);
+
+private:
+    std::string rutaBlob(uint64_t hash, unsigned colision) const;
+    // Blob con ese contenido (lo crea moviendo `tmp` si no existe)
+    bool ubicarLocked(const std::string& tmp, uint64_t hash, std::string& blob, bool& nuevo);
+    static bool reemplazarConEnlace(const std::string& blob, const std::string& destino);
+};
+
+// Instancia global usable desde los distintos módulos
+extern AlmacenBlobs almacenBlobs;
+
+#endif // ALMACEN_BLOBS_H
@@ -0,0 +1,113 @@
+#ifndef ALMACEN_SESIONES_H
+#define ALMACEN_SESIONES_H
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Sesiones activas (token -> usuario y privilegio) con vencimiento.
+//
+// Tokens de 128 bits de getrandom() en hex (32 caracteres). La tabla está
+// repartida en kFragmentos por hash del token, cada uno con un shared_mutex:
+// resolver() toma sólo el lock compartido de un fragmento y devuelve
+// usuario y privilegio en una sola búsqueda; el último uso se actualiza
+// con un atómico, sin lock exclusivo.
+//
+// Vencen por inactividad (ttlInactivo) o por antigüedad (ttlAbsoluto). Una
+// rueda de tiempo de kRanuras x kTickMs la avanza un hilo una vez por tick:
+// cada sesión está en la ranura de su vencimiento más temprano posible;
+// al llegar se recalcula con el último uso y, si se usó mientras tanto, se
+// vuelve a colocar más adelante. Así tocar una sesión no mueve nada en la
+// rueda. resolver() igual rechaza una sesión vencida que la rueda todavía
+// no recorrió.
+
+struct SesionActiva {
+    std::string usuario;
+    std::string privilegio;
+};
+
+struct EstadisticasSesiones {
+    uint64_t activas = 0;
+    uint64_t altas = 0;
+    uint64_t vencidas = 0;
+    uint64_t cerradas = 0;
+};
+
+class AlmacenSesiones {
+public:
+    static constexpr size_t kFragmentos = 16;
+    static constexpr size_t kRanuras = 512;
+    static constexpr int64_t kTickMs = 1000;
+    static constexpr int64_t kTtlInactivoMs = 2 * 3600 * 1000;     // 2 h sin uso
+    static constexpr int64_t kTtlAbsolutoMs = 12 * 3600 * 1000;    // un turno largo
+
+    // alVencer se llama (fuera de los locks) con cada token que vence; se
+    // fija acá porque el hilo de la rueda ya corre al salir del constructor
+    explicit AlmacenSesiones(std::function<void(const std::string&)> alVencer = {},
+                             int64_t ttlInactivoMs = kTtlInactivoMs, int64_t ttlAbsolutoMs = kTtlAbsolutoMs);
+    ~AlmacenSesiones();
+    AlmacenSesiones(const AlmacenSesiones&) = delete;
+    AlmacenSesiones& operator=(const AlmacenSesiones&) = delete;
+
+    // Crea una sesión con token nuevo y lo devuelve
+    std::string crear(const std::string& usuario, const std::string& privilegio);
+    // Da de alta un token existente (recuperado del diario de estado).
+    // creadaParedMs es la hora de creación en reloj de pared (ms desde
+    // epoch): el vencimiento absoluto se sigue contando desde ahí y no
+    // desde el reinicio. 0 si no se conoce.
+    void restaurar(const std::string& token, const std::string& usuario, const std::string& privilegio,
+                   int64_t creadaParedMs);
+    std::optional<SesionActiva> resolver(const std::string& token);
+    // Como resolver() pero sin contar como uso: para quien sólo mira el
+    // token (p. ej. la admisión), que no debe alargar la sesión
+    std::optional<SesionActiva> consultar(const std::string& token) const;
+    bool cerrar(const std::string& token);
+    EstadisticasSesiones estadisticas() const;
+
+    static std::string generarToken();
+
+private:
+    struct Entrada {
+        SesionActiva sesion;
+        int64_t creadaMs = 0;
+        std::atomic<int64_t> ultimoUsoMs{0};
+    };
+    struct Fragmento {
+        mutable std::shared_mutex mtx;
+        std::unordered_map<std::string, Entrada> sesiones;
+    };
+
+    int64_t ttlInactivo, ttlAbsoluto;
+    std::array<Fragmento, kFragmentos> fragmentos;
+    std::atomic<uint64_t> altas{0}, vencidas{0}, cerradas{0};
+
+    // Rueda de vencimientos
+    std::mutex mtxRueda;
+    std::array<std::vector<std::string>, kRanuras> ranuras;
+    int64_t tickActual = 0;                 // último tick procesado
+    const std::function<void(const std::string&)> avisoVencida;
+
+    std::thread hilo;
+    std::mutex mtxHilo;
+    std::condition_variable cvHilo;
+    bool parar = false;
+
+    Fragmento& fragmento(const std::string& token) { return fragmentos[std::hash<std::string>{}(token) % kFragmentos]; }
+    int64_t vencimiento(const Entrada& e) const;
+    void insertar(const std::string& token, const std::string& usuario, const std::string& privilegio,
+                  int64_t creadaMs);
+    void programar(const std::string& token, int64_t vencimientoMs);
+    void avanzar(int64_t ahora);
+    void bucle();
+};
+
+#endif // ALMACEN_SESIONES_H
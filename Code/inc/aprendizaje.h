@@ -1,118 +1,98 @@
-
 #ifndef APRENDIZAJE_H
 #define APRENDIZAJE_H
 
-#include <fstream>
-#include <string>
-#include <mutex>
-#include <iostream>
-#include <filesystem>
+#include <atomic>
 #include <chrono>
-#include <ctime>
-#include <iomanip>
-#include <sstream>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
 
-class Aprendizaje {
-    std::ofstream log;
-    std::mutex mtx;
-    bool activo = false;
-    std::string rutaArchivo = "aprendizaje.gcode";
+#include "cola_mpsc.h"
+#include "fotogramas_aprendizaje.h"
 
+// Exportación que se lanza al detener: CSV en aprendizajes/ y el .gcode
+// enlazado (mismo blob) en aprendizajes/ y jobs/. Corre en segundo plano; `id` crece con
+// cada exportación para que el cliente sepa si mira la suya.
+struct EstadoExportacion {
+    enum Fase { NINGUNA, EN_CURSO, LISTA, FALLIDA };
+    Fase fase = NINGUNA;
+    uint64_t id = 0;
+    std::string origen;
+    std::string csv, gcode, jobs;
+    std::string teach;              // grabación con tiempos, si la hubo
+    std::string metodoCopia;        // enlace (almacén de blobs), reflink, copy_file_range o copia
+    uint64_t lineas = 0;
+    uint64_t bytes = 0;
+    double milisegundos = 0.0;
+    std::string mensaje;
+};
+
+// Grabación del modo enseñanza. `registrar` se llama desde el camino de
+// los comandos de movimiento, así que sólo encola el texto en una cola
+// sin bloqueo; un hilo escritor la vacía cada kPeriodoEscrituraMs, escribe
+// el lote con un solo write() y hace fdatasync como mucho cada
+// kPeriodoSyncMs. Ante una caída se pueden perder, como máximo, los
+// comandos de los últimos kPeriodoEscrituraMs + kPeriodoSyncMs (~300 ms);
+// si la cola se llena el comando se descarta y se cuenta, nunca se espera.
+// En paralelo, cada comando deja un fotograma (posición, avance y garra
+// con su instante) que el mismo escritor codifica en el .teach de la sesión.
+class Aprendizaje {
 public:
-    void iniciar(const std::string& ruta = "aprendizaje.gcode") {
-        std::lock_guard<std::mutex> lock(mtx);
-        // si no se proporcionó ruta específica, generar nombre con timestamp
-        if (ruta.empty() || ruta == "aprendizaje.gcode") {
-            // generar timestamp YYYYMMDD_HHMMSS usando chrono
-            using namespace std::chrono;
-            auto now = system_clock::now();
-            std::time_t t = system_clock::to_time_t(now);
-            std::tm tm;
-            localtime_r(&t, &tm);
-            char buf[64];
-            std::strftime(buf, sizeof(buf), "aprendizaje_%Y%m%d_%H%M%S.gcode", &tm);
-            rutaArchivo = std::string("aprendizaje gcode/") + std::string(buf);
-        } else {
-            rutaArchivo = ruta;
-            if (rutaArchivo.find('/') == std::string::npos && rutaArchivo.find('\\') == std::string::npos) {
-                rutaArchivo = std::string("aprendizaje gcode/") + rutaArchivo;
-            }
-        }
-        // Asegurar carpeta 'aprendizaje gcode'
-        try {
-            std::filesystem::create_directories("aprendizaje gcode");
-        } catch(...) {}
-        log.open(rutaArchivo, std::ios::out | std::ios::trunc);
-        activo = log.is_open();
-        std::cout << (activo ? "📘 Aprendizaje iniciado -> " : "❌ No se pudo abrir ") << rutaArchivo << "\n";
-    }
+    static constexpr int kPeriodoEscrituraMs = 50;
+    static constexpr int kPeriodoSyncMs = 250;
 
-    void detener() {
-        std::lock_guard<std::mutex> lock(mtx);
-        if (activo) {
-            log.close();
-            activo = false;
-            std::cout << "📕 Aprendizaje detenido.\n";
-            // Al detener, generar un CSV con los comandos guardados y colocarlo en la carpeta 'aprendizajes'
-            try {
-                namespace fs = std::filesystem;
-                fs::path dir = "aprendizajes";
-                fs::create_directories(dir);
+    Aprendizaje();
+    ~Aprendizaje();
+    Aprendizaje(const Aprendizaje&) = delete;
+    Aprendizaje& operator=(const Aprendizaje&) = delete;
 
-                auto now = std::chrono::system_clock::now();
-                std::time_t t = std::chrono::system_clock::to_time_t(now);
-                std::tm tm;
-                localtime_r(&t, &tm);
-                std::ostringstream ss;
-                ss << std::put_time(&tm, "%Y%m%d_%H%M%S");
+    // `usuario` queda como creador de la grabación y de sus copias en el catálogo
+    void iniciar(const std::string& ruta = "aprendizaje.gcode", const std::string& usuario = "");
+    // Continúa una sesión de aprendizaje que quedó abierta por una caída:
+    // se agrega al final del mismo archivo en lugar de truncarlo.
+    void reanudar(const std::string& ruta);
+    // Cierra la grabación y deja la exportación corriendo; devuelve su id
+    // (0 si no había nada que detener)
+    uint64_t detener();
+    EstadoExportacion estadoExportacion() const;
 
-                fs::path csvpath = dir / ("aprendizaje_" + ss.str() + ".csv");
+    void registrar(const std::string& cmd);
+    // El instante lo pone el grabador (ms desde que empezó la sesión)
+    void registrarFotograma(const Fotograma& f);
+
+    bool estaActivo() const { return activo.load(std::memory_order_acquire); }
+    uint64_t descartados() const { return contadorDescartados.load(std::memory_order_relaxed); }
+
+private:
+    std::mutex mtx;                 // iniciar/reanudar/detener (no lo toma registrar)
+    std::atomic<bool> activo{false};
+    std::string rutaArchivo = "aprendizaje.gcode";
+    std::string usuarioSesion;
+    int fd = -1;
+    int fdTeach = -1;
+    std::chrono::steady_clock::time_point inicioSesion;
+    int64_t baseMs = 0;             // al reanudar, el último instante grabado
 
-                std::ifstream in(rutaArchivo);
-                std::ofstream out(csvpath, std::ios::out | std::ios::trunc);
-                if (in && out) {
-                    out << "gcode\n";
-                    std::string line;
-                    while (std::getline(in, line)) {
-                        // Escapar comillas dobles para CSV
-                        std::string esc = line;
-                        size_t pos = 0;
-                        while ((pos = esc.find('"', pos)) != std::string::npos) { esc.insert(pos, "\""); pos += 2; }
-                        out << '"' << esc << '"' << '\n';
-                    }
-                    std::cout << "📁 Archivo CSV guardado: " << csvpath.string() << "\n";
-                    // Además, copiar el .gcode original a 'aprendizajes' y a 'jobs' con el mismo timestamp
-                    try {
-                        fs::path gcodeDst = dir / ("aprendizaje_" + ss.str() + ".gcode");
-                        // copiar archivo origen (rutaArchivo) -> aprendizajes/aprendizaje_<ts>.gcode
-                        fs::copy_file(rutaArchivo, gcodeDst, fs::copy_options::overwrite_existing);
-                        std::cout << "📁 Archivo GCODE guardado: " << gcodeDst.string() << "\n";
+    ColaMpsc<std::string> cola;
+    ColaMpsc<Fotograma> colaFotogramas;
+    fotogramas::Codificador codificador;    // sólo lo usa el escritor
+    std::atomic<uint64_t> contadorDescartados{0};
 
-                        // Asegurar carpeta jobs y copiar allí también
-                        fs::create_directories("jobs");
-                        fs::path jobsDst = fs::path("jobs") / gcodeDst.filename();
-                        fs::copy_file(rutaArchivo, jobsDst, fs::copy_options::overwrite_existing);
-                        std::cout << "📁 Copia GCODE en jobs: " << jobsDst.string() << "\n";
-                    } catch (const std::exception& e2) {
-                        std::cerr << "❌ Excepción al copiar GCODE: " << e2.what() << "\n";
-                    }
-                } else {
-                    std::cerr << "❌ No se pudo leer el archivo de aprendizaje o crear CSV: " << rutaArchivo << "\n";
-                }
-            } catch (const std::exception& e) {
-                std::cerr << "❌ Excepción al guardar CSV: " << e.what() << "\n";
-            }
-        }
-    }
+    std::thread escritor;
+    std::mutex mtxEscritor;
+    std::condition_variable cvEscritor;
+    bool pararEscritor = false;
 
-    void registrar(const std::string& cmd) {
-        std::lock_guard<std::mutex> lock(mtx);
-        if (activo && log.is_open()) {
-            log << cmd << "\n";
-        }
-    }
+    std::thread exportador;
+    mutable std::mutex mtxExportacion;
+    EstadoExportacion exportacion;
 
-    bool estaActivo() const { return activo; }
+    bool abrirLocked(bool truncar);
+    void cerrarLocked();
+    void bucleEscritor();
+    void exportar(uint64_t id, std::string origen, std::string marca, std::string usuario);
 };
 
 #endif
@@ -0,0 +1,13 @@
+#ifndef ARCHIVO_IO_H
+#define ARCHIVO_IO_H
+
+#include <cstddef>
+#include <string>
+
+// Escribe el buffer completo en fd, reintentando escrituras parciales y
+// las interrumpidas por señales (EINTR). Devuelve false ante cualquier otro
+// error; errno queda con el valor de la llamada que falló.
+bool escribirTodo(int fd, const char* datos, size_t n);
+bool escribirTodo(int fd, const std::string& datos);
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef ARCOS_GCODE_H
+#define ARCOS_GCODE_H
+
+#include "programa_gcode.h"
+
+#include <vector>
+
+// Segmentación de arcos G2/G3 en el host. El firmware sólo interpola rectas,
+// así que cada arco se reemplaza por la menor cantidad de G1 cuya flecha
+// (distancia máxima entre cuerda y arco) no supera `errorCuerda`. El arco
+// está en el plano XY (G17); Z y E se interpolan linealmente (hélice).
+// Formato centro (I/J, relativos al punto de inicio) o radio (R; R < 0
+// pide el arco de más de 180°). Con I/J y destino igual al inicio se
+// genera la circunferencia completa.
+
+struct OpcionesArco {
+    float errorCuerda = 0.05f;      // mm
+    int maxSegmentos = 2000;
+    bool verificarEspacio = true;   // rechazar arcos que salen del espacio de trabajo
+};
+
+enum class ResultadoArco {
+    OK = 0,
+    PARAMETROS_INVALIDOS,   // radio nulo, R imposible o centro inconsistente con el destino
+    FUERA_DE_ESPACIO
+};
+
+// Modo y posición tal como los ve el firmware, para que el host sepa
+// desde dónde arranca cada arco. Posiciones en coordenadas de máquina.
+struct PosicionModal {
+    bool relativo = false;
+    float pos[4];
+    float offset[4] = {};
+    float feed = 0;     // último F de un G0/G1 (mm/s)
+
+    PosicionModal();
+    // Aplica una instrucción ya enviada (G0/G1, G28, G90/G91, G92).
+    void avanzar(const InstruccionGcode& ins);
+};
+
+namespace gcode {
+
+// Genera en `segmentos` los G1 equivalentes al arco, escritos en el modo
+// actual (absolutos con el offset de G92 descontado o relativos).
+// `pos`/`offset` son X Y Z E en coordenadas de máquina.
+ResultadoArco segmentarArco(const InstruccionGcode& arco, const float pos[4], const float offset[4],
+                            bool relativo, const OpcionesArco& opciones,
+                            std::vector<InstruccionGcode>& segmentos);
+const char* describirResultado(ResultadoArco r);
+
+} // namespace gcode
+
+#endif // ARCOS_GCODE_H
@@ -0,0 +1,93 @@
+#ifndef CATALOGO_TRABAJOS_H
+#define CATALOGO_TRABAJOS_H
+
+#include <sqlite3.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct ProgramaGcode;
+
+// Catálogo de programas G-code (jobs/, uploads/, aprendizajes/ y
+// aprendizaje gcode/) en db/catalogo.sqlite3. Al arrancar se concilia una
+// sola vez con lo que hay en disco (sólo se re-indexan archivos cuyo
+// tamaño o mtime cambió) y desde ahí un hilo con inotify lo mantiene al
+// día; listar o buscar nunca recorre las carpetas.
+//
+// Indexar sólo lee el archivo para el hash y las líneas: no compila. Lo
+// que sale del IR (instrucciones, caja, duración) se completa cuando el
+// programa ya está en la caché o la primera vez que algo lo compila.
+
+struct FichaTrabajo {
+    std::string ruta;
+    std::string nombre;
+    std::string carpeta;
+    std::string hash;               // hash del contenido (hex)
+    uint32_t lineas = 0;
+    uint32_t instrucciones = 0;
+    uint32_t invalidas = 0;
+    bool tieneCaja = false;         // hay algún movimiento
+    float min[3] = {}, max[3] = {}; // caja de los puntos recorridos (máquina)
+    double segundos = 0.0;          // duración estimada
+    bool analizado = false;         // false: instrucciones, caja y duración todavía sin calcular
+    uint64_t bytes = 0;
+    std::string creador;
+    int64_t creado = 0;             // epoch s: primera vez que se indexó
+    int64_t modificado = 0;         // epoch s: mtime del archivo
+};
+
+enum class OrdenCatalogo { MODIFICADO, NOMBRE, DURACION };
+
+struct PaginaCatalogo {
+    uint64_t total = 0;             // coincidencias sin paginar
+    std::vector<FichaTrabajo> fichas;
+};
+
+class CatalogoTrabajos {
+    mutable std::mutex mtx;
+    sqlite3* db = nullptr;
+    std::string rutaDb;
+    std::vector<std::string> carpetas;
+
+    std::thread vigilante;
+    std::atomic<bool> detenerPedido{false};
+    int fdInotify = -1;
+    std::unordered_map<int, std::string> carpetaPorWd;  // se arma antes de lanzar el hilo
+
+public:
+    explicit CatalogoTrabajos(std::string ruta = "db/catalogo.sqlite3");
+    ~CatalogoTrabajos();
+    CatalogoTrabajos(const CatalogoTrabajos&) = delete;
+    CatalogoTrabajos& operator=(const CatalogoTrabajos&) = delete;
+
+    // Abre la base, concilia con el disco y empieza a vigilar las carpetas
+    bool iniciar(const std::vector<std::string>& carpetasVigiladas);
+    void detener();
+
+    // Indexa (o re-indexa) un archivo; false si no es un .gcode legible
+    bool indexar(const std::string& ruta);
+    void quitar(const std::string& ruta);
+    // Quién lo creó (subida, aprendizaje); sobrevive a los re-indexados
+    void registrarCreador(const std::string& ruta, const std::string& usuario);
+    // Completa las fichas sin analizar con el mismo contenido que `programa`
+    void completar(const ProgramaGcode& programa);
+
+    PaginaCatalogo listar(const std::string& carpeta, OrdenCatalogo orden, uint32_t desde, uint32_t cantidad) const;
+    // Busca en nombre, ruta, creador o prefijo de hash
+    PaginaCatalogo buscar(const std::string& texto, uint32_t desde, uint32_t cantidad) const;
+
+private:
+    bool abrirLocked();
+    void conciliar();
+    void bucleVigilancia();
+};
+
+// Instancia global usable desde los distintos módulos
+extern CatalogoTrabajos catalogoTrabajos;
+
+#endif // CATALOGO_TRABAJOS_H
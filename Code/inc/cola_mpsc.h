@@ -0,0 +1,70 @@
+#ifndef COLA_MPSC_H
+#define COLA_MPSC_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// Cola acotada sin bloqueo para varios productores y un único consumidor
+// (esquema de Vyukov: cada casilla lleva un número de secuencia que dice
+// si está libre para el productor o lista para el consumidor). Encolar
+// nunca espera: si la cola está llena devuelve false y decide el llamador.
+template <typename T>
+class ColaMpsc {
+    struct Casilla {
+        std::atomic<uint64_t> secuencia{0};
+        T dato{};
+    };
+
+    std::unique_ptr<Casilla[]> casillas;
+    const uint64_t mascara;
+    alignas(64) std::atomic<uint64_t> cola{0};      // próxima posición a escribir
+    alignas(64) uint64_t cabeza = 0;                // sólo la toca el consumidor
+
+public:
+    explicit ColaMpsc(size_t capacidadPotenciaDeDos)
+        : casillas(new Casilla[capacidadPotenciaDeDos]), mascara(capacidadPotenciaDeDos - 1) {
+        for (uint64_t i = 0; i <= mascara; ++i) casillas[i].secuencia.store(i, std::memory_order_relaxed);
+    }
+    ColaMpsc(const ColaMpsc&) = delete;
+    ColaMpsc& operator=(const ColaMpsc&) = delete;
+
+    bool encolar(T valor) { return intentarEncolar(valor); }
+
+    // Como encolar, pero `valor` sólo se mueve si entró: si la cola está
+    // llena queda intacto para reintentar
+    bool intentarEncolar(T& valor) {
+        uint64_t pos = cola.load(std::memory_order_relaxed);
+        Casilla* c;
+        for (;;) {
+            c = &casillas[pos & mascara];
+            const uint64_t sec = c->secuencia.load(std::memory_order_acquire);
+            const int64_t dif = static_cast<int64_t>(sec) - static_cast<int64_t>(pos);
+            if (dif == 0) {
+                if (cola.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (dif < 0) {
+                return false; // llena
+            } else {
+                pos = cola.load(std::memory_order_relaxed);
+            }
+        }
+        c->dato = std::move(valor);
+        c->secuencia.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Sólo desde el hilo consumidor
+    bool desencolar(T& valor) {
+        Casilla& c = casillas[cabeza & mascara];
+        if (c.secuencia.load(std::memory_order_acquire) != cabeza + 1) return false;
+        valor = std::move(c.dato);
+        c.dato = T{};
+        c.secuencia.store(cabeza + mascara + 1, std::memory_order_release);
+        ++cabeza;
+        return true;
+    }
+};
+
+#endif // COLA_MPSC_H
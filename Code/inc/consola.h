@@ -0,0 +1,58 @@
+#ifndef CONSOLA_H
+#define CONSOLA_H
+
+#include <atomic>
+#include <sstream>
+#include <string>
+
+// Salida por consola con niveles. Dos umbrales:
+//  - de compilación, CONSOLA_NIVEL_MINIMO (make NIVEL_CONSOLA=2): lo que
+//    queda por debajo ni se compila, `if constexpr` descarta la expresión;
+//  - de ejecución, consola::fijarNivel() (comando `logLevel`, variable de
+//    entorno CONSOLA_NIVEL): una carga atómica relajada y nada más; los
+//    operandos de << no se evalúan si el nivel está apagado.
+// Cada mensaje sale de una vez y sin flush (AVISO y ERROR van a stderr,
+// que no tiene buffer).
+//
+//   CONSOLA_DEBUG("📤 ENVIANDO: '" << comando << "'");
+
+enum class NivelConsola : int { TRAZA = 0, DEBUG = 1, INFO = 2, AVISO = 3, ERROR = 4, NADA = 5 };
+
+#ifndef CONSOLA_NIVEL_MINIMO
+#define CONSOLA_NIVEL_MINIMO 0
+#endif
+
+namespace consola {
+
+extern std::atomic<int> nivelActual;
+
+inline bool activo(NivelConsola n) {
+    return static_cast<int>(n) >= nivelActual.load(std::memory_order_relaxed);
+}
+void fijarNivel(NivelConsola n);
+NivelConsola nivel();
+// "traza", "debug", "info", "aviso", "error", "nada" (o el número)
+bool nivelDesdeTexto(const std::string& texto, NivelConsola& n);
+const char* nombreNivel(NivelConsola n);
+void escribir(NivelConsola n, const std::string& mensaje);
+
+} // namespace consola
+
+#define CONSOLA_EMITIR(nivel, expr)                                                                  \
+    do {                                                                                             \
+        if constexpr (static_cast<int>(NivelConsola::nivel) >= CONSOLA_NIVEL_MINIMO) {              \
+            if (consola::activo(NivelConsola::nivel)) {                                              \
+                std::ostringstream consola_os_;                                                      \
+                consola_os_ << expr;                                                                 \
+                consola::escribir(NivelConsola::nivel, consola_os_.str());                           \
+            }                                                                                        \
+        }                                                                                            \
+    } while (0)
+
+#define CONSOLA_TRAZA(expr) CONSOLA_EMITIR(TRAZA, expr)
+#define CONSOLA_DEBUG(expr) CONSOLA_EMITIR(DEBUG, expr)
+#define CONSOLA_INFO(expr) CONSOLA_EMITIR(INFO, expr)
+#define CONSOLA_AVISO(expr) CONSOLA_EMITIR(AVISO, expr)
+#define CONSOLA_ERROR(expr) CONSOLA_EMITIR(ERROR, expr)
+
+#endif // CONSOLA_H
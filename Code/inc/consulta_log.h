@@ -0,0 +1,115 @@
+#ifndef CONSULTA_LOG_H
+#define CONSULTA_LOG_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "registro_log.h"
+
+// Consultas sobre los segmentos de log (formato en registro_log.h) sin
+// recorrerlos enteros. Cada segmento tiene un índice disperso en memoria:
+// rango de ms, categorías, clases de código HTTP, su tabla de cadenas y
+// una entrada cada kRegistrosPorBloque registros con el desplazamiento,
+// el rango de ms y una huella de 64 bits de usuario/nodo/módulo/detalle.
+//
+// Un segmento se descarta por rango de tiempo (el nombre del siguiente ya
+// acota el final) o porque el usuario, nodo o módulo buscado no está en su
+// tabla; un bloque, por rango, categoría, código o huella. Sólo se
+// decodifican los bloques que pueden tener coincidencias, y los filtros se
+// comparan por id sin copiar cadenas.
+//
+// El índice de un segmento se arma la primera vez que una consulta lo toca
+// y se conserva (también cuando se renombra al rotar o pasa a .gz); el
+// activo se extiende leyendo sólo lo que se le agregó. El contenido
+// descomprimido queda en una caché LRU de kCacheBytes.
+
+struct FiltroLog {
+    int64_t desdeMs = INT64_MIN;
+    int64_t hastaMs = INT64_MAX;        // inclusive
+    int categorias = 0;                 // máscara de 1 << RegistroLog::Categoria; 0 = todas
+    std::string usuario, nodo, modulo;  // exactos; vacío = cualquiera
+    int codigoMin = 0, codigoMax = 0;   // sólo peticiones; 0 = sin filtro
+    std::string texto;                  // subcadena de detalle o mensaje
+};
+
+struct EstadisticasConsulta {
+    uint32_t segmentos = 0;             // segmentos en disco
+    uint32_t segmentosLeidos = 0;
+    uint32_t bloques = 0;               // bloques de los segmentos leídos
+    uint32_t bloquesLeidos = 0;
+    uint64_t registrosLeidos = 0;
+    uint64_t coincidencias = 0;
+    double milisegundos = 0;
+};
+
+class IndiceLog {
+public:
+    static constexpr uint32_t kRegistrosPorBloque = 256;
+    static constexpr size_t kCacheBytes = 64u << 20;
+    // Registros encolados antes de una rotación pueden caer en el segmento
+    // nuevo con un ms algo anterior a su cabecera
+    static constexpr int64_t kMargenMs = 5000;
+
+    explicit IndiceLog(const std::string& base = "logs/server_log");
+
+    // Llama a `visitar` con cada registro que cumple el filtro, segmento por
+    // segmento en orden cronológico; `visitar` devuelve false para cortar.
+    // Las consultas se serializan: `visitar` no debe consultar de nuevo.
+    EstadisticasConsulta consultar(const FiltroLog& filtro, const std::function<bool(const RegistroLog&)>& visitar);
+
+private:
+    struct Bloque {
+        size_t desplazamiento = 0;
+        int64_t msPrevio = 0;           // ms del registro anterior (base del delta)
+        int64_t msMin = INT64_MAX, msMax = INT64_MIN;
+        uint32_t registros = 0;
+        uint8_t categorias = 0;
+        uint16_t clasesCodigo = 0;      // bit codigo/100
+        uint64_t huella = 0;
+    };
+
+    struct Segmento {
+        std::string ruta;
+        uint64_t inodo = 0;
+        uint64_t tamanoDisco = 0;
+        bool comprimido = false;
+        bool valido = false;
+        int64_t msBase = 0;
+        // Índice
+        bool indexado = false;
+        bool completo = false;          // .gz indexado entero: ya no cambia
+        uint64_t tamanoIndexado = 0;    // bytes leídos del plano
+        size_t finIndexado = 0;
+        int64_t msFinal = 0;
+        int64_t msMin = INT64_MAX, msMax = INT64_MIN;
+        uint64_t registros = 0;
+        uint8_t categorias = 0;
+        uint16_t clasesCodigo = 0;
+        std::vector<std::string> tabla;
+        std::unordered_map<std::string, uint32_t> ids;
+        std::vector<Bloque> bloques;
+        // Caché
+        std::string datos;
+        uint64_t ultimoUso = 0;
+    };
+
+    std::mutex mtx;
+    std::string base;
+    std::map<std::string, Segmento> segmentos;  // por ruta
+    uint64_t reloj = 0;
+
+    void sincronizar();
+    bool cargarDatos(Segmento& s);
+    bool indexar(Segmento& s);
+    void recortarCache(const Segmento& enUso);
+};
+
+// Instancia global usable desde los distintos módulos
+extern IndiceLog indiceLog;
+
+#endif // CONSULTA_LOG_H
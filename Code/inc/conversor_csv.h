@@ -0,0 +1,94 @@
+#ifndef CONVERSOR_CSV_H
+#define CONVERSOR_CSV_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Conversión CSV -> G-code en una sola pasada, a medida que llega el
+// cuerpo de /upload. El CSV se interpreta según RFC 4180 de forma
+// incremental (campos entre comillas, "" como comilla, CRLF o LF, un
+// registro puede quedar partido entre dos bloques). La primera fila es
+// la cabecera: se usa la columna "gcode" si existe y si no la primera.
+// Aquí sólo se detectan problemas del CSV (comillas, saltos dentro de un
+// campo, campos demasiado largos); el G-code se valida después sobre el
+// archivo convertido (validador_gcode.h). Aparte de la línea de origen de
+// cada línea G-code (4 bytes por línea) la memoria no depende del tamaño
+// del archivo (un campo se corta en kMaxCampo). Las salidas se escriben a .tmp y al terminar se publican
+// en el almacén de blobs (el hash se calcula mientras se escribe).
+
+struct ErrorLineaCsv {
+    uint64_t linea = 0;     // línea física del CSV donde empieza la fila
+    std::string motivo;
+};
+
+struct ResultadoConversion {
+    bool ok = false;
+    std::string error;
+    uint64_t bytesCsv = 0;
+    uint64_t filas = 0;             // filas de datos (sin la cabecera)
+    uint64_t lineasGcode = 0;
+    uint64_t vacias = 0;
+    uint64_t invalidas = 0;         // filas con problemas de CSV
+    std::vector<ErrorLineaCsv> errores;     // las primeras kMaxErrores
+    std::string rutaGcode;
+    uint64_t hashGcode = 0;
+    std::string rutaCsv;            // vacía si no se pidió conservar el CSV
+};
+
+class ConversorCsvGcode {
+public:
+    static constexpr size_t kMaxCampo = 4096;
+    static constexpr size_t kMaxErrores = 20;
+
+    // rutaCsv vacía: el CSV original no se guarda
+    ConversorCsvGcode(std::string rutaGcode, std::string rutaCsv);
+    ~ConversorCsvGcode();
+    ConversorCsvGcode(const ConversorCsvGcode&) = delete;
+    ConversorCsvGcode& operator=(const ConversorCsvGcode&) = delete;
+
+    bool abrir();
+    // false si falló la escritura; el resto de los datos se puede descartar
+    bool alimentar(const char* datos, size_t n);
+    // Cierra la última fila, sincroniza y publica los archivos
+    ResultadoConversion terminar();
+    // Descarta los .tmp (cuerpo incompleto, cliente que se fue, etc.)
+    void abortar(const std::string& motivo);
+    // Línea del CSV de la que salió una línea del .gcode (0 si no existe)
+    uint64_t lineaCsv(uint64_t lineaGcode) const;
+
+private:
+    enum class Estado { INICIO_CAMPO, CAMPO, COMILLAS, COMILLA };
+
+    std::string rutaGcode, rutaCsv;
+    int fdGcode = -1, fdCsv = -1;
+    ResultadoConversion r;
+    bool fallo = false;
+
+    Estado estado = Estado::INICIO_CAMPO;
+    std::string campo;              // campo en curso
+    std::string valor;              // valor de la columna G-code de la fila
+    std::vector<std::string> cabecera;
+    size_t columna = 0;             // índice del campo en curso
+    size_t columnaGcode = 0;
+    bool esCabecera = true;
+    bool filaConSaltos = false;     // salto de línea dentro de un campo entre comillas
+    bool filaMalFormada = false;
+    bool campoCortado = false;
+    bool hayDatosFila = false;
+    uint64_t lineaFisica = 1;
+    uint64_t lineaFila = 1;
+    std::string salida;             // G-code pendiente de escribir
+    std::vector<uint32_t> origenLineas;     // línea del CSV de cada línea G-code
+    uint64_t hashGcode, hashCsv;    // de lo escrito hasta ahora
+
+    void agregar(char c);
+    void finCampo();
+    void finFila();
+    void anotarError(const std::string& motivo);
+    bool volcar();
+    void cerrar();
+};
+
+#endif // CONVERSOR_CSV_H
@@ -0,0 +1,124 @@
+#ifndef DIARIO_ESTADO_H
+#define DIARIO_ESTADO_H
+
+#include "cola_mpsc.h"
+#include "estado_robot.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+// Diario de estado a prueba de caídas. Cada transición (estado del robot,
+// modo remoto, aprendizaje, progreso de trabajos y sesiones) se agrega al
+// final de db/diario/diario.log como un registro con largo y CRC32; cada
+// tanto el estado completo se compacta en snapshot.bin (tmp + fsync +
+// rename) y el diario vuelve a empezar. Al arrancar se carga el snapshot,
+// se reaplica la cola del diario y se descarta un último registro a medio
+// escribir. Todos los registros son "fijar valor", así que reaplicar el
+// diario sobre un snapshot más nuevo no cambia el resultado.
+
+struct EstadoPersistido {
+    struct Robot {
+        float x = 0, y = 0, z = 0, e = 0;
+        bool motores = false, garra = false, modoAbs = true, emergencia = false;
+    };
+    struct Trabajo {
+        std::string ruta;
+        uint64_t hash = 0;
+        uint32_t linea = 0;         // última línea fuente enviada
+        bool activo = false;        // true si el servidor cayó a mitad del trabajo
+        int64_t inicioMs = 0;
+    };
+    struct Sesion {
+        std::string usuario;
+        std::string privilegio;
+        int64_t creadaMs = 0;       // reloj de pared; 0 en diarios anteriores
+    };
+
+    bool hayRobot = false;
+    Robot robot;
+    bool hayRemoto = false;
+    bool remoto = true;
+    bool aprendiendo = false;
+    std::string rutaAprendizaje;
+    Trabajo trabajo;
+    std::unordered_map<std::string, Sesion> sesiones;   // token -> sesión
+};
+
+struct ReporteRecuperacion {
+    bool snapshot = false;
+    size_t registros = 0;           // registros del diario reaplicados
+    size_t bytesDescartados = 0;    // cola incompleta o corrupta
+    double milisegundos = 0.0;
+};
+
+class DiarioEstado {
+    mutable std::mutex mtx;
+    std::string directorio;
+    int fd = -1;
+    EstadoPersistido estado;
+    uint64_t bytesDiario = 0;
+    int64_t ultimoSyncMs = 0;
+    int64_t ultimoProgresoMs = 0;
+
+    // Cambios del robot: el observador de EstadoRobot sólo encola y este
+    // hilo los escribe (del lote, sólo el último: cada registro es el
+    // estado completo)
+    static constexpr size_t kCapacidadRobot = 1024;
+    static constexpr int kPeriodoRobotMs = 20;
+    ColaMpsc<EstadoRobot::Snapshot> colaRobot{kCapacidadRobot};
+    std::atomic<uint64_t> robotDescartados{0};
+    // Con la cola llena el último cambio no se pierde: queda acá
+    std::mutex mtxDesborde;
+    EstadoRobot::Snapshot desborde{};
+    std::atomic<bool> hayDesborde{false};
+    std::thread escritorRobot;
+    std::mutex mtxEscritor;
+    std::condition_variable cvEscritor;
+    bool pararEscritor = false;
+    void bucleRobot();
+
+public:
+    explicit DiarioEstado(std::string dir = "db/diario");
+    ~DiarioEstado();
+    DiarioEstado(const DiarioEstado&) = delete;
+    DiarioEstado& operator=(const DiarioEstado&) = delete;
+
+    // Carga snapshot + diario y deja el archivo listo para seguir agregando.
+    ReporteRecuperacion recuperar();
+    EstadoPersistido copia() const;
+    EstadoPersistido::Trabajo trabajo() const;
+
+    void registrarRobot(const EstadoRobot::Snapshot& s);
+    // Para el observador de EstadoRobot (dentro de su sección crítica): no
+    // hace E/S, la escritura queda para el hilo del diario
+    void encolarRobot(const EstadoRobot::Snapshot& s);
+    void registrarRemoto(bool on);
+    void registrarAprendizaje(bool activo, const std::string& ruta);
+    void inicioTrabajo(const std::string& ruta, uint64_t hash);
+    // Se guarda como mucho dos veces por segundo
+    void progresoTrabajo(uint32_t linea);
+    void finTrabajo();
+    void altaSesion(const std::string& token, const std::string& usuario, const std::string& privilegio);
+    // Sesión vencida o cerrada: no se restaura al arrancar
+    void bajaSesion(const std::string& token);
+
+    // Escribe el snapshot y vacía el diario (también se hace solo al crecer)
+    bool compactar();
+
+private:
+    void agregarLocked(uint8_t tipo, const std::string& datos, bool sincronizar);
+    bool compactarLocked();
+    bool abrirDiarioLocked(bool truncar);
+    std::string rutaDiario() const;
+    std::string rutaSnapshot() const;
+};
+
+// Instancia global usable desde los distintos módulos
+extern DiarioEstado diarioEstado;
+
+#endif // DIARIO_ESTADO_H
@@ -1,35 +1,130 @@
-
 #ifndef ESTADO_ROBOT_H
 #define ESTADO_ROBOT_H
 
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <mutex>
 
+// Posición en coordenadas de programa, tal como la informa el firmware
+// (M114 / LINEAR MOVE). `objetivo` es el último destino aceptado.
+//
+// Seqlock: los escritores (controlador y sondeo serie) se serializan entre
+// sí con un mutex, pero los lectores nunca bloquean; si leen a mitad de una
+// escritura reintentan. La secuencia es par fuera de las escrituras y
+// `version` (= secuencia / 2) sólo avanza cuando algo cambió de verdad.
 class EstadoRobot {
-    mutable std::mutex mtx;
-    float x=0, y=0, z=0;
-    bool motores=false;
-    bool garra=false;
-    bool modoAbs=true;
-    bool emergencia=false;
-
 public:
-    void setPos(float nx,float ny,float nz){
-        std::lock_guard<std::mutex> l(mtx);
-        x=nx; y=ny; z=nz;
-    }
-    void setMotores(bool on){ std::lock_guard<std::mutex> l(mtx); motores=on; }
-    void setGarra(bool on){ std::lock_guard<std::mutex> l(mtx); garra=on; }
-    void setModo(bool abs){ std::lock_guard<std::mutex> l(mtx); modoAbs=abs; }
-    void setEmergencia(bool e){ std::lock_guard<std::mutex> l(mtx); emergencia=e; }
-
     struct Snapshot {
         float x,y,z;
         bool motores,garra,modoAbs,emergencia;
+        float e;
+        float ox,oy,oz;
+        bool fueraDeEspacio;
+        uint64_t version;
+    };
+    // Se llama con cada cambio, ya publicado y todavía dentro del mutex de
+    // escritura: los cambios llegan de a uno y en orden. No debe hacer E/S
+    // (lo llama el hilo serie); el diario sólo encola.
+    using Observador = std::function<void(const Snapshot&)>;
+
+private:
+    struct Campos {
+        float x=0, y=0, z=0, e=0;
+        float ox=0, oy=0, oz=0;
+        bool motores=false;
+        bool garra=false;
+        bool modoAbs=true;
+        bool emergencia=false;
+        bool fueraDeEspacio=false;
     };
+
+    std::mutex mtxEscritura;
+    std::atomic<uint64_t> secuencia{0};
+    // Copia de trabajo del escritor (sólo se toca con mtxEscritura)
+    Campos actual;
+    // Copia publicada: campos atómicos relajados para que leerlos durante
+    // una escritura no sea una carrera de datos
+    std::atomic<float> x{0}, y{0}, z{0}, e{0}, ox{0}, oy{0}, oz{0};
+    std::atomic<bool> motores{false}, garra{false}, modoAbs{true}, emergencia{false}, fueraDeEspacio{false};
+    Observador observador;
+
+    template <typename F>
+    void modificar(F&& cambio) {
+        std::lock_guard<std::mutex> l(mtxEscritura);
+        Campos nuevo = actual;
+        cambio(nuevo);
+        if (iguales(nuevo, actual)) return;
+        actual = nuevo;
+
+        const uint64_t s = secuencia.load(std::memory_order_relaxed);
+        secuencia.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        constexpr auto r = std::memory_order_relaxed;
+        x.store(nuevo.x, r); y.store(nuevo.y, r); z.store(nuevo.z, r); e.store(nuevo.e, r);
+        ox.store(nuevo.ox, r); oy.store(nuevo.oy, r); oz.store(nuevo.oz, r);
+        motores.store(nuevo.motores, r); garra.store(nuevo.garra, r);
+        modoAbs.store(nuevo.modoAbs, r); emergencia.store(nuevo.emergencia, r);
+        fueraDeEspacio.store(nuevo.fueraDeEspacio, r);
+        secuencia.store(s + 2, std::memory_order_release);
+        if (observador) {
+            observador({nuevo.x, nuevo.y, nuevo.z, nuevo.motores, nuevo.garra, nuevo.modoAbs,
+                        nuevo.emergencia, nuevo.e, nuevo.ox, nuevo.oy, nuevo.oz,
+                        nuevo.fueraDeEspacio, (s + 2) / 2});
+        }
+    }
+
+    static bool iguales(const Campos& a, const Campos& b) {
+        return a.x == b.x && a.y == b.y && a.z == b.z && a.e == b.e &&
+               a.ox == b.ox && a.oy == b.oy && a.oz == b.oz &&
+               a.motores == b.motores && a.garra == b.garra && a.modoAbs == b.modoAbs &&
+               a.emergencia == b.emergencia && a.fueraDeEspacio == b.fueraDeEspacio;
+    }
+
+public:
+    // Configurar antes de que empiecen a escribir otros hilos
+    void setObservador(Observador o){
+        std::lock_guard<std::mutex> l(mtxEscritura);
+        observador = std::move(o);
+    }
+
+    void setPos(float nx,float ny,float nz){
+        modificar([&](Campos& c){ c.x=nx; c.y=ny; c.z=nz; });
+    }
+    void setPos(float nx,float ny,float nz,float ne){
+        modificar([&](Campos& c){ c.x=nx; c.y=ny; c.z=nz; c.e=ne; });
+    }
+    void setObjetivo(float nx,float ny,float nz){
+        modificar([&](Campos& c){ c.ox=nx; c.oy=ny; c.oz=nz; });
+    }
+    void setMotores(bool on){ modificar([&](Campos& c){ c.motores=on; }); }
+    void setGarra(bool on){ modificar([&](Campos& c){ c.garra=on; }); }
+    void setModo(bool abs){ modificar([&](Campos& c){ c.modoAbs=abs; }); }
+    void setEmergencia(bool em){ modificar([&](Campos& c){ c.emergencia=em; }); }
+    void setFueraDeEspacio(bool f){ modificar([&](Campos& c){ c.fueraDeEspacio=f; }); }
+
     Snapshot leer() const {
-        std::lock_guard<std::mutex> l(mtx);
-        return {x,y,z,motores,garra,modoAbs,emergencia};
+        constexpr auto r = std::memory_order_relaxed;
+        Snapshot s;
+        for (;;) {
+            const uint64_t antes = secuencia.load(std::memory_order_acquire);
+            if (antes & 1u) continue; // escritura en curso
+            s.x = x.load(r); s.y = y.load(r); s.z = z.load(r); s.e = e.load(r);
+            s.ox = ox.load(r); s.oy = oy.load(r); s.oz = oz.load(r);
+            s.motores = motores.load(r); s.garra = garra.load(r);
+            s.modoAbs = modoAbs.load(r); s.emergencia = emergencia.load(r);
+            s.fueraDeEspacio = fueraDeEspacio.load(r);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (secuencia.load(r) == antes) {
+                s.version = antes / 2;
+                return s;
+            }
+        }
     }
+
+    // Versión actual; sirve para preguntar "¿cambió algo desde N?" sin copiar nada
+    uint64_t version() const { return secuencia.load(std::memory_order_acquire) / 2; }
+    bool cambioDesde(uint64_t v) const { return version() != v; }
 };
 
 #endif
@@ -0,0 +1,57 @@
+#ifndef ESTIMADOR_TRABAJO_H
+#define ESTIMADOR_TRABAJO_H
+
+#include "arcos_gcode.h"
+#include "modelo_brazo.h"
+#include "programa_gcode.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Estimador de duración de trabajos. Reproduce sobre el IR lo que hacen
+// Interpolation::setInterpolation/updateActualPosition en el firmware:
+// v = F (el firmware interpreta F en mm/s), o sqrt(dist)*10 con mínimo 5 si
+// F < 5; duración 1/tmul según SPEED_PROFILE; corte del movimiento al salir
+// del espacio de trabajo; G4 (S segundos), G28 simulado (3000 ms) y el
+// bloqueo de BYJ_Gripper en M3/M5. Opcionalmente modela también el ida y
+// vuelta serie del host (envío, espera del "OK" y los 500 ms extra que
+// ComunicacionControladorSimple espera tras cada respuesta). Los G2/G3 se
+// estiman como las cuerdas que efectivamente se envían.
+
+struct OpcionesEstimador {
+    brazo::PerfilVelocidad perfil = brazo::kPerfilFirmware;
+    bool incluirHost = true;
+    double esperaExtraHostS = 0.5;
+    double segundosGarra = brazo::kPasosGarra * 0.001;
+    double segundosHome = brazo::kSegundosHomeSimulado;
+    int baudios = brazo::kBaudios;
+    OpcionesArco arcos;             // segmentación de G2/G3, igual que al enviar
+};
+
+struct SegmentoEstimado {
+    uint32_t linea = 0;
+    OpGcode op = OpGcode::DESCONOCIDO;
+    double inicio = 0.0;     // s desde el comienzo, cuando el firmware la ejecuta
+    double duracion = 0.0;   // tiempo de movimiento o bloqueo en el firmware
+    bool fueraDeEspacio = false;
+};
+
+struct EstimacionTrabajo {
+    double segundosTotales = 0.0;
+    double segundosFirmware = 0.0;   // suma de movimientos y bloqueos
+    double distanciaMm = 0.0;
+    size_t instrucciones = 0;
+    size_t fueraDeEspacio = 0;
+    std::vector<SegmentoEstimado> segmentos;
+};
+
+namespace gcode {
+
+EstimacionTrabajo estimarDuracion(const ProgramaGcode& programa,
+                                  const OpcionesEstimador& opciones = OpcionesEstimador{},
+                                  bool conSegmentos = true);
+
+} // namespace gcode
+
+#endif // ESTIMADOR_TRABAJO_H
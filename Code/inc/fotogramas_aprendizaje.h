@@ -0,0 +1,101 @@
+#ifndef FOTOGRAMAS_APRENDIZAJE_H
+#define FOTOGRAMAS_APRENDIZAJE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "modelo_brazo.h"
+
+// Grabación con tiempos del modo enseñanza. Junto al .gcode de cada
+// sesión se guarda un .teach con un fotograma por cada cambio de
+// posición, avance o garra:
+//
+//   cabecera: "TCH1"
+//   registro: [flags u8][dt ms varint][dx dy dz de zigzag varint][feed varint]?
+//
+// Las coordenadas van en centésimas de mm y como diferencia con el
+// fotograma anterior (un movimiento típico ocupa 6-10 bytes); el avance
+// sólo se escribe cuando cambia. Un registro cortado al final (caída a
+// mitad de escritura) se ignora al leer.
+
+struct Fotograma {
+    int64_t ms = 0;                 // desde el inicio de la grabación
+    float x = 0, y = 0, z = 0, e = 0;   // coordenadas de programa (G90)
+    float feed = 0;                 // avance modal (mm/s, como F en el firmware)
+    bool garra = false;
+};
+
+struct OpcionesReproduccion {
+    double velocidad = 1.0;         // multiplicador sobre el tiempo grabado
+    int pasoMinimoMs = 40;          // menos que esto entre movimientos satura la serie
+    float feedMinimo = brazo::kFeedMinimo;     // mm/s, mismos límites que el validador
+    float feedMaximo = brazo::kFeedMaximo;
+    float muestreoEspacioMm = 5.0f; // paso para validar el tramo entre fotogramas
+    float offset[4] = {};           // G92 vigente: para validar en coordenadas de máquina
+};
+
+struct PasoReproduccion {
+    enum Tipo : uint8_t { MOVER, GARRA_ON, GARRA_OFF };
+    Tipo tipo = MOVER;
+    int64_t ms = 0;                 // instante de envío, ya escalado
+    float x = 0, y = 0, z = 0, e = 0;
+    float feed = 0;
+};
+
+struct PlanReproduccion {
+    std::vector<PasoReproduccion> pasos;
+    size_t fotogramas = 0;
+    size_t omitidos = 0;            // fotogramas absorbidos por el remuestreo
+    size_t feedLimitado = 0;        // tramos que a esa velocidad superan feedMaximo
+    size_t fueraDeEspacio = 0;
+    int64_t duracionMs = 0;
+    bool tieneFuera = false;
+    Fotograma primerFuera;          // primer punto inválido (ms sin escalar)
+    bool valido() const { return fueraDeEspacio == 0 && !pasos.empty(); }
+};
+
+struct ResultadoReproduccion {
+    PlanReproduccion plan;
+    size_t bytesDescartados = 0;    // cola cortada del .teach
+    bool ejecutada = false;
+    size_t enviados = 0;
+    int64_t retrasoMaxMs = 0;       // cuánto se atrasó el envío respecto del plan
+    std::string error;
+};
+
+namespace fotogramas {
+
+// Codificación incremental: cada grabación usa su propio codificador
+class Codificador {
+    bool primero = true;
+    int64_t ms = 0;
+    int32_t q[4] = {};
+    int32_t feed = -1;
+    bool garra = false;
+
+public:
+    static std::string cabecera();
+    // Para seguir agregando a un archivo existente cuyo último registro es `ultimo`
+    void continuar(const Fotograma& ultimo);
+    // Agrega el registro a `out`; devuelve false (y no escribe nada) si
+    // el fotograma no cambia ni la posición, ni el avance, ni la garra.
+    bool codificar(const Fotograma& f, std::string& out);
+};
+
+// Lee un .teach completo. `bytesDescartados` > 0 si la cola estaba cortada.
+bool leer(const std::string& ruta, std::vector<Fotograma>& out, size_t& bytesDescartados, std::string& error);
+
+// Escala los tiempos y los avances por `velocidad`, funde los fotogramas
+// más cercanos que pasoMinimoMs (los de garra y el último se conservan
+// siempre) y valida cada tramo recto contra el espacio de trabajo. Los
+// pasos quedan ordenados por el instante en que hay que enviarlos.
+PlanReproduccion planificar(const std::vector<Fotograma>& fotogramas, const OpcionesReproduccion& opciones);
+
+// .gcode de una sesión -> .teach correspondiente
+std::string rutaGrabacion(const std::string& rutaGcode);
+
+} // namespace fotogramas
+
+#endif // FOTOGRAMAS_APRENDIZAJE_H
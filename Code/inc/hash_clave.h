@@ -0,0 +1,50 @@
+#ifndef HASH_CLAVE_H
+#define HASH_CLAVE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Hash de contraseñas con PBKDF2-HMAC-SHA256 y sal aleatoria por usuario.
+// Lo que se guarda en users.password_hash es texto:
+//
+//   pbkdf2-sha256$<iteraciones>$<sal hex>$<clave derivada hex>
+//
+// El costo va dentro del hash, así que se puede subir sin invalidar los
+// existentes: Login los vuelve a derivar con el costo nuevo en el próximo
+// login correcto. SHA-256 propio (sin OpenSSL); los estados internos de
+// HMAC se calculan una vez por derivación, cada iteración son dos bloques.
+
+namespace hash_clave {
+
+constexpr std::string_view kPrefijo = "pbkdf2-sha256";
+constexpr uint32_t kIteracionesPorDefecto = 60000;     // ~50 ms en un núcleo
+constexpr uint32_t kIteracionesMin = 1000;
+constexpr uint32_t kIteracionesMax = 10000000;
+constexpr size_t kBytesSal = 16;
+constexpr size_t kBytesDerivada = 32;
+
+std::array<uint8_t, 32> sha256(std::string_view datos);
+void pbkdf2Sha256(std::string_view clave, std::string_view sal, uint32_t iteraciones,
+                  uint8_t* salida, size_t largo);
+
+// Hash nuevo con sal de getrandom()
+std::string derivar(std::string_view clave, uint32_t iteraciones = kIteracionesPorDefecto);
+// true si `clave` corresponde a `almacenado` (comparación en tiempo constante).
+// false también si `almacenado` no tiene el formato.
+bool verificar(std::string_view clave, std::string_view almacenado);
+// Iteraciones de un hash almacenado; 0 si no es un hash (texto plano heredado)
+uint32_t iteraciones(std::string_view almacenado);
+
+bool igualesTiempoConstante(std::string_view a, std::string_view b);
+
+// Vectores conocidos: SHA-256 de FIPS 180-4 y PBKDF2-HMAC-SHA256 de
+// RFC 7914 §11. Un cambio en la compresión que los rompa invalidaría todos
+// los hashes guardados. false y el caso en `fallo` si alguno no coincide.
+bool autoprueba(std::string* fallo = nullptr);
+
+} // namespace hash_clave
+
+#endif // HASH_CLAVE_H
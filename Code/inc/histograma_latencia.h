@@ -0,0 +1,37 @@
+#ifndef HISTOGRAMA_LATENCIA_H
+#define HISTOGRAMA_LATENCIA_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Histograma de latencias en µs sin bloqueo: registrar() es un fetch_add
+// relajado, apto para cualquier hilo. Cubetas log-lineales (8 por cada
+// potencia de 2), así el percentil tiene a lo sumo ~12 % de error relativo
+// de 1 µs hasta ~1 h con memoria fija.
+
+struct ResumenLatencia {
+    uint64_t muestras = 0;
+    uint64_t p50Us = 0, p90Us = 0, p99Us = 0, maxUs = 0;
+    double mediaUs = 0;
+};
+
+class HistogramaLatencia {
+public:
+    static constexpr int kSubcubetas = 8;
+    static constexpr int kExponentes = 32;
+
+    void registrar(uint64_t us);
+    // Cota superior de la cubeta donde cae el percentil p (0..100)
+    uint64_t percentil(double p) const;
+    ResumenLatencia resumen() const;
+
+private:
+    std::array<std::atomic<uint64_t>, kSubcubetas * kExponentes> cubetas{};
+    std::atomic<uint64_t> total{0}, sumaUs{0}, maximoUs{0};
+
+    static int cubeta(uint64_t us);
+    static uint64_t techo(int indice);
+};
+
+#endif // HISTOGRAMA_LATENCIA_H
@@ -0,0 +1,40 @@
+#ifndef LECTOR_MAPEADO_H
+#define LECTOR_MAPEADO_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Lector de archivos de texto respaldado por mmap. Entrega líneas como
+// string_view sobre el mapeo (sin copias) y va avisando al kernel qué
+// ventana se leerá a continuación y qué páginas ya no se necesitan, de modo
+// que la memoria residente se mantiene acotada aunque el archivo pese cientos
+// de MB. Las vistas devueltas son válidas mientras viva el lector.
+class LectorMapeado {
+    int fd = -1;
+    const char* base = nullptr;
+    size_t tam = 0;
+    size_t pos = 0;
+    size_t prefetchHasta = 0;   // fin de la ventana ya pedida con MADV_WILLNEED
+    size_t liberadoHasta = 0;   // inicio de las páginas aún residentes
+
+public:
+    explicit LectorMapeado(const std::string& ruta);
+    ~LectorMapeado();
+    LectorMapeado(const LectorMapeado&) = delete;
+    LectorMapeado& operator=(const LectorMapeado&) = delete;
+
+    bool abierto() const { return fd >= 0; }
+    size_t tamano() const { return tam; }
+    size_t posicion() const { return pos; }
+    std::string_view contenido() const { return {base, tam}; }
+
+    // Avanza a la siguiente línea (sin '\n' ni '\r' final).
+    // Devuelve false al llegar al final del archivo.
+    bool siguienteLinea(std::string_view& linea);
+
+private:
+    void avisarKernel();
+};
+
+#endif // LECTOR_MAPEADO_H
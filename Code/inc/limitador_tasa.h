@@ -0,0 +1,92 @@
+#ifndef LIMITADOR_TASA_H
+#define LIMITADOR_TASA_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Control de admisión del puerto 8080: cubetas de fichas por IP de origen
+// y por usuario (el del token, si lo hay), con presupuestos separados por
+// clase de tráfico. Una petición entra sólo si las dos cubetas que le
+// tocan tienen ficha; si no, se responde 429 con Retry-After sin
+// procesarla. Las rechazadas no gastan fichas: un panel que insiste no se
+// bloquea más de lo que pide su propio ritmo.
+//
+// Lo crítico para el operador (parada de emergencia) no pasa por acá.
+//
+// Una cubeta llena equivale a una que no existe, así que periódicamente se
+// borran las que ya se rellenaron: la memoria queda acotada por los
+// clientes activos en los últimos segundos.
+
+enum class ClaseTrafico : uint8_t {
+    MOVIMIENTO,     // RPCs que mueven el brazo o encolan G-code
+    ESTADO,         // sondeos de estado (getEstado, getHistory, ping, health)
+    ESTATICO,       // HTML, JS, CSS, imágenes
+    OTRO,           // login, administración, consultas, subidas
+    CANTIDAD
+};
+
+struct PresupuestoTasa {
+    double porSegundo;
+    double rafaga;
+};
+
+struct ResultadoAdmision {
+    bool admitida = true;
+    int64_t reintentarMs = 0;       // cuándo habrá ficha en la cubeta más vacía
+};
+
+struct EstadisticasLimitador {
+    static constexpr size_t kClases = static_cast<size_t>(ClaseTrafico::CANTIDAD);
+    std::array<uint64_t, kClases> admitidas{};
+    std::array<uint64_t, kClases> rechazadas{};
+    uint64_t rechazadasPorIp = 0;
+    uint64_t rechazadasPorUsuario = 0;
+    uint64_t exentas = 0;
+    size_t cubetas = 0;
+};
+
+class LimitadorTasa {
+public:
+    static constexpr size_t kClases = EstadisticasLimitador::kClases;
+    static constexpr int64_t kPurgaMs = 10000;
+
+    LimitadorTasa();
+
+    // Consume una ficha de la IP y otra del usuario (si no está vacío)
+    ResultadoAdmision admitir(ClaseTrafico clase, const std::string& ip, const std::string& usuario,
+                              int64_t ahoraMs);
+    void registrarExenta() { exentas.fetch_add(1, std::memory_order_relaxed); }
+
+    void fijarPresupuesto(ClaseTrafico clase, PresupuestoTasa p);
+    PresupuestoTasa presupuesto(ClaseTrafico clase) const;
+    EstadisticasLimitador estadisticas() const;
+
+    static const char* nombreClase(ClaseTrafico clase);
+
+private:
+    struct Cubeta {
+        double fichas = 0;
+        int64_t ultimoMs = 0;
+    };
+
+    mutable std::mutex mtx;
+    std::array<PresupuestoTasa, kClases> presupuestos;
+    // Clave: clase + 'i'/'u' + IP o usuario
+    std::unordered_map<std::string, Cubeta> cubetas;
+    int64_t ultimaPurgaMs = 0;
+    std::array<uint64_t, kClases> admitidas{}, rechazadas{};
+    uint64_t rechazadasPorIp = 0, rechazadasPorUsuario = 0;
+    std::atomic<uint64_t> exentas{0};
+
+    Cubeta& cubeta(ClaseTrafico clase, char tipo, const std::string& id, int64_t ahoraMs);
+    void purgar(int64_t ahoraMs);
+};
+
+// Instancia global usable desde los distintos módulos
+extern LimitadorTasa limitadorTasa;
+
+#endif // LIMITADOR_TASA_H
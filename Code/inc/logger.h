@@ -1,12 +1,55 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
 #include <string>
+#include <thread>
+
+#include "cola_mpsc.h"
+#include "registro_log.h"
+
+// Registro asíncrono en segmentos binarios (formato en registro_log.h).
+// logRequest/logEvent sólo arman un RegistroLog (marca de tiempo en ms,
+// sin formatear nada) y lo encolan en una cola sin bloqueo; un único hilo
+// escritor lo codifica y escribe por lotes en <base>.blog: en cuanto hay
+// kLoteBytes pendientes o cada kPeriodoFlushMs, lo que ocurra antes. Si
+// la cola está llena el productor despierta al escritor y reintenta
+// durante kEsperaMaxUs (contrapresión); pasado ese tiempo el registro se
+// descarta y se cuenta, nunca se bloquea indefinidamente.
+//
+// El segmento activo rota al pasar kMaxSegmentoBytes o kMaxSegmentoS y
+// queda como <base>-AAAAMMDD-HHMMSS.blog; otro hilo lo comprime a .gz en
+// segundo plano. `bin/decodificar_log` los pasa a CSV o JSON.
+
+struct EstadisticasLogger {
+    uint64_t encoladas = 0;
+    uint64_t escritas = 0;
+    uint64_t descartadas = 0;
+    uint64_t esperas = 0;           // encolados que tuvieron que esperar lugar
+    uint64_t lotes = 0;             // write() hechos
+    uint64_t bytes = 0;
+    uint64_t rotaciones = 0;
+    uint64_t comprimidos = 0;
+};
 
 class Logger {
 public:
-    explicit Logger(const std::string& path = "logs/server_log.csv");
+    static constexpr size_t kCapacidadCola = 1u << 13;
+    static constexpr size_t kLoteBytes = 64 * 1024;
+    static constexpr int kPeriodoFlushMs = 200;
+    static constexpr int kEsperaMaxUs = 2000;
+    static constexpr uint64_t kMaxSegmentoBytes = 8u << 20;
+    static constexpr int64_t kMaxSegmentoS = 3600;
+
+    explicit Logger(const std::string& base = "logs/server_log");
     ~Logger();
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
 
     // Registra una petición HTTP
     // detail: texto con método y ruta
@@ -19,11 +62,47 @@ public:
     // Registra un evento general
     // module: módulo que genera el evento (ej. "server", "rpc", "auth")
     // message: detalle del evento
-    void logEvent(const std::string& module, const std::string& message);
+    // user: usuario involucrado, si lo hay
+    void logEvent(const std::string& module, const std::string& message, const std::string& user = "");
+
+    // Escribe lo pendiente y espera a que esté en el archivo
+    void flush();
+    EstadisticasLogger estadisticas() const;
+    const std::string& rutaBase() const { return base; }
+    std::string rutaActiva() const { return base + ".blog"; }
 
 private:
-    std::string filepath;
-    void ensureLogFile();
+    std::string base;
+    int fd = -1;
+    registro_log::Codificador codificador;  // sólo lo usa el escritor
+    int64_t inicioSegmentoMs = 0;
+    uint64_t bytesSegmento = 0;
+
+    ColaMpsc<RegistroLog> cola{kCapacidadCola};
+    std::atomic<int64_t> bytesPendientes{0};     // aproximado; puede quedar negativo un instante
+    std::atomic<uint64_t> encoladas{0}, escritas{0}, descartadas{0}, esperas{0}, lotes{0}, bytes{0},
+        rotaciones{0}, comprimidos{0};
+
+    std::thread escritor;
+    std::mutex mtxEscritor;
+    std::condition_variable cvEscritor;     // despierta al escritor
+    std::condition_variable cvVaciado;      // avisa a flush()
+    bool parar = false;
+    uint64_t pedidosFlush = 0, flushHechos = 0;
+
+    std::thread compresor;
+    std::mutex mtxCompresor;
+    std::condition_variable cvCompresor;
+    std::deque<std::string> porComprimir;
+    bool pararCompresor = false;
+
+    bool abrirSegmento(int64_t ms);
+    void rotar();
+    void archivarActivo();
+    void encolar(RegistroLog&& r, size_t largo);
+    void despertar();
+    void bucleEscritor();
+    void bucleCompresor();
 };
 
 // Instancia global usable desde los distintos módulos
@@ -3,22 +3,42 @@
 #define LOGIN_H
 
 #include <sqlite3.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <optional>
 #include <string>
-#include <random>
 #include <iostream>
-#include <unordered_map>
-#include <mutex>
+
+#include "almacen_sesiones.h"
+#include "histograma_latencia.h"
+#include "pool_hilos.h"
+#include "pool_sqlite.h"
+
+struct EstadisticasAuth {
+    uint64_t exitos = 0;
+    uint64_t fallos = 0;            // usuario o contraseña incorrectos
+    uint64_t errores = 0;           // base no disponible o error de SQLite
+    uint64_t rechazados = 0;        // pool de autenticación lleno
+    uint64_t migrados = 0;          // hashes rehechos (texto plano heredado o costo viejo)
+    size_t conexiones = 0;
+    unsigned hilos = 0;
+    size_t pendientes = 0;          // logins esperando un hilo
+    uint32_t iteraciones = 0;       // costo PBKDF2 actual
+    ResumenLatencia latencia;       // de authenticate() completo
+};
 
 class Login {
 private:
-    sqlite3* db = nullptr;
-
-    std::string generateToken() {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<> dis(1000, 9999);
-        return std::to_string(dis(gen));
-    }
+    // Varias conexiones: logins concurrentes no se serializan en una sola
+    PoolSqlite pool{"users.sqlite3", 4};
+    HistogramaLatencia latencias;
+    std::atomic<uint64_t> exitos{0}, fallos{0}, errores{0}, rechazados{0}, migrados{0};
+    std::atomic<uint32_t> iteraciones;
+    AlmacenSesiones sesiones;
+    // Último miembro: se destruye primero y termina los logins en curso
+    // mientras lo demás sigue vivo
+    PoolHilos trabajadores;
 
 public:
     struct AuthResult {
@@ -28,15 +48,34 @@ public:
         std::string message;
     };
 
+    // Logins que pueden esperar un hilo; más allá se rechazan (servidor ocupado)
+    static constexpr size_t kMaxPendientes = 32;
+
     Login();
     ~Login();
 
     bool isConnected() const;
+    // Bloquea durante la derivación PBKDF2 (decenas de ms)
     AuthResult authenticate(const std::string& username, const std::string& password);
-    // Devuelve el nombre de usuario asociado a un token activo, o cadena vacía
-    std::string usernameForToken(const std::string& token);
-    // Devuelve el privilegio asociado a un token activo, o cadena vacía
-    std::string privilegeForToken(const std::string& token);
+    // authenticate() en el pool de autenticación; `listo` se llama desde ese
+    // hilo. false (y `listo` no se llama) si ya hay kMaxPendientes esperando.
+    bool authenticateAsync(const std::string& username, const std::string& password,
+                           std::function<void(const AuthResult&)> listo);
+    // Costo de los hashes nuevos; los existentes se rehacen en su próximo login
+    void fijarIteraciones(uint32_t n);
+    uint32_t iteracionesActuales() const { return iteraciones.load(std::memory_order_relaxed); }
+    EstadisticasAuth estadisticas() const;
+    EstadisticasSesiones estadisticasSesiones() const { return sesiones.estadisticas(); }
+    // Usuario y privilegio de un token activo (una sola búsqueda); vacío si no existe o venció
+    std::optional<SesionActiva> resolverSesion(const std::string& token);
+    // Igual pero sin renovar la inactividad del token
+    std::optional<SesionActiva> consultarSesion(const std::string& token) const;
+    // Logout: el token deja de valer y no se restaura al reiniciar
+    bool cerrarSesion(const std::string& token);
+    // Vuelve a dar de alta un token recuperado del diario de estado
+    // creadaMs: hora de creación en reloj de pared, tal como quedó en el diario
+    void restaurarSesion(const std::string& token, const std::string& username, const std::string& privilege,
+                         int64_t creadaMs);
 };
 
 #endif
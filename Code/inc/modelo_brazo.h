@@ -0,0 +1,82 @@
+#ifndef MODELO_BRAZO_H
+#define MODELO_BRAZO_H
+
+#include <cmath>
+
+// Constantes y límites del brazo RRR tal como los define el firmware
+// (Firmware lu/config.h). Si se recalibra el firmware hay que actualizarlas
+// acá también para que las estimaciones y validaciones del host coincidan.
+namespace brazo {
+
+constexpr double kPi = 3.14159265358979323846;
+
+constexpr float kLargoBrazoInferior = 120.0f;  // LOW_SHANK_LENGTH
+constexpr float kLargoBrazoSuperior = 120.0f;  // HIGH_SHANK_LENGTH
+constexpr float kOffsetEfector = 50.0f;        // END_EFFECTOR_OFFSET
+
+constexpr float kInicialX = 0.0f;                                  // INITIAL_X
+constexpr float kInicialY = kLargoBrazoSuperior + kOffsetEfector;  // INITIAL_Y
+constexpr float kInicialZ = kLargoBrazoInferior;                   // INITIAL_Z
+constexpr float kInicialE = 0.0f;                                  // INITIAL_E0
+
+constexpr float kZMin = -115.0f;                       // Z_MIN
+constexpr float kZMax = kLargoBrazoInferior + 30.0f;   // Z_MAX
+constexpr float kLargoRiel = 200.0f;                   // RAIL_LENGTH
+constexpr double kCosAnguloMin = 0.791436948;          // SHANKS_MIN_ANGLE_COS
+constexpr double kCosAnguloMax = -0.774944489;         // SHANKS_MAX_ANGLE_COS
+
+// SPEED_PROFILE
+enum class PerfilVelocidad { PLANO = 0, ARCTAN = 1, COSENO = 2 };
+constexpr PerfilVelocidad kPerfilFirmware = PerfilVelocidad::COSENO;
+
+constexpr int kPasosGarra = 1200;          // BYJ_GRIP_STEPS, delay(1) por paso
+constexpr double kSegundosHomeSimulado = 3.0;  // delay(3000) de G28 en SIMULATION
+constexpr int kBaudios = 19200;            // BAUD
+
+// F en mm/s (Interpolation::setInterpolation: v = av). Por debajo del
+// mínimo el firmware ignora F y usa sqrt(dist)*10; el máximo es el tope del host.
+constexpr float kFeedMinimo = 5.0f;
+constexpr float kFeedMaximo = 3000.0f;
+
+inline double radioCuadrado(double cosAngulo) {
+    const double a = kLargoBrazoInferior, b = kLargoBrazoSuperior;
+    return a * a + b * b - 2.0 * a * b * cosAngulo;
+}
+
+// Réplica de Interpolation::isAllowedPosition (incluye el caso degenerado
+// x = y = 0, que el firmware rechaza por la división por cero).
+inline bool dentroDelEspacio(float x, float y, float z, float e = 0.0f) {
+    const double rrotEe = std::hypot(static_cast<double>(x), static_cast<double>(y));
+    const double rrot = rrotEe - kOffsetEfector;
+    const double rrotX = rrot * (y / rrotEe);
+    const double rrotY = rrot * (x / rrotEe);
+    const double modulo2 = rrotX * rrotX + rrotY * rrotY + static_cast<double>(z) * z;
+    return modulo2 <= radioCuadrado(kCosAnguloMax) && modulo2 >= radioCuadrado(kCosAnguloMin) &&
+           z >= kZMin && z <= kZMax && e <= kLargoRiel;
+}
+
+// Réplica de RobotGeometry::calculateGrad: ángulos de rotación, brazo
+// inferior y brazo superior (rad) para una posición cartesiana. Devuelve
+// false si la posición no tiene solución (algún ángulo resulta NaN).
+inline bool cinematicaInversa(float x, float y, float z, double& rot, double& low, double& high) {
+    const double a = kLargoBrazoInferior, b = kLargoBrazoSuperior;
+    const double rrotEe = std::hypot(static_cast<double>(x), static_cast<double>(y));
+    const double rrot = rrotEe - kOffsetEfector;
+    const double rside = std::hypot(rrot, static_cast<double>(z));
+    const double rside2 = rside * rside;
+
+    rot = std::asin(x / rrotEe);
+    high = kPi - std::acos((a * a + b * b - rside2) / (2.0 * a * b));
+    const double alfa = std::acos((a * a - b * b + rside2) / (2.0 * a * rside));
+    if (z > 0) {
+        low = std::acos(z / rside) - alfa;
+    } else {
+        low = kPi - std::asin(rrot / rside) - alfa;
+    }
+    high = high + low;
+    return std::isfinite(rot) && std::isfinite(low) && std::isfinite(high);
+}
+
+} // namespace brazo
+
+#endif // MODELO_BRAZO_H
@@ -0,0 +1,47 @@
+#ifndef OPTIMIZADOR_GCODE_H
+#define OPTIMIZADOR_GCODE_H
+
+#include "estimador_trabajo.h"
+#include "programa_gcode.h"
+
+#include <cstddef>
+
+// Pasada de optimización sobre el IR de programas aprendidos o subidos.
+// Simula el estado modal (modo abs/rel, posición, motores, garra) y elimina
+// lo que no cambia nada en el brazo: movimientos nulos, G90/G91/M17/M18/M3/M5
+// redundantes, pares M3/M5 consecutivos que se cancelan y puntos intermedios
+// de segmentos colineales.
+
+struct OpcionesOptimizador {
+    float toleranciaColineal = 0.05f;  // mm de desvío máximo al fusionar segmentos
+    bool fusionarColineales = true;
+    // Los programas aprendidos no empiezan con G90: se asume el modo
+    // absoluto con el que arranca el firmware (un G90/G91 explícito al
+    // inicio se conserva igual).
+    bool asumirAbsoluto = true;
+    OpcionesEstimador estimador;    // modelo usado para informar el tiempo ahorrado
+};
+
+struct ReporteOptimizacion {
+    size_t lineasOriginales = 0;
+    size_t lineasResultantes = 0;
+    size_t movimientosNulos = 0;
+    size_t modosRedundantes = 0;
+    size_t motoresRedundantes = 0;
+    size_t garraRedundante = 0;
+    size_t segmentosFusionados = 0;
+    double segundosAntes = 0.0;
+    double segundosDespues = 0.0;
+
+    size_t lineasAhorradas() const { return lineasOriginales - lineasResultantes; }
+    double segundosAhorrados() const { return segundosAntes - segundosDespues; }
+};
+
+namespace gcode {
+
+ProgramaGcode optimizar(const ProgramaGcode& programa, const OpcionesOptimizador& opciones,
+                        ReporteOptimizacion& reporte);
+
+} // namespace gcode
+
+#endif // OPTIMIZADOR_GCODE_H
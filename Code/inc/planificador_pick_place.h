@@ -0,0 +1,46 @@
+#ifndef PLANIFICADOR_PICK_PLACE_H
+#define PLANIFICADOR_PICK_PLACE_H
+
+#include "estimador_trabajo.h"
+#include "programa_gcode.h"
+
+#include <cstddef>
+
+// Reordenamiento de bloques pick-and-place independientes.
+// Un bloque es una secuencia "G1 … M3 … G1 … M5" en modo absoluto cuyo
+// primer movimiento fija X, Y y Z, de modo que su comportamiento no depende
+// de dónde quedó el brazo. Las corridas de bloques consecutivos se
+// reordenan (vecino más cercano + 2-opt) minimizando el recorrido en el
+// espacio articular entre el final de un bloque y el inicio del siguiente;
+// todo lo que no forma parte de un bloque actúa como barrera y queda fijo.
+
+struct OpcionesPlanificador {
+    bool asumirAbsoluto = true;     // igual que OpcionesOptimizador
+    int maxPasadas2Opt = 50;
+    OpcionesEstimador estimador;    // modelo usado para informar el tiempo ahorrado
+};
+
+struct ReportePlanificacion {
+    size_t bloques = 0;             // bloques detectados
+    size_t corridas = 0;            // grupos de bloques reordenables
+    size_t bloquesMovidos = 0;      // bloques que cambiaron de posición
+    double costoOriginal = 0.0;     // rad, suma del máximo desplazamiento articular
+    double costoNuevo = 0.0;
+    double segundosAntes = 0.0;
+    double segundosDespues = 0.0;
+
+    double segundosAhorrados() const { return segundosAntes - segundosDespues; }
+};
+
+namespace gcode {
+
+// Costo articular entre dos posiciones cartesianas: el mayor giro que debe
+// hacer alguna de las tres articulaciones (se mueven en simultáneo).
+double costoArticular(const float desde[3], const float hasta[3]);
+
+ProgramaGcode planificarPickPlace(const ProgramaGcode& programa, const OpcionesPlanificador& opciones,
+                                  ReportePlanificacion& reporte);
+
+} // namespace gcode
+
+#endif // PLANIFICADOR_PICK_PLACE_H
@@ -0,0 +1,44 @@
+#ifndef POOL_HILOS_H
+#define POOL_HILOS_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pool de hilos fijo con una cola de tareas. Los hilos se crean una sola
+// vez (no por solicitud) y quedan dormidos mientras no hay trabajo.
+class PoolHilos {
+public:
+    // 0: tantos hilos como núcleos
+    explicit PoolHilos(unsigned hilos = 0);
+    ~PoolHilos();
+    PoolHilos(const PoolHilos&) = delete;
+    PoolHilos& operator=(const PoolHilos&) = delete;
+
+    void encolar(std::function<void()> tarea);
+    // Como encolar, pero no encola (y devuelve false) si ya hay
+    // maxPendientes tareas esperando un hilo
+    bool intentarEncolar(std::function<void()> tarea, size_t maxPendientes);
+    size_t pendientes() const;
+    // Ejecuta tarea(i) para i en [0, n) repartido entre los hilos y espera
+    // a que terminen todas. El hilo que llama también trabaja, así que se
+    // puede usar aunque el pool esté ocupado.
+    void paraCada(size_t n, const std::function<void(size_t)>& tarea);
+
+    unsigned tamano() const { return static_cast<unsigned>(hilos.size()); }
+
+private:
+    std::vector<std::thread> hilos;
+    std::deque<std::function<void()>> cola;
+    mutable std::mutex mtx;
+    std::condition_variable cv;
+    bool detener = false;
+
+    void bucle();
+};
+
+#endif // POOL_HILOS_H
@@ -0,0 +1,84 @@
+#ifndef POOL_SQLITE_H
+#define POOL_SQLITE_H
+
+#include <sqlite3.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Conexiones SQLite reutilizables para una misma base. Cada conexión se
+// abre en modo WAL (lectores y un escritor no se bloquean entre sí), con
+// busy_timeout y synchronous=NORMAL, y la usa un solo hilo a la vez: se
+// toma con tomar() y vuelve al pool al destruir el Prestamo. Las sentencias
+// preparadas quedan en caché por conexión (por texto SQL) y se reinician al
+// soltar la Sentencia, así no queda una transacción de lectura abierta.
+//
+//   auto c = pool.tomar();
+//   auto st = c.sentencia("SELECT ... WHERE x = ?;");
+//   sqlite3_bind_text(st, 1, ...);
+//   while (sqlite3_step(st) == SQLITE_ROW) ...
+
+class PoolSqlite {
+    struct Conexion {
+        sqlite3* db = nullptr;
+        std::unordered_map<std::string, sqlite3_stmt*> sentencias;
+    };
+
+public:
+    class Sentencia {
+        sqlite3_stmt* st = nullptr;
+    public:
+        explicit Sentencia(sqlite3_stmt* s = nullptr) : st(s) {}
+        Sentencia(Sentencia&& o) noexcept : st(o.st) { o.st = nullptr; }
+        Sentencia& operator=(Sentencia&&) = delete;
+        ~Sentencia() {
+            if (st) {
+                sqlite3_reset(st);
+                sqlite3_clear_bindings(st);
+            }
+        }
+        operator sqlite3_stmt*() const { return st; }
+        explicit operator bool() const { return st != nullptr; }
+    };
+
+    class Prestamo {
+        PoolSqlite* pool = nullptr;
+        Conexion* c = nullptr;
+    public:
+        Prestamo(PoolSqlite* p, Conexion* con) : pool(p), c(con) {}
+        Prestamo(Prestamo&& o) noexcept : pool(o.pool), c(o.c) { o.c = nullptr; }
+        Prestamo& operator=(Prestamo&&) = delete;
+        ~Prestamo() { if (c) pool->devolver(c); }
+        sqlite3* db() const { return c ? c->db : nullptr; }
+        // Preparada una vez por conexión; vacía si el SQL no compila
+        Sentencia sentencia(const std::string& sql);
+    };
+
+    explicit PoolSqlite(std::string ruta, size_t conexiones = 4, int busyTimeoutMs = 2000);
+    ~PoolSqlite();
+    PoolSqlite(const PoolSqlite&) = delete;
+    PoolSqlite& operator=(const PoolSqlite&) = delete;
+
+    bool abierto() const { return !conexiones.empty(); }
+    const std::string& ultimoError() const { return error; }
+    size_t tamano() const { return conexiones.size(); }
+    // Espera a que haya una conexión libre
+    Prestamo tomar();
+
+private:
+    std::string ruta;
+    std::string error;
+    std::vector<std::unique_ptr<Conexion>> conexiones;
+    std::vector<Conexion*> libres;
+    std::mutex mtx;
+    std::condition_variable cv;
+
+    void devolver(Conexion* c);
+};
+
+#endif // POOL_SQLITE_H
@@ -0,0 +1,151 @@
+#ifndef PROGRAMA_GCODE_H
+#define PROGRAMA_GCODE_H
+
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Representación intermedia (IR) de un programa G-code ya tokenizado.
+// Cada línea útil del archivo se compila una sola vez a una instrucción
+// de tamaño fijo con opcode, operandos tipados y resultado de validación.
+
+enum class OpGcode : uint8_t {
+    DESCONOCIDO = 0,
+    MOVER,          // G0 / G1
+    PAUSA,          // G4
+    HOME,           // G28
+    ABSOLUTO,       // G90
+    RELATIVO,       // G91
+    OFFSET,         // G92
+    BOMBA_ON,       // M1
+    BOMBA_OFF,      // M2
+    GARRA_ON,       // M3
+    GARRA_OFF,      // M5
+    LASER_ON,       // M6
+    LASER_OFF,      // M7
+    MOTORES_ON,     // M17
+    MOTORES_OFF,    // M18
+    VENTILADOR_ON,  // M106
+    VENTILADOR_OFF, // M107
+    POSICION,       // M114
+    ENDSTOPS,       // M119
+    // Sólo del host: RobotControllerSimple las segmenta en G1 al enviarlas
+    ARCO_HORARIO,   // G2
+    ARCO_ANTIHORARIO // G3
+};
+
+enum class ValidezGcode : uint8_t {
+    VALIDA = 0,
+    NO_SOPORTADA,   // sintaxis correcta pero el firmware no la reconoce
+    SINTAXIS        // línea mal formada
+};
+
+// Índices de operandos dentro de InstruccionGcode::valores
+enum CampoGcode : uint8_t {
+    CAMPO_X = 0,
+    CAMPO_Y,
+    CAMPO_Z,
+    CAMPO_E,
+    CAMPO_F,
+    CAMPO_S,
+    CAMPO_I,        // centro del arco relativo al inicio (G2/G3)
+    CAMPO_J,
+    CAMPO_R,        // radio del arco (G2/G3)
+    NUM_CAMPOS
+};
+
+struct InstruccionGcode {
+    OpGcode op = OpGcode::DESCONOCIDO;
+    ValidezGcode validez = ValidezGcode::VALIDA;
+    char letra = 0;             // 'G' o 'M'
+    uint16_t numero = 0;
+    uint16_t campos = 0;        // máscara de bits (1 << CampoGcode)
+    uint32_t linea = 0;         // número de línea en el archivo fuente (1-based)
+    float valores[NUM_CAMPOS] = {};
+
+    bool tiene(CampoGcode c) const { return (campos & (1u << c)) != 0; }
+    float valor(CampoGcode c) const { return valores[c]; }
+    void fijar(CampoGcode c, float v) { valores[c] = v; campos |= static_cast<uint16_t>(1u << c); }
+    bool valida() const { return validez == ValidezGcode::VALIDA; }
+    bool esArco() const { return op == OpGcode::ARCO_HORARIO || op == OpGcode::ARCO_ANTIHORARIO; }
+};
+
+struct ProgramaGcode {
+    uint64_t hash = 0;              // hash del contenido fuente
+    uint32_t lineasFuente = 0;      // líneas totales leídas (incluye vacías)
+    uint32_t invalidas = 0;         // instrucciones con validez != VALIDA
+    std::vector<InstruccionGcode> instrucciones;
+};
+
+namespace gcode {
+
+// FNV-1a de 64 bits; suficiente para indexar la caché de programas.
+// Admite cálculo incremental pasando el hash parcial como semilla.
+constexpr uint64_t kSemillaHash = 1469598103934665603ULL;
+uint64_t hashContenido(std::string_view texto, uint64_t semilla = kSemillaHash);
+std::string hashHex(uint64_t hash);
+
+// Compila una línea. Devuelve false si la línea no contiene instrucción
+// (vacía o sólo comentario); en ese caso `out` no se modifica.
+bool compilarLinea(std::string_view linea, uint32_t numeroLinea, InstruccionGcode& out);
+ProgramaGcode compilar(std::string_view texto);
+
+// Reconstruye el texto canónico que entiende Command::processMessage.
+std::string aTexto(const InstruccionGcode& ins);
+// Escribe el programa como texto G-code (una instrucción por línea).
+bool escribirTexto(const ProgramaGcode& programa, const std::string& ruta);
+const char* describirValidez(ValidezGcode v);
+
+bool serializar(const ProgramaGcode& programa, std::ostream& out);
+bool deserializar(std::istream& in, ProgramaGcode& programa);
+
+} // namespace gcode
+
+// Caché de programas compilados indexada por hash de contenido.
+// Mantiene los programas en memoria y una copia binaria en disco
+// (cache/gcode/<hash>.gir) para sobrevivir reinicios.
+class CacheGcode {
+    struct FirmaArchivo {
+        uint64_t tamano;
+        int64_t modificado;     // mtime en ns
+        uint64_t hash;
+    };
+
+    mutable std::mutex mtx;
+    std::unordered_map<uint64_t, std::shared_ptr<const ProgramaGcode>> programas;
+    // ruta -> (tamaño, mtime, hash): permite encontrar el IR sin releer el archivo
+    std::unordered_map<std::string, FirmaArchivo> indiceArchivos;
+    std::string directorio;
+    std::function<void(const ProgramaGcode&)> avisoCompilado;  // bajo mtx
+
+public:
+    explicit CacheGcode(std::string dir = "cache/gcode");
+
+    // Lee el archivo, calcula su hash y devuelve el IR (compilándolo sólo
+    // si no estaba en caché). nullptr si el archivo no se puede leer.
+    std::shared_ptr<const ProgramaGcode> obtener(const std::string& ruta);
+    std::shared_ptr<const ProgramaGcode> buscar(uint64_t hash);
+    // Búsqueda rápida por ruta: sólo stat(), sin leer el contenido.
+    // nullptr si el archivo cambió desde que se registró o no está indexado.
+    std::shared_ptr<const ProgramaGcode> buscarPorArchivo(const std::string& ruta);
+    void guardar(std::shared_ptr<const ProgramaGcode> programa);
+    void registrarArchivo(const std::string& ruta, uint64_t hash);
+    // Se llama (fuera del lock) cada vez que obtener() compila un programa
+    // que no estaba en caché; vacío para dejar de avisar
+    void alCompilar(std::function<void(const ProgramaGcode&)> fn);
+
+private:
+    std::string rutaBinaria(uint64_t hash) const;
+    static bool firmaActual(const std::string& ruta, uint64_t& tamano, int64_t& modificado);
+};
+
+// Instancia global usable desde los distintos módulos
+extern CacheGcode cacheGcode;
+
+#endif // PROGRAMA_GCODE_H
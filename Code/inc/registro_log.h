@@ -0,0 +1,122 @@
+#ifndef REGISTRO_LOG_H
+#define REGISTRO_LOG_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Formato binario de los segmentos de log (logs/server_log*.blog[.gz]).
+//
+//   cabecera: "BLG1" varint(msBase)              msBase = epoch en ms
+//   registro: u8 tipo, luego según el tipo
+//     CADENA    varint(id) varint(largo) bytes   alta en la tabla del segmento
+//     PETICION  zz(dt) id(detalle) id(usuario) id(nodo) varint(código)
+//     EVENTO    zz(dt) id(módulo) id(usuario) varint(largo) mensaje
+//
+// dt es la diferencia en ms con el registro anterior (zigzag: el reloj
+// puede retroceder). Módulos, usuarios, nodos y rutas se repiten mucho,
+// así que se guardan una vez por segmento y después se referencian por
+// id; cada segmento tiene su propia tabla y se puede leer solo. Un final
+// cortado (caída a mitad de un write) se ignora al leer.
+
+struct RegistroLog {
+    enum Categoria : uint8_t { PETICION = 2, EVENTO = 3 };
+    Categoria categoria = EVENTO;
+    int64_t ms = 0;                 // epoch en ms
+    std::string detalle;            // método y ruta (peticiones)
+    std::string usuario;
+    std::string nodo;               // IP de origen (peticiones)
+    int codigo = 0;                 // código HTTP (peticiones)
+    std::string modulo;             // eventos
+    std::string mensaje;            // eventos
+};
+
+namespace registro_log {
+
+constexpr uint8_t kCadena = 1;
+
+std::string cabecera(int64_t msBase);
+
+class Codificador {
+    std::unordered_map<std::string, uint32_t> tabla;
+    int64_t ultimoMs = 0;
+
+public:
+    // Estado antes de un lote: si el lote no llega al archivo, deshacer()
+    // olvida las cadenas que dio de alta y el último ms
+    struct Marca {
+        size_t cadenas = 0;
+        int64_t ultimoMs = 0;
+    };
+
+    explicit Codificador(int64_t msBase = 0) : ultimoMs(msBase) {}
+    void codificar(const RegistroLog& r, std::string& out);
+    size_t cadenas() const { return tabla.size(); }
+    Marca marca() const { return {tabla.size(), ultimoMs}; }
+    void deshacer(const Marca& m);
+
+private:
+    uint32_t id(const std::string& s, std::string& out);
+};
+
+// Registro tal como está en el segmento: cadenas por id de la tabla.
+// Permite filtrar comparando enteros y copiar sólo lo que se devuelve.
+struct RegistroCrudo {
+    static constexpr uint32_t kSinId = UINT32_MAX;
+    RegistroLog::Categoria categoria = RegistroLog::EVENTO;
+    int64_t ms = 0;
+    uint32_t detalle = kSinId, usuario = kSinId, nodo = kSinId, modulo = kSinId;
+    int codigo = 0;
+    std::string_view mensaje;       // apunta dentro del buffer del segmento
+};
+
+// Lectura secuencial que se puede retomar: con la tabla completa del
+// segmento y el ms del registro anterior se puede empezar en cualquier
+// desplazamiento conocido (las altas de cadenas ya vistas se saltan).
+class Lector {
+    std::string_view datos;
+    std::vector<std::string>* tabla;
+    size_t pos = 0;
+    int64_t ms = 0;
+
+public:
+    Lector(std::string_view datos, std::vector<std::string>& tabla) : datos(datos), tabla(&tabla) {}
+    // Valida la cabecera y se coloca en el primer registro
+    bool cabecera(int64_t* msBase = nullptr);
+    void posicionar(size_t desplazamiento, int64_t msPrevio) { pos = desplazamiento; ms = msPrevio; }
+    // Mismo estado sobre un buffer que creció (segmento activo)
+    void reemplazarDatos(std::string_view nuevos) { datos = nuevos; }
+    // false al final o ante un registro cortado/dañado; la posición queda
+    // al principio de ese registro
+    bool siguiente(RegistroCrudo& r);
+    void materializar(const RegistroCrudo& c, RegistroLog& r) const;
+    size_t posicion() const { return pos; }
+    int64_t ultimoMs() const { return ms; }
+};
+
+// Recorre un segmento (plano o .gz). `visitar` devuelve false para cortar.
+// false si el archivo no se puede abrir o no es un segmento.
+bool leerSegmento(const std::string& ruta, const std::function<bool(const RegistroLog&)>& visitar,
+                  int64_t* msBase = nullptr);
+// Mismo recorrido sobre un segmento ya en memoria
+bool recorrer(std::string_view datos, const std::function<bool(const RegistroLog&)>& visitar,
+              int64_t* msBase = nullptr);
+
+// Contenido descomprimido de un segmento (plano o .gz); false si no se puede leer
+bool cargarSegmento(const std::string& ruta, std::string& datos);
+
+// Fila CSV (mismas columnas que el server_log.csv de antes) o JSON
+std::string cabeceraCsv();
+std::string aCsv(const RegistroLog& r);
+std::string aJson(const RegistroLog& r);
+std::string formatoIso(int64_t ms);
+
+// Comprime `origen` a `origen`.gz (tmp + rename) y borra el original
+bool comprimir(const std::string& origen);
+
+} // namespace registro_log
+
+#endif // REGISTRO_LOG_H
@@ -0,0 +1,30 @@
+#ifndef RESPUESTA_FIRMWARE_H
+#define RESPUESTA_FIRMWARE_H
+
+#include <string_view>
+
+// Interpretación de las líneas que imprime el Logger del firmware
+// ("INFO: ..." / "ERROR: ...") en respuesta a cada comando. Las posiciones
+// vienen en coordenadas de programa (el firmware ya descuenta el offset de G92).
+
+struct RespuestaFirmware {
+    bool ok = false;                // "OK" final de executeCommand
+    bool error = false;             // alguna línea "ERROR: ..."
+    bool fueraDeEspacio = false;    // "ERROR: POINT IS OUTSIDE OF WORKSPACE"
+    bool tienePosicion = false;     // "INFO: CURRENT POSITION: [X:.. Y:.. Z:.. E:..]"
+    float posicion[4] = {};
+    bool tieneObjetivo = false;     // "INFO: LINEAR MOVE: [X:.. Y:.. Z:.. E:..]"
+    float objetivo[4] = {};
+    bool homing = false;            // "INFO: HOMING COMPLETE"
+    int modoAbs = -1;               // "ABSOLUTE MODE" / "RELATIVE MODE" (-1 = no informado)
+    int motores = -1;               // "MOTORS ENABLED" / "MOTORS DISABLED"
+    int garra = -1;                 // "GRIPPER ON" / "GRIPPER OFF"
+};
+
+namespace firmware {
+
+RespuestaFirmware interpretar(std::string_view texto);
+
+} // namespace firmware
+
+#endif // RESPUESTA_FIRMWARE_H
@@ -5,8 +5,15 @@
 #include "comunicacion_controlador_simple.h"
 #include "estado_robot.h"
 #include "aprendizaje.h"
+#include "arcos_gcode.h"
+#include "programa_gcode.h"
+#include "fotogramas_aprendizaje.h"
+#include <atomic>
+#include <condition_variable>
 #include <iostream>
+#include <mutex>
 #include <sstream>
+#include <thread>
 #include <algorithm> 
 
 class RobotControllerSimple {
@@ -14,16 +21,39 @@ private:
     ComunicacionControladorSimple& comm;
     EstadoRobot& estado;
     Aprendizaje* aprendizaje = nullptr;
-    void procesarRespuestaArduino(const std::string& respuesta);
+    // Modo y posición según lo enviado; los arcos se segmentan a partir de acá
+    PosicionModal modal;
+    OpcionesArco opcionesArco;
+    std::vector<InstruccionGcode> segmentosArco;
+    // El puerto serie se comparte con el hilo de sondeo (M114)
+    std::mutex mtxSerie;
+    std::thread hiloSondeo;
+    std::mutex mtxSondeo;
+    std::condition_variable cvSondeo;
+    bool detenerSondeoPedido = false;
+    std::atomic<int> periodoSondeoMs{0};
+    // Devuelve true si el firmware informó un punto fuera del espacio de trabajo
+    bool procesarRespuestaArduino(const std::string& cmd, const std::string& respuesta);
     void registrarAprendizaje(const std::string& cmd);
+    void ejecutarInstruccion(const InstruccionGcode& ins);
+    bool ejecutarArco(const InstruccionGcode& arco);
+    void enviar(const std::string& cmd);
+    void bucleSondeo(int periodoMs);
 
 public:
     RobotControllerSimple(ComunicacionControladorSimple& c, EstadoRobot& e)
         : comm(c), estado(e) {
         std::cout << "🤖 RobotControllerSimple inicializado" << std::endl;
     }
+    ~RobotControllerSimple() { detenerSondeo(); }
 
     void setAprendizaje(Aprendizaje* a) { aprendizaje = a; }
+    void setErrorCuerda(float mm) { opcionesArco.errorCuerda = mm; }
+
+    // Sondeo periódico de la posición real con M114 (0 = desactivado)
+    void iniciarSondeo(int periodoMs);
+    void detenerSondeo();
+    int periodoSondeo() const { return periodoSondeoMs.load(); }
 
     void mover(float x, float y, float z, float f, bool abs);
     void setAbs(bool abs);
@@ -32,7 +62,11 @@ public:
     void emergencia();
     void resetEmergencia();
     void ejecutarArchivo(const std::string& ruta);
+    void ejecutarPrograma(const ProgramaGcode& programa);
     void ejecutarComando(const std::string& cmd);
+    // Reproduce una grabación .teach a `opciones.velocidad`; con
+    // ejecutar = false sólo planifica y valida. No se graba en el aprendizaje.
+    ResultadoReproduccion reproducirGrabacion(const std::string& ruta, OpcionesReproduccion opciones, bool ejecutar);
 
 
     
@@ -21,6 +21,7 @@
 #include "aprendizaje.h"
 #include "administrador_sistema.h"
 #include "json.hpp"
+#include "limitador_tasa.h"
 
 using json = nlohmann::json;
 
@@ -71,11 +72,29 @@ public:
     std::string procesarRPC(const std::string& body, Login& login, RobotControllerSimple& robot,
                         EstadoRobot& estado, Aprendizaje& aprendizaje, AdministradorSistema& admin,
                         bool quiet = false);
+    // Lo que necesita el control de admisión antes de procesar un RPC
+    struct IdentidadRPC {
+        std::string metodo;
+        ClaseTrafico clase = ClaseTrafico::OTRO;
+        std::string usuario;            // del token; vacío si no hay o no vale
+        bool critica = false;           // se admite siempre (parada de emergencia)
+    };
+    IdentidadRPC identificarRPC(const std::string& body, Login& login);
+
+    // Si `body` es un login con credenciales lo verifica en el pool de
+    // autenticación y devuelve true: `responder` recibe la respuesta XML-RPC
+    // desde ese hilo (o enseguida si el pool está lleno). false: no es un
+    // login asíncrono, va por procesarRPC.
+    bool procesarLoginAsync(const std::string& body, Login& login,
+                            std::function<void(const std::string&)> responder);
     
     void press_enter(bool flag);
     void pause_sec(int s);
     void parseHttpRequest(const std::string& request, std::string& method, std::string& path);
 
 private:
+    bool extraerCredenciales(const std::string& body, std::string& user, std::string& pass);
+    std::string respuestaLogin(const Login::AuthResult& auth, const std::string& user);
+
     ServerState state;
 };
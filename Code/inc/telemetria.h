@@ -0,0 +1,86 @@
+#ifndef TELEMETRIA_H
+#define TELEMETRIA_H
+
+#include "estado_robot.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Historial de estado del robot en memoria fija. Cada cambio de
+// EstadoRobot entra como muestra cruda y además alimenta dos niveles
+// submuestreados (100 ms y 1 s: se conserva la última muestra de cada
+// intervalo, que se va reescribiendo mientras el intervalo sigue abierto).
+// Un único productor (el observador de EstadoRobot, que ya llega
+// serializado) y lectores sin bloqueo: cada casilla lleva su propio número
+// de secuencia y el lector descarta las que se pisaron mientras leía.
+
+struct MuestraTelemetria {
+    int64_t ms = 0;         // ms desde epoch (no decrece)
+    float x = 0, y = 0, z = 0, e = 0;
+    uint8_t flags = 0;      // ver kFlag*
+};
+
+enum class ResolucionTelemetria { CRUDA = 0, DECIMAS = 1, SEGUNDOS = 2 };
+
+class Telemetria {
+public:
+    static constexpr uint8_t kFlagMotores = 1u << 0;
+    static constexpr uint8_t kFlagGarra = 1u << 1;
+    static constexpr uint8_t kFlagAbsoluto = 1u << 2;
+    static constexpr uint8_t kFlagEmergencia = 1u << 3;
+    static constexpr uint8_t kFlagFueraDeEspacio = 1u << 4;
+
+    Telemetria();
+
+    // Sólo desde un productor a la vez
+    void registrar(const EstadoRobot::Snapshot& s);
+    void registrar(const MuestraTelemetria& m);
+
+    // Muestras con desdeMs <= ms <= hastaMs, en orden; si hay más de
+    // maxPuntos se diezma uniformemente (la última siempre se incluye).
+    std::vector<MuestraTelemetria> historial(int64_t desdeMs, int64_t hastaMs, ResolucionTelemetria r,
+                                             size_t maxPuntos) const;
+
+    static int64_t ahoraMs();
+
+private:
+    class Anillo {
+        struct Casilla {
+            std::atomic<uint64_t> secuencia{0};  // impar mientras se escribe
+            std::atomic<uint64_t> indice{0};     // posición absoluta de la muestra
+            std::atomic<int64_t> ms{0};
+            std::atomic<uint64_t> xy{0}, ze{0};
+            std::atomic<uint8_t> flags{0};
+        };
+        std::unique_ptr<Casilla[]> casillas;
+        size_t mascara;
+        std::atomic<uint64_t> cabeza{0};     // muestras escritas en total
+
+        bool leer(uint64_t indice, MuestraTelemetria& m) const;
+        void escribir(uint64_t indice, const MuestraTelemetria& m);
+
+    public:
+        explicit Anillo(size_t capacidadPotenciaDeDos);
+        void agregar(const MuestraTelemetria& m);
+        void reemplazarUltima(const MuestraTelemetria& m);
+        void rango(int64_t desdeMs, int64_t hastaMs, std::vector<MuestraTelemetria>& out) const;
+    };
+
+    struct Nivel {
+        int64_t periodoMs;
+        Anillo anillo;
+        int64_t intervalo = -1;     // intervalo abierto (sólo lo toca el productor)
+    };
+
+    Anillo crudas;
+    Nivel niveles[2];
+    int64_t ultimoMs = 0;
+};
+
+// Instancia global usable desde los distintos módulos
+extern Telemetria telemetria;
+
+#endif // TELEMETRIA_H
@@ -0,0 +1,77 @@
+#ifndef VALIDADOR_GCODE_H
+#define VALIDADOR_GCODE_H
+
+#include "arcos_gcode.h"
+#include "modelo_brazo.h"
+#include "pool_hilos.h"
+#include "programa_gcode.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Validación de un programa completo antes de aceptarlo (p. ej. al subir
+// un CSV), repartida en bloques de líneas sobre un pool de hilos:
+//  1. en paralelo: cada bloque compila sus líneas (sintaxis y comandos que
+//     reconoce executeCommand del firmware);
+//  2. en serie, sobre las instrucciones ya compiladas (sólo aritmética):
+//     numeración global y el estado (posición, G90/G91, offset de G92) con
+//     el que arranca cada bloque. Un arco se da por llegado a su destino;
+//  3. en paralelo: cada bloque recorre sus movimientos desde ese estado y
+//     verifica alcance (extremos y puntos intermedios de cada recta, arcos
+//     con la misma segmentación que al enviar) y límites de avance.
+// El reporte conserva todos los contadores pero sólo los primeros
+// `maxProblemas` detalles, ordenados por línea.
+
+enum class TipoProblema : uint8_t {
+    SINTAXIS = 0,
+    NO_SOPORTADA,
+    FUERA_DE_ESPACIO,
+    ARCO_INVALIDO,
+    AVANCE_FUERA_DE_RANGO,
+    NUM_TIPOS
+};
+
+struct ProblemaValidacion {
+    uint32_t linea = 0;         // línea del programa G-code (1-based)
+    TipoProblema tipo = TipoProblema::SINTAXIS;
+    std::string detalle;
+};
+
+struct OpcionesValidacion {
+    float feedMinimo = brazo::kFeedMinimo;     // mm/s
+    float feedMaximo = brazo::kFeedMaximo;
+    float muestreoMm = 5.0f;        // separación de los puntos verificados dentro de una recta
+    size_t bytesPorBloque = 256 * 1024;
+    size_t maxProblemas = 1000;
+    OpcionesArco arcos;
+};
+
+struct ReporteValidacion {
+    uint64_t lineas = 0;
+    uint64_t instrucciones = 0;
+    uint64_t movimientos = 0;
+    uint64_t conProblemas = 0;      // líneas con al menos un problema
+    uint64_t porTipo[static_cast<size_t>(TipoProblema::NUM_TIPOS)] = {};
+    std::vector<ProblemaValidacion> problemas;
+    bool truncado = false;          // hubo más problemas que maxProblemas
+    size_t bloques = 0;
+    unsigned hilos = 0;
+    double milisegundos = 0.0;
+
+    bool ok() const { return conProblemas == 0; }
+};
+
+namespace gcode {
+
+ReporteValidacion validar(std::string_view texto, const OpcionesValidacion& opciones = OpcionesValidacion{});
+bool validarArchivo(const std::string& ruta, const OpcionesValidacion& opciones, ReporteValidacion& reporte);
+const char* describirProblema(TipoProblema t);
+
+} // namespace gcode
+
+// Instancia global usable desde los distintos módulos
+extern PoolHilos poolValidacion;
+
+#endif // VALIDADOR_GCODE_H
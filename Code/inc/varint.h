@@ -0,0 +1,37 @@
+#ifndef VARINT_H
+#define VARINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Codificación de enteros en base 128 (7 bits por byte, el bit alto indica
+// que sigue otro byte) compartida por el registro binario y los fotogramas
+// de aprendizaje. Los deltas con signo pasan antes por zigzag para que los
+// valores pequeños negativos también ocupen un solo byte.
+inline void escribirVarint(std::string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+// Lee un varint desde buf[pos] y avanza pos. Devuelve false si el buffer se
+// corta a mitad de número o si el valor no entra en 64 bits.
+inline bool leerVarint(std::string_view buf, size_t& pos, uint64_t& v) {
+    v = 0;
+    for (int desplazamiento = 0; desplazamiento < 64; desplazamiento += 7) {
+        if (pos >= buf.size()) return false;
+        const uint8_t b = static_cast<uint8_t>(buf[pos++]);
+        v |= static_cast<uint64_t>(b & 0x7F) << desplazamiento;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+inline uint64_t zigzag(int64_t v) { return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63); }
+inline int64_t desZigzag(uint64_t v) { return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1); }
+
+#endif
@@ -1,4 +1,6 @@
 #include "administrador_sistema.h"
+#include "diario_estado.h"
+#include "consola.h"
 
 #include <fstream>
 #include <filesystem>
@@ -22,13 +24,13 @@ AdministradorSistema::AdministradorSistema(std::string storageFile)
 void AdministradorSistema::setRemoto(bool on) {
     std::lock_guard<std::mutex> lock(mtx);
     if (remotoHabilitado == on) {
-        std::cout << (on ? "🌐 Modo remoto ya estaba habilitado\n"
-                         : "🔒 Modo remoto ya estaba deshabilitado\n");
+        CONSOLA_DEBUG((on ? "🌐 Modo remoto ya estaba habilitado" : "🔒 Modo remoto ya estaba deshabilitado"));
         return;
     }
     remotoHabilitado = on;
     persistStateLocked();
-    std::cout << (on ? "🌐 Modo remoto habilitado\n" : "🔒 Modo remoto deshabilitado\n");
+    diarioEstado.registrarRemoto(on);
+    CONSOLA_INFO((on ? "🌐 Modo remoto habilitado" : "🔒 Modo remoto deshabilitado"));
 }
 
 bool AdministradorSistema::getRemoto() const {
@@ -43,10 +45,17 @@ void AdministradorSistema::persistStateLocked() const {
         std::error_code ec;
         fs::create_directories(filePath.parent_path(), ec);
     }
-    std::ofstream out(storagePath, std::ios::trunc);
-    if (out) {
+    // tmp + rename: una caída a mitad de escritura no deja el archivo vacío
+    const std::string tmpPath = storagePath + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::trunc);
+        if (!out) return;
         out << (remotoHabilitado ? 1 : 0);
+        out.flush();
+        if (!out) return;
     }
+    std::error_code ec;
+    fs::rename(tmpPath, storagePath, ec);
 }
 
 void AdministradorSistema::loadStateFromDisk() {
@@ -0,0 +1,210 @@
+#include "almacen_blobs.h"
+#include "programa_gcode.h"
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// definición de la instancia global
+AlmacenBlobs almacenBlobs;
+
+namespace {
+constexpr size_t kBloque = 64 * 1024;
+constexpr unsigned kMaxColisiones = 16;
+
+bool leerTodo(int fd, char* buf, size_t n, size_t& leidos) {
+    leidos = 0;
+    while (leidos < n) {
+        ssize_t r = ::read(fd, buf + leidos, n - leidos);
+        if (r < 0 && errno == EINTR) continue;
+        if (r < 0) return false;
+        if (r == 0) break;
+        leidos += static_cast<size_t>(r);
+    }
+    return true;
+}
+
+// Mismo tamaño y mismos bytes (o directamente el mismo inodo)
+bool mismoContenido(const std::string& a, const std::string& b) {
+    struct stat sa{}, sb{};
+    if (::stat(a.c_str(), &sa) != 0 || ::stat(b.c_str(), &sb) != 0) return false;
+    if (sa.st_dev == sb.st_dev && sa.st_ino == sb.st_ino) return true;
+    if (sa.st_size != sb.st_size) return false;
+    int fa = ::open(a.c_str(), O_RDONLY | O_CLOEXEC);
+    int fb = ::open(b.c_str(), O_RDONLY | O_CLOEXEC);
+    bool igual = fa >= 0 && fb >= 0;
+    std::string ba(kBloque, '\0'), bb(kBloque, '\0');
+    while (igual) {
+        size_t na = 0, nb = 0;
+        if (!leerTodo(fa, &ba[0], kBloque, na) || !leerTodo(fb, &bb[0], kBloque, nb) || na != nb) {
+            igual = false;
+            break;
+        }
+        if (na == 0) break;
+        igual = std::memcmp(ba.data(), bb.data(), na) == 0;
+    }
+    if (fa >= 0) ::close(fa);
+    if (fb >= 0) ::close(fb);
+    return igual;
+}
+
+bool mismoInodo(const std::string& a, const std::string& b) {
+    struct stat sa{}, sb{};
+    return ::stat(a.c_str(), &sa) == 0 && ::stat(b.c_str(), &sb) == 0 &&
+           sa.st_dev == sb.st_dev && sa.st_ino == sb.st_ino;
+}
+}
+
+AlmacenBlobs::AlmacenBlobs(std::string dir) : directorio(std::move(dir)) {}
+
+std::string AlmacenBlobs::rutaBlob(uint64_t hash, unsigned colision) const {
+    const std::string hex = gcode::hashHex(hash);
+    std::string ruta = directorio + "/" + hex.substr(0, 2) + "/" + hex;
+    if (colision > 0) ruta += "-" + std::to_string(colision);
+    return ruta;
+}
+
+bool AlmacenBlobs::hashArchivo(const std::string& ruta, uint64_t& hash) {
+    int fd = ::open(ruta.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    std::string buf(kBloque, '\0');
+    hash = gcode::kSemillaHash;
+    bool ok = true;
+    for (;;) {
+        size_t n = 0;
+        if (!leerTodo(fd, &buf[0], kBloque, n)) { ok = false; break; }
+        if (n == 0) break;
+        hash = gcode::hashContenido(std::string_view(buf.data(), n), hash);
+    }
+    ::close(fd);
+    return ok;
+}
+
+bool AlmacenBlobs::ubicarLocked(const std::string& tmp, uint64_t hash, std::string& blob, bool& nuevo) {
+    nuevo = false;
+    for (unsigned c = 0; c < kMaxColisiones; ++c) {
+        blob = rutaBlob(hash, c);
+        struct stat st{};
+        if (::stat(blob.c_str(), &st) != 0) {
+            std::error_code ec;
+            std::filesystem::create_directories(std::filesystem::path(blob).parent_path(), ec);
+            if (::rename(tmp.c_str(), blob.c_str()) != 0) return false;
+            ::chmod(blob.c_str(), 0444);
+            nuevo = true;
+            return true;
+        }
+        if (mismoContenido(tmp, blob)) return true;
+    }
+    errno = EEXIST;
+    return false;
+}
+
+// link() a un nombre auxiliar y rename() encima del destino: quien mire la
+// carpeta ve el archivo viejo o el nuevo, nunca un hueco.
+bool AlmacenBlobs::reemplazarConEnlace(const std::string& blob, const std::string& destino) {
+    const std::string aux = destino + ".ref";
+    ::unlink(aux.c_str());
+    if (::link(blob.c_str(), aux.c_str()) != 0) return false;
+    if (::rename(aux.c_str(), destino.c_str()) != 0) {
+        ::unlink(aux.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool AlmacenBlobs::publicar(const std::string& tmp, uint64_t hash, const std::string& destino) {
+    std::lock_guard<std::mutex> l(mtx);
+    std::string blob;
+    bool nuevo = false;
+    if (!ubicarLocked(tmp, hash, blob, nuevo)) {
+        // Sin almacén (permisos, demasiadas colisiones): publicación normal
+        return ::rename(tmp.c_str(), destino.c_str()) == 0;
+    }
+    if (!reemplazarConEnlace(blob, destino)) {
+        // Sistema de archivos sin enlaces duros: el contenido queda sólo con su nombre
+        if (nuevo) {
+            ::chmod(blob.c_str(), 0644);
+            return ::rename(blob.c_str(), destino.c_str()) == 0;
+        }
+        return ::rename(tmp.c_str(), destino.c_str()) == 0;
+    }
+    if (!nuevo) ::unlink(tmp.c_str());
+    if (destino.size() > 6 && destino.compare(destino.size() - 6, 6, ".gcode") == 0) {
+        // El IR ya queda asociado a esta ruta sin volver a leerla
+        cacheGcode.registrarArchivo(destino, hash);
+    }
+    return true;
+}
+
+bool AlmacenBlobs::publicar(const std::string& tmp, const std::string& destino) {
+    uint64_t hash = 0;
+    if (!hashArchivo(tmp, hash)) return false;
+    return publicar(tmp, hash, destino);
+}
+
+bool AlmacenBlobs::ingerir(const std::string& ruta, const uint64_t* hashConocido) {
+    uint64_t hash = 0;
+    if (hashConocido) {
+        hash = *hashConocido;
+    } else if (!hashArchivo(ruta, hash)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> l(mtx);
+    for (unsigned c = 0; c < kMaxColisiones; ++c) {
+        const std::string blob = rutaBlob(hash, c);
+        struct stat st{};
+        if (::stat(blob.c_str(), &st) != 0) {
+            // Contenido nuevo: el archivo se muda al almacén y su nombre queda enlazado
+            std::error_code ec;
+            std::filesystem::create_directories(std::filesystem::path(blob).parent_path(), ec);
+            if (::link(ruta.c_str(), blob.c_str()) != 0) return false;
+            ::chmod(blob.c_str(), 0444);
+            return true;
+        }
+        if (mismoInodo(ruta, blob)) return true;
+        if (mismoContenido(ruta, blob)) return reemplazarConEnlace(blob, ruta);
+    }
+    return false;
+}
+
+bool AlmacenBlobs::enlazar(const std::string& origen, const std::string& destino, const uint64_t* hash) {
+    if (!ingerir(origen, hash)) return false;
+    std::lock_guard<std::mutex> l(mtx);
+    return reemplazarConEnlace(origen, destino);
+}
+
+uint64_t AlmacenBlobs::recolectar() {
+    namespace fs = std::filesystem;
+    std::lock_guard<std::mutex> l(mtx);
+    uint64_t borrados = 0;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(directorio, ec), fin; !ec && it != fin; it.increment(ec)) {
+        struct stat st{};
+        if (!it->is_regular_file(ec) || ::stat(it->path().c_str(), &st) != 0) continue;
+        if (st.st_nlink == 1 && ::unlink(it->path().c_str()) == 0) ++borrados;
+    }
+    return borrados;
+}
+
+EstadisticasBlobs AlmacenBlobs::estadisticas() const {
+    namespace fs = std::filesystem;
+    std::lock_guard<std::mutex> l(mtx);
+    EstadisticasBlobs e;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(directorio, ec), fin; !ec && it != fin; it.increment(ec)) {
+        struct stat st{};
+        if (!it->is_regular_file(ec) || ::stat(it->path().c_str(), &st) != 0) continue;
+        const uint64_t refs = st.st_nlink > 0 ? static_cast<uint64_t>(st.st_nlink) - 1 : 0;
+        ++e.blobs;
+        e.bytes += static_cast<uint64_t>(st.st_size);
+        e.referencias += refs;
+        e.bytesLogicos += refs * static_cast<uint64_t>(st.st_size);
+    }
+    return e;
+}
@@ -0,0 +1,207 @@
+#include "almacen_sesiones.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+#include <sys/random.h>
+
+namespace {
+int64_t ahoraMs() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t ahoraParedMs() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+}
+
+AlmacenSesiones::AlmacenSesiones(std::function<void(const std::string&)> alVencer, int64_t ttlInactivoMs,
+                                 int64_t ttlAbsolutoMs)
+    : ttlInactivo(ttlInactivoMs), ttlAbsoluto(ttlAbsolutoMs), tickActual(ahoraMs() / kTickMs),
+      avisoVencida(std::move(alVencer)) {
+    hilo = std::thread(&AlmacenSesiones::bucle, this);
+}
+
+AlmacenSesiones::~AlmacenSesiones() {
+    {
+        std::lock_guard<std::mutex> l(mtxHilo);
+        parar = true;
+    }
+    cvHilo.notify_one();
+    if (hilo.joinable()) hilo.join();
+}
+
+std::string AlmacenSesiones::generarToken() {
+    uint8_t bytes[16];
+    size_t hecho = 0;
+    while (hecho < sizeof(bytes)) {
+        const ssize_t n = ::getrandom(bytes + hecho, sizeof(bytes) - hecho, 0);
+        if (n <= 0) break;
+        hecho += static_cast<size_t>(n);
+    }
+    if (hecho < sizeof(bytes)) {
+        // Sin getrandom (kernel viejo): random_device también lee del kernel
+        std::random_device rd;
+        for (auto& b : bytes) b = static_cast<uint8_t>(rd());
+    }
+    static const char kHex[] = "0123456789abcdef";
+    std::string token(32, '0');
+    for (size_t i = 0; i < sizeof(bytes); ++i) {
+        token[2 * i] = kHex[bytes[i] >> 4];
+        token[2 * i + 1] = kHex[bytes[i] & 0x0F];
+    }
+    return token;
+}
+
+int64_t AlmacenSesiones::vencimiento(const Entrada& e) const {
+    return std::min(e.creadaMs + ttlAbsoluto, e.ultimoUsoMs.load(std::memory_order_relaxed) + ttlInactivo);
+}
+
+void AlmacenSesiones::insertar(const std::string& token, const std::string& usuario, const std::string& privilegio,
+                               int64_t creadaMs) {
+    const int64_t ahora = ahoraMs();
+    Fragmento& f = fragmento(token);
+    int64_t vence;
+    {
+        std::unique_lock<std::shared_mutex> l(f.mtx);
+        f.sesiones.erase(token);
+        Entrada& e = f.sesiones.try_emplace(token).first->second;
+        e.sesion = SesionActiva{usuario, privilegio};
+        e.creadaMs = creadaMs;
+        e.ultimoUsoMs.store(ahora, std::memory_order_relaxed);
+        vence = vencimiento(e);
+    }
+    altas.fetch_add(1, std::memory_order_relaxed);
+    programar(token, vence);
+}
+
+std::string AlmacenSesiones::crear(const std::string& usuario, const std::string& privilegio) {
+    std::string token;
+    // 2^-128 por intento: el bucle es sólo para no pisar nunca una sesión ajena
+    for (;;) {
+        token = generarToken();
+        Fragmento& f = fragmento(token);
+        std::shared_lock<std::shared_mutex> l(f.mtx);
+        if (!f.sesiones.count(token)) break;
+    }
+    insertar(token, usuario, privilegio, ahoraMs());
+    return token;
+}
+
+void AlmacenSesiones::restaurar(const std::string& token, const std::string& usuario, const std::string& privilegio,
+                                int64_t creadaParedMs) {
+    // La rueda usa reloj monótono: se traslada la antigüedad, no la hora.
+    // Si el reloj de pared retrocedió, se toma como recién creada.
+    const int64_t edad = creadaParedMs > 0 ? std::max<int64_t>(0, ahoraParedMs() - creadaParedMs) : 0;
+    insertar(token, usuario, privilegio, ahoraMs() - edad);
+}
+
+std::optional<SesionActiva> AlmacenSesiones::resolver(const std::string& token) {
+    Fragmento& f = fragmento(token);
+    std::shared_lock<std::shared_mutex> l(f.mtx);
+    auto it = f.sesiones.find(token);
+    if (it == f.sesiones.end()) return std::nullopt;
+    const int64_t ahora = ahoraMs();
+    if (vencimiento(it->second) <= ahora) return std::nullopt;   // la rueda la saca en el próximo tick
+    it->second.ultimoUsoMs.store(ahora, std::memory_order_relaxed);
+    return it->second.sesion;
+}
+
+std::optional<SesionActiva> AlmacenSesiones::consultar(const std::string& token) const {
+    const Fragmento& f = fragmentos[std::hash<std::string>{}(token) % kFragmentos];
+    std::shared_lock<std::shared_mutex> l(f.mtx);
+    auto it = f.sesiones.find(token);
+    if (it == f.sesiones.end() || vencimiento(it->second) <= ahoraMs()) return std::nullopt;
+    return it->second.sesion;
+}
+
+bool AlmacenSesiones::cerrar(const std::string& token) {
+    Fragmento& f = fragmento(token);
+    std::unique_lock<std::shared_mutex> l(f.mtx);
+    if (!f.sesiones.erase(token)) return false;
+    cerradas.fetch_add(1, std::memory_order_relaxed);
+    return true;    // lo que quede en la rueda se descarta al llegar su ranura
+}
+
+EstadisticasSesiones AlmacenSesiones::estadisticas() const {
+    EstadisticasSesiones e;
+    for (const auto& f : fragmentos) {
+        std::shared_lock<std::shared_mutex> l(f.mtx);
+        e.activas += f.sesiones.size();
+    }
+    e.altas = altas.load(std::memory_order_relaxed);
+    e.vencidas = vencidas.load(std::memory_order_relaxed);
+    e.cerradas = cerradas.load(std::memory_order_relaxed);
+    return e;
+}
+
+void AlmacenSesiones::programar(const std::string& token, int64_t vencimientoMs) {
+    std::lock_guard<std::mutex> l(mtxRueda);
+    // Más allá de una vuelta queda en la última ranura y se reprograma al llegar
+    const int64_t tick = std::clamp(vencimientoMs / kTickMs, tickActual + 1,
+                                    tickActual + static_cast<int64_t>(kRanuras) - 1);
+    ranuras[static_cast<size_t>(tick) % kRanuras].push_back(token);
+}
+
+void AlmacenSesiones::avanzar(int64_t ahora) {
+    std::vector<std::string> candidatos;
+    {
+        std::lock_guard<std::mutex> l(mtxRueda);
+        const int64_t objetivo = ahora / kTickMs;
+        if (objetivo <= tickActual) return;
+        // Tras un salto de más de una vuelta, cada ranura se recorre una vez
+        const int64_t pasos = std::min<int64_t>(objetivo - tickActual, kRanuras);
+        for (int64_t t = objetivo - pasos + 1; t <= objetivo; ++t) {
+            auto& r = ranuras[static_cast<size_t>(t) % kRanuras];
+            candidatos.insert(candidatos.end(), std::make_move_iterator(r.begin()), std::make_move_iterator(r.end()));
+            r.clear();
+        }
+        tickActual = objetivo;
+    }
+
+    std::vector<std::string> vencidosAhora;
+    for (auto& token : candidatos) {
+        Fragmento& f = fragmento(token);
+        int64_t vence;
+        {
+            std::shared_lock<std::shared_mutex> l(f.mtx);
+            auto it = f.sesiones.find(token);
+            if (it == f.sesiones.end()) continue;       // cerrada o reemplazada
+            vence = vencimiento(it->second);
+        }
+        if (vence > ahora) {
+            programar(token, vence);
+            continue;
+        }
+        std::unique_lock<std::shared_mutex> l(f.mtx);
+        auto it = f.sesiones.find(token);
+        // Se pudo usar entre los dos locks
+        if (it == f.sesiones.end()) continue;
+        vence = vencimiento(it->second);
+        if (vence > ahora) {
+            l.unlock();
+            programar(token, vence);
+            continue;
+        }
+        f.sesiones.erase(it);
+        vencidas.fetch_add(1, std::memory_order_relaxed);
+        vencidosAhora.push_back(std::move(token));
+    }
+    if (avisoVencida) {
+        for (const auto& token : vencidosAhora) avisoVencida(token);
+    }
+}
+
+void AlmacenSesiones::bucle() {
+    std::unique_lock<std::mutex> l(mtxHilo);
+    while (!parar) {
+        cvHilo.wait_for(l, std::chrono::milliseconds(kTickMs));
+        if (parar) break;
+        l.unlock();
+        avanzar(ahoraMs());
+        l.lock();
+    }
+}
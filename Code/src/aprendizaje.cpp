@@ -0,0 +1,446 @@
+#include "aprendizaje.h"
+#include "consola.h"
+#include "archivo_io.h"
+#include "diario_estado.h"
+#include "catalogo_trabajos.h"
+#include "almacen_blobs.h"
+#include "programa_gcode.h"
+
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+// Holgado: el robot no acepta ni de cerca 16 mil comandos en un período de escritura
+constexpr size_t kCapacidadCola = 1u << 14;
+
+// Se escribe en <destino>.tmp y se renombra: quien mire la carpeta nunca
+// ve un archivo a medias.
+bool publicar(const std::string& tmp, const std::string& destino) {
+    if (::rename(tmp.c_str(), destino.c_str()) == 0) return true;
+    ::unlink(tmp.c_str());
+    return false;
+}
+
+// CSV de una columna en una sola pasada: cada línea entre comillas, con
+// las comillas internas duplicadas, leyendo y escribiendo por bloques. En
+// la misma pasada salen los hashes del origen y del CSV para el almacén.
+bool exportarCsv(const std::string& origen, const std::string& destino, uint64_t& lineas, uint64_t& bytes,
+                 uint64_t& hashOrigen) {
+    int in = ::open(origen.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) return false;
+    const std::string tmp = destino + ".tmp";
+    int out = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0) {
+        ::close(in);
+        return false;
+    }
+    ::posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    constexpr size_t kBloque = 64 * 1024;
+    std::string bloque(kBloque, '\0');
+    std::string salida = "gcode\n";
+    salida.reserve(2 * kBloque + 16);
+    bool inicioLinea = true, ok = true;
+    lineas = bytes = 0;
+    hashOrigen = gcode::kSemillaHash;
+    uint64_t hashCsv = gcode::kSemillaHash;
+    for (;;) {
+        ssize_t n = ::read(in, &bloque[0], kBloque);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) { ok = false; break; }
+        if (n == 0) break;
+        bytes += static_cast<uint64_t>(n);
+        hashOrigen = gcode::hashContenido(std::string_view(bloque.data(), static_cast<size_t>(n)), hashOrigen);
+        for (ssize_t i = 0; i < n; ++i) {
+            const char c = bloque[i];
+            if (inicioLinea) {
+                salida += '"';
+                inicioLinea = false;
+            }
+            if (c == '\n') {
+                salida += "\"\n";
+                inicioLinea = true;
+                ++lineas;
+            } else if (c == '"') {
+                salida += "\"\"";
+            } else {
+                salida += c;
+            }
+        }
+        if (salida.size() >= kBloque) {
+            hashCsv = gcode::hashContenido(salida, hashCsv);
+            if (!escribirTodo(out, salida)) { ok = false; break; }
+            salida.clear();
+        }
+    }
+    if (ok && !inicioLinea) {   // última línea sin salto final
+        salida += "\"\n";
+        ++lineas;
+    }
+    hashCsv = gcode::hashContenido(salida, hashCsv);
+    ok = ok && escribirTodo(out, salida);
+    ::close(in);
+    ok = (::close(out) == 0) && ok;
+    if (!ok) {
+        ::unlink(tmp.c_str());
+        return false;
+    }
+    if (almacenBlobs.publicar(tmp, hashCsv, destino)) return true;
+    ::unlink(tmp.c_str());
+    return false;
+}
+
+// Copia sin pasar los datos por el proceso: reflink si el sistema de
+// archivos lo permite (no ocupa bloques nuevos), si no copy_file_range
+// (copia dentro del kernel) y como último recurso read/write. Devuelve el
+// método usado o cadena vacía si falló. Sólo se usa cuando el almacén de
+// blobs no puede enlazar (sistema de archivos sin enlaces duros).
+std::string clonarArchivo(const std::string& origen, const std::string& destino) {
+    int in = ::open(origen.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) return {};
+    struct stat st{};
+    if (::fstat(in, &st) != 0) {
+        ::close(in);
+        return {};
+    }
+    const std::string tmp = destino + ".tmp";
+    int out = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0) {
+        ::close(in);
+        return {};
+    }
+
+    std::string metodo;
+    if (::ioctl(out, FICLONE, in) == 0) {
+        metodo = "reflink";
+    } else {
+        off_t restante = st.st_size;
+        while (restante > 0) {
+            ssize_t n = ::copy_file_range(in, nullptr, out, nullptr, static_cast<size_t>(restante), 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            restante -= n;
+        }
+        if (restante == 0) {
+            metodo = "copy_file_range";
+        } else {
+            // Sigue desde donde quedó copy_file_range (ambos offsets avanzaron)
+            std::string buf(64 * 1024, '\0');
+            bool ok = true;
+            for (;;) {
+                ssize_t n = ::read(in, &buf[0], buf.size());
+                if (n < 0 && errno == EINTR) continue;
+                if (n < 0) { ok = false; break; }
+                if (n == 0) break;
+                if (!escribirTodo(out, buf.substr(0, static_cast<size_t>(n)))) { ok = false; break; }
+            }
+            if (ok) metodo = "copia";
+        }
+    }
+    ::close(in);
+    if (::close(out) != 0) metodo.clear();
+    if (metodo.empty()) {
+        ::unlink(tmp.c_str());
+        return {};
+    }
+    return publicar(tmp, destino) ? metodo : std::string();
+}
+}
+
+Aprendizaje::Aprendizaje() : cola(kCapacidadCola), colaFotogramas(kCapacidadCola) {}
+
+Aprendizaje::~Aprendizaje() {
+    std::lock_guard<std::mutex> lock(mtx);
+    cerrarLocked();
+    if (exportador.joinable()) exportador.join();
+}
+
+bool Aprendizaje::abrirLocked(bool truncar) {
+    // Lo que haya quedado de una sesión anterior no va al archivo nuevo
+    std::string resto;
+    while (cola.desencolar(resto)) {}
+    Fotograma fotogramaResto;
+    while (colaFotogramas.desencolar(fotogramaResto)) {}
+
+    // Una grabación ya exportada es un enlace a un blob compartido: se
+    // desenlaza en lugar de truncarla para no pisar las otras copias
+    const std::string rutaTeach = fotogramas::rutaGrabacion(rutaArchivo);
+    if (truncar) {
+        ::unlink(rutaArchivo.c_str());
+        ::unlink(rutaTeach.c_str());
+    }
+    int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (truncar ? O_TRUNC : O_APPEND);
+    fd = ::open(rutaArchivo.c_str(), flags, 0644);
+    if (fd < 0) return false;
+
+    // Grabación con tiempos: al reanudar se sigue desde el último fotograma
+    // completo (una cola cortada por la caída se recorta antes de agregar)
+    codificador = fotogramas::Codificador{};
+    baseMs = 0;
+    bool continuar = false;
+    if (!truncar) {
+        std::vector<Fotograma> previos;
+        size_t descartados = 0;
+        std::string error;
+        if (fotogramas::leer(rutaTeach, previos, descartados, error)) {
+            std::error_code ec;
+            const auto tamano = std::filesystem::file_size(rutaTeach, ec);
+            if (!ec && descartados > 0) ::truncate(rutaTeach.c_str(), static_cast<off_t>(tamano - descartados));
+            if (!previos.empty()) {
+                codificador.continuar(previos.back());
+                baseMs = previos.back().ms;
+            }
+            continuar = true;
+        }
+    }
+    fdTeach = ::open(rutaTeach.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (continuar ? O_APPEND : O_TRUNC), 0644);
+    if (fdTeach >= 0 && !continuar) escribirTodo(fdTeach, fotogramas::Codificador::cabecera());
+    inicioSesion = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> l(mtxEscritor);
+        pararEscritor = false;
+    }
+    activo.store(true, std::memory_order_release);
+    escritor = std::thread(&Aprendizaje::bucleEscritor, this);
+    return true;
+}
+
+void Aprendizaje::cerrarLocked() {
+    if (!escritor.joinable()) return;
+    activo.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> l(mtxEscritor);
+        pararEscritor = true;
+    }
+    cvEscritor.notify_one();
+    escritor.join();    // el escritor vacía la cola y sincroniza antes de salir
+    ::close(fd);
+    fd = -1;
+    if (fdTeach >= 0) ::close(fdTeach);
+    fdTeach = -1;
+}
+
+void Aprendizaje::bucleEscritor() {
+    using reloj = std::chrono::steady_clock;
+    auto ultimoSync = reloj::now();
+    bool pendienteSync = false;
+    std::string lote, loteTeach, cmd;
+    Fotograma fotograma;
+    for (;;) {
+        bool parar;
+        {
+            std::unique_lock<std::mutex> l(mtxEscritor);
+            cvEscritor.wait_for(l, std::chrono::milliseconds(kPeriodoEscrituraMs), [&] { return pararEscritor; });
+            parar = pararEscritor;
+        }
+        lote.clear();
+        while (cola.desencolar(cmd)) {
+            lote += cmd;
+            lote += '\n';
+        }
+        loteTeach.clear();
+        while (colaFotogramas.desencolar(fotograma)) {
+            codificador.codificar(fotograma, loteTeach);
+        }
+        if (!lote.empty()) {
+            if (escribirTodo(fd, lote)) {
+                pendienteSync = true;
+            } else {
+                CONSOLA_ERROR("❌ Error escribiendo aprendizaje: " << strerror(errno));
+            }
+        }
+        if (!loteTeach.empty() && fdTeach >= 0) {
+            if (escribirTodo(fdTeach, loteTeach)) {
+                pendienteSync = true;
+            } else {
+                CONSOLA_ERROR("❌ Error escribiendo fotogramas: " << strerror(errno));
+            }
+        }
+        const auto ahora = reloj::now();
+        if (pendienteSync && (parar || ahora - ultimoSync >= std::chrono::milliseconds(kPeriodoSyncMs))) {
+            ::fdatasync(fd);
+            if (fdTeach >= 0) ::fdatasync(fdTeach);
+            ultimoSync = ahora;
+            pendienteSync = false;
+        }
+        if (parar) return;
+    }
+}
+
+void Aprendizaje::registrar(const std::string& cmd) {
+    if (!estaActivo()) return;
+    if (!cola.encolar(cmd)) {
+        contadorDescartados.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Aprendizaje::registrarFotograma(const Fotograma& f) {
+    if (!estaActivo()) return;
+    Fotograma conTiempo = f;
+    conTiempo.ms = baseMs + std::chrono::duration_cast<std::chrono::milliseconds>(
+                                std::chrono::steady_clock::now() - inicioSesion).count();
+    if (!colaFotogramas.encolar(conTiempo)) {
+        contadorDescartados.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Aprendizaje::iniciar(const std::string& ruta, const std::string& usuario) {
+    std::lock_guard<std::mutex> lock(mtx);
+    cerrarLocked();
+    // La exportación anterior puede estar leyendo el archivo que se va a truncar
+    if (exportador.joinable()) exportador.join();
+    // si no se proporcionó ruta específica, generar nombre con timestamp
+    if (ruta.empty() || ruta == "aprendizaje.gcode") {
+        // generar timestamp YYYYMMDD_HHMMSS usando chrono
+        using namespace std::chrono;
+        auto now = system_clock::now();
+        std::time_t t = system_clock::to_time_t(now);
+        std::tm tm;
+        localtime_r(&t, &tm);
+        char buf[64];
+        std::strftime(buf, sizeof(buf), "aprendizaje_%Y%m%d_%H%M%S.gcode", &tm);
+        rutaArchivo = std::string("aprendizaje gcode/") + std::string(buf);
+    } else {
+        rutaArchivo = ruta;
+        if (rutaArchivo.find('/') == std::string::npos && rutaArchivo.find('\\') == std::string::npos) {
+            rutaArchivo = std::string("aprendizaje gcode/") + rutaArchivo;
+        }
+    }
+    // Asegurar carpeta 'aprendizaje gcode'
+    try {
+        std::filesystem::create_directories("aprendizaje gcode");
+    } catch(...) {}
+    contadorDescartados.store(0, std::memory_order_relaxed);
+    const bool ok = abrirLocked(true);
+    if (ok) CONSOLA_INFO("📘 Aprendizaje iniciado -> " << rutaArchivo);
+    else CONSOLA_ERROR("❌ No se pudo abrir " << rutaArchivo);
+    if (ok) {
+        usuarioSesion = usuario;
+        diarioEstado.registrarAprendizaje(true, rutaArchivo);
+        catalogoTrabajos.registrarCreador(rutaArchivo, usuario);
+    }
+}
+
+void Aprendizaje::reanudar(const std::string& ruta) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (estaActivo() || ruta.empty()) return;
+    rutaArchivo = ruta;
+    const bool ok = abrirLocked(false);
+    if (ok) CONSOLA_INFO("📘 Aprendizaje reanudado -> " << rutaArchivo);
+    else CONSOLA_ERROR("❌ No se pudo reabrir " << rutaArchivo);
+    if (!ok) diarioEstado.registrarAprendizaje(false, std::string());
+}
+
+uint64_t Aprendizaje::detener() {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!estaActivo()) return 0;
+    cerrarLocked();
+    diarioEstado.registrarAprendizaje(false, std::string());
+    CONSOLA_INFO("📕 Aprendizaje detenido.");
+    if (const uint64_t perdidos = descartados()) {
+        CONSOLA_AVISO("⚠️ " << perdidos << " comandos no se grabaron (cola llena)");
+    }
+
+    auto now = std::chrono::system_clock::now();
+    std::time_t t = std::chrono::system_clock::to_time_t(now);
+    std::tm tm;
+    localtime_r(&t, &tm);
+    std::ostringstream ss;
+    ss << std::put_time(&tm, "%Y%m%d_%H%M%S");
+
+    // Una exportación a la vez; la anterior normalmente ya terminó
+    if (exportador.joinable()) exportador.join();
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> l(mtxExportacion);
+        id = exportacion.id + 1;
+        exportacion = EstadoExportacion{};
+        exportacion.fase = EstadoExportacion::EN_CURSO;
+        exportacion.id = id;
+        exportacion.origen = rutaArchivo;
+    }
+    exportador = std::thread(&Aprendizaje::exportar, this, id, rutaArchivo, ss.str(), usuarioSesion);
+    return id;
+}
+
+EstadoExportacion Aprendizaje::estadoExportacion() const {
+    std::lock_guard<std::mutex> l(mtxExportacion);
+    return exportacion;
+}
+
+void Aprendizaje::exportar(uint64_t id, std::string origen, std::string marca, std::string usuario) {
+    namespace fs = std::filesystem;
+    const auto inicio = std::chrono::steady_clock::now();
+    EstadoExportacion r;
+    r.id = id;
+    r.origen = origen;
+    auto terminar = [&](EstadoExportacion::Fase fase, std::string mensaje) {
+        r.fase = fase;
+        r.mensaje = std::move(mensaje);
+        r.milisegundos = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - inicio).count();
+        std::lock_guard<std::mutex> l(mtxExportacion);
+        exportacion = r;
+    };
+
+    std::error_code ec;
+    const fs::path dir = "aprendizajes";
+    fs::create_directories(dir, ec);
+    fs::create_directories("jobs", ec);
+    const fs::path csvpath = dir / ("aprendizaje_" + marca + ".csv");
+    const fs::path gcodeDst = dir / ("aprendizaje_" + marca + ".gcode");
+    const fs::path jobsDst = fs::path("jobs") / gcodeDst.filename();
+
+    uint64_t hashOrigen = 0;
+    if (!exportarCsv(origen, csvpath.string(), r.lineas, r.bytes, hashOrigen)) {
+        CONSOLA_ERROR("❌ No se pudo leer el archivo de aprendizaje o crear CSV: " << origen);
+        terminar(EstadoExportacion::FALLIDA, std::string("No se pudo generar el CSV: ") + strerror(errno));
+        return;
+    }
+    r.csv = csvpath.string();
+    CONSOLA_INFO("📁 Archivo CSV guardado: " << r.csv);
+
+    // Además, el .gcode original en 'aprendizajes' y en 'jobs' con el mismo
+    // timestamp: los tres nombres son referencias al mismo blob
+    // El creador va antes de la copia: el catálogo la indexa apenas aparece
+    catalogoTrabajos.registrarCreador(gcodeDst.string(), usuario);
+    catalogoTrabajos.registrarCreador(jobsDst.string(), usuario);
+    auto copiar = [&](const std::string& de, const std::string& a, const uint64_t* hash) -> std::string {
+        if (almacenBlobs.enlazar(de, a, hash)) return "enlace";
+        return clonarArchivo(de, a);
+    };
+    r.metodoCopia = copiar(origen, gcodeDst.string(), &hashOrigen);
+    if (r.metodoCopia.empty()) {
+        terminar(EstadoExportacion::FALLIDA, std::string("No se pudo copiar el GCODE: ") + strerror(errno));
+        return;
+    }
+    r.gcode = gcodeDst.string();
+    CONSOLA_INFO("📁 Archivo GCODE guardado: " << r.gcode << " (" << r.metodoCopia << ")");
+    if (copiar(origen, jobsDst.string(), &hashOrigen).empty()) {
+        terminar(EstadoExportacion::FALLIDA, std::string("No se pudo copiar a jobs: ") + strerror(errno));
+        return;
+    }
+    r.jobs = jobsDst.string();
+    CONSOLA_INFO("📁 Copia GCODE en jobs: " << r.jobs);
+
+    const std::string teachOrigen = fotogramas::rutaGrabacion(origen);
+    if (fs::exists(teachOrigen, ec)) {
+        const fs::path teachDst = dir / ("aprendizaje_" + marca + ".teach");
+        if (copiar(teachOrigen, teachDst.string(), nullptr).empty()) {
+            terminar(EstadoExportacion::FALLIDA, std::string("No se pudo copiar la grabación: ") + strerror(errno));
+            return;
+        }
+        r.teach = teachDst.string();
+        CONSOLA_INFO("📁 Grabación con tiempos: " << r.teach);
+    }
+    terminar(EstadoExportacion::LISTA, "Exportación completa");
+}
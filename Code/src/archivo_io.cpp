@@ -0,0 +1,22 @@
+#include "archivo_io.h"
+
+#include <cerrno>
+
+#include <unistd.h>
+
+bool escribirTodo(int fd, const char* datos, size_t n) {
+    size_t hecho = 0;
+    while (hecho < n) {
+        ssize_t w = ::write(fd, datos + hecho, n - hecho);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        hecho += static_cast<size_t>(w);
+    }
+    return true;
+}
+
+bool escribirTodo(int fd, const std::string& datos) {
+    return escribirTodo(fd, datos.data(), datos.size());
+}
@@ -0,0 +1,197 @@
+#include "arcos_gcode.h"
+
+#include "modelo_brazo.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr int kEjes = 4; // X Y Z E
+constexpr CampoGcode kCampoEje[kEjes] = {CAMPO_X, CAMPO_Y, CAMPO_Z, CAMPO_E};
+// Mismo criterio que grbl para decidir si el arco es una vuelta completa
+constexpr double kEpsilonAngular = 5e-7;
+// Diferencia tolerada entre el radio al inicio y al destino
+constexpr double kToleranciaRadioMm = 0.5;
+constexpr double kToleranciaRadioRel = 0.001;
+}
+
+PosicionModal::PosicionModal()
+    : pos{brazo::kInicialX, brazo::kInicialY, brazo::kInicialZ, brazo::kInicialE} {}
+
+void PosicionModal::avanzar(const InstruccionGcode& ins) {
+    if (!ins.valida()) return;
+    switch (ins.op) {
+        case OpGcode::MOVER:
+            for (int e = 0; e < kEjes; ++e) {
+                if (!ins.tiene(kCampoEje[e])) continue;
+                pos[e] = relativo ? pos[e] + ins.valor(kCampoEje[e]) : ins.valor(kCampoEje[e]) + offset[e];
+            }
+            if (ins.tiene(CAMPO_F)) feed = ins.valor(CAMPO_F);
+            break;
+        case OpGcode::HOME:
+            pos[0] = brazo::kInicialX;
+            pos[1] = brazo::kInicialY;
+            pos[2] = brazo::kInicialZ;
+            pos[3] = brazo::kInicialE;
+            break;
+        case OpGcode::ABSOLUTO: relativo = false; break;
+        case OpGcode::RELATIVO: relativo = true; break;
+        case OpGcode::OFFSET:
+            for (int e = 0; e < kEjes; ++e) {
+                float nuevo = ins.tiene(kCampoEje[e]) ? ins.valor(kCampoEje[e]) : pos[e];
+                offset[e] = pos[e] - nuevo;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+namespace gcode {
+
+ResultadoArco segmentarArco(const InstruccionGcode& arco, const float pos[4], const float offset[4],
+                            bool relativo, const OpcionesArco& opciones,
+                            std::vector<InstruccionGcode>& segmentos) {
+    segmentos.clear();
+    const bool horario = arco.op == OpGcode::ARCO_HORARIO;
+
+    double inicio[kEjes], fin[kEjes];
+    for (int e = 0; e < kEjes; ++e) {
+        inicio[e] = pos[e];
+        if (!arco.tiene(kCampoEje[e])) fin[e] = pos[e];
+        else if (relativo) fin[e] = static_cast<double>(pos[e]) + arco.valor(kCampoEje[e]);
+        else fin[e] = static_cast<double>(arco.valor(kCampoEje[e])) + offset[e];
+    }
+    const double dx = fin[0] - inicio[0];
+    const double dy = fin[1] - inicio[1];
+
+    // Centro relativo al inicio
+    double ci = 0.0, cj = 0.0;
+    if (arco.tiene(CAMPO_R)) {
+        double r = arco.valor(CAMPO_R);
+        const double d2 = dx * dx + dy * dy;
+        if (d2 <= 0.0 || r == 0.0) return ResultadoArco::PARAMETROS_INVALIDOS;
+        double h2 = 4.0 * r * r - d2;
+        if (h2 < 0.0) {
+            // Cuerda apenas más larga que el diámetro por redondeo: semicírculo
+            if (std::sqrt(d2) - 2.0 * std::fabs(r) > kToleranciaRadioMm) {
+                return ResultadoArco::PARAMETROS_INVALIDOS;
+            }
+            h2 = 0.0;
+        }
+        double h = -std::sqrt(h2) / std::sqrt(d2);
+        if (!horario) h = -h;
+        if (r < 0.0) h = -h;
+        ci = 0.5 * (dx - dy * h);
+        cj = 0.5 * (dy + dx * h);
+    } else {
+        ci = arco.tiene(CAMPO_I) ? arco.valor(CAMPO_I) : 0.0;
+        cj = arco.tiene(CAMPO_J) ? arco.valor(CAMPO_J) : 0.0;
+    }
+
+    const double cx = inicio[0] + ci, cy = inicio[1] + cj;
+    const double radio = std::hypot(ci, cj);
+    if (radio <= 0.0) return ResultadoArco::PARAMETROS_INVALIDOS;
+    const double radioFin = std::hypot(fin[0] - cx, fin[1] - cy);
+    if (std::fabs(radioFin - radio) > std::max(kToleranciaRadioMm, kToleranciaRadioRel * radio)) {
+        return ResultadoArco::PARAMETROS_INVALIDOS;
+    }
+
+    // Barrido con signo (positivo = antihorario)
+    const double rx = -ci, ry = -cj;            // centro -> inicio
+    const double tx = fin[0] - cx, ty = fin[1] - cy; // centro -> destino
+    double barrido = std::atan2(rx * ty - ry * tx, rx * tx + ry * ty);
+    if (horario) {
+        if (barrido >= -kEpsilonAngular) barrido -= 2.0 * brazo::kPi;
+    } else {
+        if (barrido <= kEpsilonAngular) barrido += 2.0 * brazo::kPi;
+    }
+
+    // Ángulo máximo por cuerda para una flecha r(1 - cos(θ/2)) <= error
+    const double error = std::max(1e-4, static_cast<double>(opciones.errorCuerda));
+    const double thetaMax = error >= radio ? brazo::kPi * 0.5
+                                           : std::min(brazo::kPi * 0.5, 2.0 * std::acos(1.0 - error / radio));
+    const int maxSeg = std::max(1, opciones.maxSegmentos);
+    int n = std::clamp(static_cast<int>(std::ceil(std::fabs(barrido) / thetaMax)), 1, maxSeg);
+    const double a0 = std::atan2(ry, rx);
+
+    auto punto = [&](int k, int total, double out[kEjes]) {
+        if (k == total) {
+            std::copy(fin, fin + kEjes, out);
+            return;
+        }
+        const double t = static_cast<double>(k) / total;
+        const double a = a0 + barrido * t;
+        out[0] = cx + radio * std::cos(a);
+        out[1] = cy + radio * std::sin(a);
+        out[2] = inicio[2] + (fin[2] - inicio[2]) * t;
+        out[3] = inicio[3] + (fin[3] - inicio[3]) * t;
+    };
+    auto permitido = [](const double p[kEjes]) {
+        return brazo::dentroDelEspacio(static_cast<float>(p[0]), static_cast<float>(p[1]),
+                                       static_cast<float>(p[2]), static_cast<float>(p[3]));
+    };
+
+    if (opciones.verificarEspacio) {
+        // Los vértices están sobre el arco: si alguno cae afuera, el arco
+        // sale del espacio de trabajo. Si sólo falla el punto medio de una
+        // cuerda (que corta hacia el centro), se subdivide más.
+        for (;;) {
+            bool cuerdaFuera = false;
+            double prev[kEjes];
+            std::copy(inicio, inicio + kEjes, prev);
+            for (int k = 1; k <= n; ++k) {
+                double p[kEjes], medio[kEjes];
+                punto(k, n, p);
+                if (!permitido(p)) return ResultadoArco::FUERA_DE_ESPACIO;
+                for (int e = 0; e < kEjes; ++e) medio[e] = 0.5 * (prev[e] + p[e]);
+                if (!permitido(medio)) cuerdaFuera = true;
+                std::copy(p, p + kEjes, prev);
+            }
+            if (!cuerdaFuera) break;
+            if (n >= maxSeg) return ResultadoArco::FUERA_DE_ESPACIO;
+            n = std::min(maxSeg, n * 2);
+        }
+    }
+
+    segmentos.reserve(static_cast<size_t>(n));
+    double prev[kEjes];
+    std::copy(inicio, inicio + kEjes, prev);
+    for (int k = 1; k <= n; ++k) {
+        double p[kEjes];
+        punto(k, n, p);
+        InstruccionGcode g1;
+        g1.op = OpGcode::MOVER;
+        g1.letra = 'G';
+        g1.numero = 1;
+        g1.linea = arco.linea;
+        for (int e = 0; e < kEjes; ++e) {
+            // X e Y siempre cambian; Z y E sólo si el arco las menciona
+            if (e >= 2 && !arco.tiene(kCampoEje[e])) continue;
+            const double v = relativo ? p[e] - prev[e] : p[e] - offset[e];
+            g1.fijar(kCampoEje[e], static_cast<float>(v));
+        }
+        if (arco.tiene(CAMPO_F)) g1.fijar(CAMPO_F, arco.valor(CAMPO_F));
+        segmentos.push_back(g1);
+        // En modo relativo el firmware acumula lo que recibe, no lo ideal
+        if (relativo) {
+            for (int e = 0; e < kEjes; ++e) {
+                if (g1.tiene(kCampoEje[e])) prev[e] += g1.valor(kCampoEje[e]);
+            }
+        } else {
+            std::copy(p, p + kEjes, prev);
+        }
+    }
+    return ResultadoArco::OK;
+}
+
+const char* describirResultado(ResultadoArco r) {
+    switch (r) {
+        case ResultadoArco::OK: return "ok";
+        case ResultadoArco::PARAMETROS_INVALIDOS: return "parámetros de arco inválidos";
+        case ResultadoArco::FUERA_DE_ESPACIO: return "el arco sale del espacio de trabajo";
+    }
+    return "desconocido";
+}
+
+} // namespace gcode
@@ -0,0 +1,508 @@
+#include "catalogo_trabajos.h"
+#include "consola.h"
+#include "arcos_gcode.h"
+#include "estimador_trabajo.h"
+#include "lector_mapeado.h"
+#include "programa_gcode.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <unordered_map>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+CatalogoTrabajos catalogoTrabajos; // definición de la instancia global
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr uint32_t kMaxPagina = 200;
+constexpr uint32_t kEventosEscritura = IN_CLOSE_WRITE | IN_MOVED_TO;
+constexpr uint32_t kEventosBorrado = IN_DELETE | IN_MOVED_FROM;
+
+const char* const kEsquema =
+    "CREATE TABLE IF NOT EXISTS programas ("
+    "ruta TEXT PRIMARY KEY,"
+    "nombre TEXT NOT NULL,"
+    "carpeta TEXT NOT NULL,"
+    "hash TEXT NOT NULL,"
+    "lineas INTEGER NOT NULL,"
+    "instrucciones INTEGER NOT NULL,"
+    "invalidas INTEGER NOT NULL,"
+    "tiene_caja INTEGER NOT NULL,"
+    "min_x REAL, min_y REAL, min_z REAL, max_x REAL, max_y REAL, max_z REAL,"
+    "segundos REAL NOT NULL,"
+    "bytes INTEGER NOT NULL,"
+    "mtime_ns INTEGER NOT NULL,"
+    "creado INTEGER NOT NULL,"
+    "modificado INTEGER NOT NULL,"
+    "analizado INTEGER NOT NULL DEFAULT 0"
+    ");"
+    "CREATE INDEX IF NOT EXISTS programas_carpeta_mod ON programas(carpeta, modificado);"
+    "CREATE INDEX IF NOT EXISTS programas_nombre ON programas(nombre COLLATE NOCASE);"
+    "CREATE INDEX IF NOT EXISTS programas_hash ON programas(hash);"
+    // Aparte, para que re-indexar un archivo no borre quién lo creó
+    "CREATE TABLE IF NOT EXISTS autores ("
+    "ruta TEXT PRIMARY KEY,"
+    "usuario TEXT NOT NULL"
+    ");";
+
+const char* const kColumnas =
+    "p.ruta, p.nombre, p.carpeta, p.hash, p.lineas, p.instrucciones, p.invalidas, p.tiene_caja,"
+    "p.min_x, p.min_y, p.min_z, p.max_x, p.max_y, p.max_z, p.segundos, p.bytes,"
+    "COALESCE(a.usuario, ''), p.creado, p.modificado, p.analizado";
+
+bool esGcode(const std::string& nombre) {
+    return fs::path(nombre).extension() == ".gcode";
+}
+
+int64_t ahoraS() {
+    using namespace std::chrono;
+    return duration_cast<seconds>(system_clock::now().time_since_epoch()).count();
+}
+
+bool firma(const std::string& ruta, uint64_t& bytes, int64_t& mtimeNs) {
+    struct stat st{};
+    if (::stat(ruta.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return false;
+    bytes = static_cast<uint64_t>(st.st_size);
+    mtimeNs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+    return true;
+}
+
+std::string texto(sqlite3_stmt* st, int col) {
+    const unsigned char* t = sqlite3_column_text(st, col);
+    return t ? reinterpret_cast<const char*>(t) : std::string();
+}
+
+FichaTrabajo leerFila(sqlite3_stmt* st) {
+    FichaTrabajo f;
+    f.ruta = texto(st, 0);
+    f.nombre = texto(st, 1);
+    f.carpeta = texto(st, 2);
+    f.hash = texto(st, 3);
+    f.lineas = static_cast<uint32_t>(sqlite3_column_int64(st, 4));
+    f.instrucciones = static_cast<uint32_t>(sqlite3_column_int64(st, 5));
+    f.invalidas = static_cast<uint32_t>(sqlite3_column_int64(st, 6));
+    f.tieneCaja = sqlite3_column_int(st, 7) != 0;
+    for (int i = 0; i < 3; ++i) {
+        f.min[i] = static_cast<float>(sqlite3_column_double(st, 8 + i));
+        f.max[i] = static_cast<float>(sqlite3_column_double(st, 11 + i));
+    }
+    f.segundos = sqlite3_column_double(st, 14);
+    f.bytes = static_cast<uint64_t>(sqlite3_column_int64(st, 15));
+    f.creador = texto(st, 16);
+    f.creado = sqlite3_column_int64(st, 17);
+    f.modificado = sqlite3_column_int64(st, 18);
+    f.analizado = sqlite3_column_int(st, 19) != 0;
+    return f;
+}
+
+// Caja de los puntos que visita el programa, arcos incluidos
+void calcularCaja(const ProgramaGcode& programa, FichaTrabajo& f) {
+    PosicionModal modal;
+    std::vector<InstruccionGcode> segmentos;
+    auto incluir = [&](const float pos[4]) {
+        for (int i = 0; i < 3; ++i) {
+            if (!f.tieneCaja || pos[i] < f.min[i]) f.min[i] = pos[i];
+            if (!f.tieneCaja || pos[i] > f.max[i]) f.max[i] = pos[i];
+        }
+        f.tieneCaja = true;
+    };
+    for (const auto& ins : programa.instrucciones) {
+        if (!ins.valida()) continue;
+        if (ins.esArco()) {
+            if (gcode::segmentarArco(ins, modal.pos, modal.offset, modal.relativo, OpcionesArco{}, segmentos) !=
+                ResultadoArco::OK) {
+                continue;
+            }
+            for (const auto& g1 : segmentos) {
+                modal.avanzar(g1);
+                incluir(modal.pos);
+            }
+            continue;
+        }
+        modal.avanzar(ins);
+        if (ins.op == OpGcode::MOVER || ins.op == OpGcode::HOME) incluir(modal.pos);
+    }
+}
+
+// Lo que sale del IR; las líneas y el hash ya vienen del archivo
+void analizar(const ProgramaGcode& programa, FichaTrabajo& f) {
+    f.instrucciones = static_cast<uint32_t>(programa.instrucciones.size());
+    f.invalidas = programa.invalidas;
+    calcularCaja(programa, f);
+    f.segundos = gcode::estimarDuracion(programa, OpcionesEstimador{}, false).segundosTotales;
+    f.analizado = true;
+}
+
+// Mismo conteo que gcode::compilar: la última línea cuenta aunque no
+// termine en '\n'
+uint32_t contarLineas(std::string_view texto) {
+    uint32_t n = static_cast<uint32_t>(std::count(texto.begin(), texto.end(), '\n'));
+    if (!texto.empty() && texto.back() != '\n') ++n;
+    return n;
+}
+}
+
+CatalogoTrabajos::CatalogoTrabajos(std::string ruta) : rutaDb(std::move(ruta)) {}
+
+CatalogoTrabajos::~CatalogoTrabajos() {
+    detener();
+    if (db) sqlite3_close(db);
+}
+
+bool CatalogoTrabajos::abrirLocked() {
+    if (db) return true;
+    std::error_code ec;
+    fs::path p(rutaDb);
+    if (p.has_parent_path()) fs::create_directories(p.parent_path(), ec);
+    if (sqlite3_open(rutaDb.c_str(), &db) != SQLITE_OK) {
+        CONSOLA_ERROR("❌ Error abriendo catálogo: " << sqlite3_errmsg(db));
+        sqlite3_close(db);
+        db = nullptr;
+        return false;
+    }
+    char* err = nullptr;
+    if (sqlite3_exec(db, kEsquema, nullptr, nullptr, &err) != SQLITE_OK) {
+        CONSOLA_ERROR("❌ Error creando tablas del catálogo: " << (err ? err : ""));
+        sqlite3_free(err);
+        sqlite3_close(db);
+        db = nullptr;
+        return false;
+    }
+    // Catálogos de antes de la columna: sus filas se indexaron compilando,
+    // así que ya están analizadas. En uno nuevo falla (columna duplicada).
+    sqlite3_exec(db, "ALTER TABLE programas ADD COLUMN analizado INTEGER NOT NULL DEFAULT 1;", nullptr, nullptr,
+                 nullptr);
+    return true;
+}
+
+bool CatalogoTrabajos::iniciar(const std::vector<std::string>& carpetasVigiladas) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!abrirLocked()) return false;
+        carpetas = carpetasVigiladas;
+    }
+    for (const auto& c : carpetas) {
+        std::error_code ec;
+        fs::create_directories(c, ec);
+    }
+
+    // Se vigila antes de conciliar: lo que cambie mientras tanto no se pierde
+    fdInotify = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fdInotify < 0) {
+        CONSOLA_AVISO("⚠️ inotify no disponible: el catálogo sólo se concilia al arrancar");
+    }
+    carpetaPorWd.clear();
+    for (const auto& c : carpetas) {
+        if (fdInotify < 0) break;
+        int wd = ::inotify_add_watch(fdInotify, c.c_str(), kEventosEscritura | kEventosBorrado);
+        if (wd >= 0) carpetaPorWd[wd] = c;
+    }
+
+    cacheGcode.alCompilar([this](const ProgramaGcode& programa) { completar(programa); });
+
+    // La primera conciliación puede leer muchos archivos: va en el hilo
+    detenerPedido = false;
+    vigilante = std::thread(&CatalogoTrabajos::bucleVigilancia, this);
+    return true;
+}
+
+void CatalogoTrabajos::detener() {
+    cacheGcode.alCompilar({});
+    detenerPedido = true;
+    if (vigilante.joinable()) vigilante.join();
+    if (fdInotify >= 0) {
+        ::close(fdInotify);
+        fdInotify = -1;
+    }
+}
+
+void CatalogoTrabajos::conciliar() {
+    struct Conocido {
+        uint64_t bytes;
+        int64_t mtimeNs;
+        bool visto;
+    };
+    std::unordered_map<std::string, Conocido> conocidos;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        sqlite3_stmt* st = nullptr;
+        if (sqlite3_prepare_v2(db, "SELECT ruta, bytes, mtime_ns FROM programas;", -1, &st, nullptr) == SQLITE_OK) {
+            while (sqlite3_step(st) == SQLITE_ROW) {
+                conocidos[texto(st, 0)] = {static_cast<uint64_t>(sqlite3_column_int64(st, 1)),
+                                           sqlite3_column_int64(st, 2), false};
+            }
+        }
+        sqlite3_finalize(st);
+    }
+
+    size_t nuevos = 0;
+    for (const auto& c : carpetas) {
+        std::error_code ec;
+        for (fs::directory_iterator it(c, ec), fin; !ec && it != fin; it.increment(ec)) {
+            if (detenerPedido.load()) return;
+            const std::string ruta = it->path().string();
+            if (!esGcode(ruta)) continue;
+            uint64_t bytes = 0;
+            int64_t mtimeNs = 0;
+            if (!firma(ruta, bytes, mtimeNs)) continue;
+            auto k = conocidos.find(ruta);
+            if (k != conocidos.end()) {
+                k->second.visto = true;
+                if (k->second.bytes == bytes && k->second.mtimeNs == mtimeNs) continue;
+            }
+            if (indexar(ruta)) ++nuevos;
+        }
+    }
+    size_t quitados = 0;
+    for (const auto& [ruta, k] : conocidos) {
+        if (k.visto) continue;
+        quitar(ruta);
+        ++quitados;
+    }
+    if (nuevos || quitados) {
+        CONSOLA_INFO("🗂️ Catálogo: " << nuevos << " indexados, " << quitados << " quitados");
+    }
+}
+
+void CatalogoTrabajos::bucleVigilancia() {
+    const auto inicio = std::chrono::steady_clock::now();
+    conciliar();
+    CONSOLA_INFO("🗂️ Catálogo de trabajos listo en "
+                 << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - inicio).count()
+                 << " ms");
+    if (fdInotify < 0) return;
+
+    alignas(struct inotify_event) char buf[16 * 1024];
+    while (!detenerPedido.load()) {
+        pollfd pfd{fdInotify, POLLIN, 0};
+        if (::poll(&pfd, 1, 500) <= 0) continue;
+        bool desborde = false;
+        for (;;) {
+            const ssize_t n = ::read(fdInotify, buf, sizeof(buf));
+            if (n <= 0) break;
+            for (char* p = buf; p < buf + n;) {
+                auto* ev = reinterpret_cast<struct inotify_event*>(p);
+                p += sizeof(struct inotify_event) + ev->len;
+                // El kernel descartó eventos: ya no se sabe qué cambió
+                if (ev->mask & IN_Q_OVERFLOW) {
+                    desborde = true;
+                    continue;
+                }
+                if (ev->len == 0 || (ev->mask & IN_ISDIR)) continue;
+                const std::string nombre = ev->name;
+                auto c = carpetaPorWd.find(ev->wd);
+                if (c == carpetaPorWd.end() || !esGcode(nombre)) continue;
+                const std::string ruta = (fs::path(c->second) / nombre).string();
+                if (ev->mask & kEventosBorrado) {
+                    quitar(ruta);
+                } else if (ev->mask & kEventosEscritura) {
+                    indexar(ruta);
+                }
+            }
+        }
+        if (desborde) {
+            CONSOLA_AVISO("⚠️ Cola de inotify desbordada: se vuelve a recorrer el catálogo");
+            conciliar();
+        }
+    }
+}
+
+bool CatalogoTrabajos::indexar(const std::string& ruta) {
+    if (!esGcode(ruta)) return false;
+    uint64_t bytes = 0;
+    int64_t mtimeNs = 0;
+    if (!firma(ruta, bytes, mtimeNs)) return false;
+
+    FichaTrabajo f;
+    f.ruta = ruta;
+    const fs::path p(ruta);
+    f.nombre = p.stem().string();
+    f.carpeta = p.parent_path().string();
+    {
+        // Sólo hash y líneas: compilar queda para cuando se use. Si el IR
+        // ya está en la caché (mismo contenido en otra carpeta, o un .gir
+        // de antes) se aprovecha; buscar() no compila.
+        LectorMapeado lector(ruta);
+        if (!lector.abierto()) return false;
+        const std::string_view texto = lector.contenido();
+        const uint64_t hash = gcode::hashContenido(texto);
+        f.hash = gcode::hashHex(hash);
+        f.lineas = contarLineas(texto);
+        if (auto programa = cacheGcode.buscar(hash)) analizar(*programa, f);
+    }
+    f.bytes = bytes;
+    f.modificado = mtimeNs / 1000000000LL;
+    f.creado = ahoraS();
+
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!db) return false;
+    sqlite3_stmt* st = nullptr;
+    const char* sql =
+        "INSERT INTO programas (ruta, nombre, carpeta, hash, lineas, instrucciones, invalidas, tiene_caja,"
+        " min_x, min_y, min_z, max_x, max_y, max_z, segundos, bytes, mtime_ns, creado, modificado, analizado)"
+        " VALUES (?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)"
+        " ON CONFLICT(ruta) DO UPDATE SET nombre=excluded.nombre, carpeta=excluded.carpeta, hash=excluded.hash,"
+        " lineas=excluded.lineas, instrucciones=excluded.instrucciones, invalidas=excluded.invalidas,"
+        " tiene_caja=excluded.tiene_caja, min_x=excluded.min_x, min_y=excluded.min_y, min_z=excluded.min_z,"
+        " max_x=excluded.max_x, max_y=excluded.max_y, max_z=excluded.max_z, segundos=excluded.segundos,"
+        " bytes=excluded.bytes, mtime_ns=excluded.mtime_ns, modificado=excluded.modificado,"
+        " analizado=excluded.analizado;";
+    if (sqlite3_prepare_v2(db, sql, -1, &st, nullptr) != SQLITE_OK) {
+        CONSOLA_ERROR("❌ Catálogo: " << sqlite3_errmsg(db));
+        return false;
+    }
+    int i = 1;
+    sqlite3_bind_text(st, i++, f.ruta.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(st, i++, f.nombre.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(st, i++, f.carpeta.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(st, i++, f.hash.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(st, i++, f.lineas);
+    sqlite3_bind_int64(st, i++, f.instrucciones);
+    sqlite3_bind_int64(st, i++, f.invalidas);
+    sqlite3_bind_int(st, i++, f.tieneCaja ? 1 : 0);
+    for (int k = 0; k < 3; ++k) sqlite3_bind_double(st, i++, f.min[k]);
+    for (int k = 0; k < 3; ++k) sqlite3_bind_double(st, i++, f.max[k]);
+    sqlite3_bind_double(st, i++, f.segundos);
+    sqlite3_bind_int64(st, i++, static_cast<sqlite3_int64>(f.bytes));
+    sqlite3_bind_int64(st, i++, mtimeNs);
+    sqlite3_bind_int64(st, i++, f.creado);
+    sqlite3_bind_int64(st, i++, f.modificado);
+    sqlite3_bind_int(st, i++, f.analizado ? 1 : 0);
+    const bool ok = sqlite3_step(st) == SQLITE_DONE;
+    if (!ok) CONSOLA_ERROR("❌ Catálogo: " << sqlite3_errmsg(db));
+    sqlite3_finalize(st);
+    return ok;
+}
+
+void CatalogoTrabajos::completar(const ProgramaGcode& programa) {
+    FichaTrabajo f;
+    analizar(programa, f);
+    const std::string hash = gcode::hashHex(programa.hash);
+
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!db) return;
+    sqlite3_stmt* st = nullptr;
+    const char* sql =
+        "UPDATE programas SET instrucciones = ?, invalidas = ?, tiene_caja = ?, min_x = ?, min_y = ?, min_z = ?,"
+        " max_x = ?, max_y = ?, max_z = ?, segundos = ?, analizado = 1 WHERE hash = ? AND analizado = 0;";
+    if (sqlite3_prepare_v2(db, sql, -1, &st, nullptr) != SQLITE_OK) {
+        CONSOLA_ERROR("❌ Catálogo: " << sqlite3_errmsg(db));
+        return;
+    }
+    int i = 1;
+    sqlite3_bind_int64(st, i++, f.instrucciones);
+    sqlite3_bind_int64(st, i++, f.invalidas);
+    sqlite3_bind_int(st, i++, f.tieneCaja ? 1 : 0);
+    for (int k = 0; k < 3; ++k) sqlite3_bind_double(st, i++, f.min[k]);
+    for (int k = 0; k < 3; ++k) sqlite3_bind_double(st, i++, f.max[k]);
+    sqlite3_bind_double(st, i++, f.segundos);
+    sqlite3_bind_text(st, i++, hash.c_str(), -1, SQLITE_TRANSIENT);
+    if (sqlite3_step(st) != SQLITE_DONE) CONSOLA_ERROR("❌ Catálogo: " << sqlite3_errmsg(db));
+    sqlite3_finalize(st);
+}
+
+void CatalogoTrabajos::quitar(const std::string& ruta) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!db) return;
+    for (const char* sql : {"DELETE FROM programas WHERE ruta = ?;", "DELETE FROM autores WHERE ruta = ?;"}) {
+        sqlite3_stmt* st = nullptr;
+        if (sqlite3_prepare_v2(db, sql, -1, &st, nullptr) != SQLITE_OK) continue;
+        sqlite3_bind_text(st, 1, ruta.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_step(st);
+        sqlite3_finalize(st);
+    }
+}
+
+void CatalogoTrabajos::registrarCreador(const std::string& ruta, const std::string& usuario) {
+    if (usuario.empty()) return;
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!db) return;
+    sqlite3_stmt* st = nullptr;
+    const char* sql = "INSERT INTO autores (ruta, usuario) VALUES (?, ?)"
+                      " ON CONFLICT(ruta) DO UPDATE SET usuario = excluded.usuario;";
+    if (sqlite3_prepare_v2(db, sql, -1, &st, nullptr) != SQLITE_OK) return;
+    sqlite3_bind_text(st, 1, ruta.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(st, 2, usuario.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_step(st);
+    sqlite3_finalize(st);
+}
+
+PaginaCatalogo CatalogoTrabajos::listar(const std::string& carpeta, OrdenCatalogo orden, uint32_t desde,
+                                        uint32_t cantidad) const {
+    PaginaCatalogo pagina;
+    cantidad = std::min(cantidad == 0 ? 50u : cantidad, kMaxPagina);
+    const char* ordenSql = orden == OrdenCatalogo::NOMBRE     ? "p.nombre COLLATE NOCASE ASC, p.ruta"
+                           : orden == OrdenCatalogo::DURACION ? "p.segundos DESC, p.ruta"
+                                                              : "p.modificado DESC, p.ruta";
+    const std::string filtro = carpeta.empty() ? "" : " WHERE p.carpeta = ?1";
+
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!db) return pagina;
+    sqlite3_stmt* st = nullptr;
+    const std::string total = "SELECT COUNT(*) FROM programas p" + filtro + ";";
+    if (sqlite3_prepare_v2(db, total.c_str(), -1, &st, nullptr) == SQLITE_OK) {
+        if (!carpeta.empty()) sqlite3_bind_text(st, 1, carpeta.c_str(), -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(st) == SQLITE_ROW) pagina.total = static_cast<uint64_t>(sqlite3_column_int64(st, 0));
+    }
+    sqlite3_finalize(st);
+
+    const std::string sql = std::string("SELECT ") + kColumnas +
+                            " FROM programas p LEFT JOIN autores a ON a.ruta = p.ruta" + filtro +
+                            " ORDER BY " + ordenSql + " LIMIT ?2 OFFSET ?3;";
+    st = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &st, nullptr) != SQLITE_OK) return pagina;
+    if (!carpeta.empty()) sqlite3_bind_text(st, 1, carpeta.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(st, 2, cantidad);
+    sqlite3_bind_int64(st, 3, desde);
+    while (sqlite3_step(st) == SQLITE_ROW) pagina.fichas.push_back(leerFila(st));
+    sqlite3_finalize(st);
+    return pagina;
+}
+
+PaginaCatalogo CatalogoTrabajos::buscar(const std::string& texto, uint32_t desde, uint32_t cantidad) const {
+    PaginaCatalogo pagina;
+    cantidad = std::min(cantidad == 0 ? 50u : cantidad, kMaxPagina);
+    // LIKE con los comodines del usuario escapados, también en el prefijo
+    // de hash: "_" no debe coincidir con cualquier dígito
+    std::string escapado;
+    for (char c : texto) {
+        if (c == '%' || c == '_' || c == '\\') escapado += '\\';
+        escapado += c;
+    }
+    const std::string patron = "%" + escapado + "%";
+    const std::string prefijoHash = escapado + "%";
+    const char* filtro =
+        " WHERE p.nombre LIKE ?1 ESCAPE '\\' OR p.ruta LIKE ?1 ESCAPE '\\'"
+        " OR a.usuario LIKE ?1 ESCAPE '\\' OR p.hash LIKE ?2 ESCAPE '\\'";
+
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!db) return pagina;
+    sqlite3_stmt* st = nullptr;
+    const std::string total =
+        std::string("SELECT COUNT(*) FROM programas p LEFT JOIN autores a ON a.ruta = p.ruta") + filtro + ";";
+    if (sqlite3_prepare_v2(db, total.c_str(), -1, &st, nullptr) == SQLITE_OK) {
+        sqlite3_bind_text(st, 1, patron.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(st, 2, prefijoHash.c_str(), -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(st) == SQLITE_ROW) pagina.total = static_cast<uint64_t>(sqlite3_column_int64(st, 0));
+    }
+    sqlite3_finalize(st);
+
+    const std::string sql = std::string("SELECT ") + kColumnas +
+                            " FROM programas p LEFT JOIN autores a ON a.ruta = p.ruta" + filtro +
+                            " ORDER BY p.modificado DESC, p.ruta LIMIT ?3 OFFSET ?4;";
+    st = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &st, nullptr) != SQLITE_OK) return pagina;
+    sqlite3_bind_text(st, 1, patron.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(st, 2, prefijoHash.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(st, 3, cantidad);
+    sqlite3_bind_int64(st, 4, desde);
+    while (sqlite3_step(st) == SQLITE_ROW) pagina.fichas.push_back(leerFila(st));
+    sqlite3_finalize(st);
+    return pagina;
+}
@@ -1,4 +1,5 @@
 #include "comunicacion_controlador_simple.h"
+#include "consola.h"
 #include <sys/select.h>
 
 ComunicacionControladorSimple::ComunicacionControladorSimple(const std::string& device, speed_t baud)
@@ -9,22 +10,22 @@ ComunicacionControladorSimple::ComunicacionControladorSimple(const std::string&
 ComunicacionControladorSimple::~ComunicacionControladorSimple() {
     if (fd >= 0) {
         close(fd);
-        std::cout << "🔌 Puerto serial cerrado" << std::endl;
+        CONSOLA_INFO("🔌 Puerto serial cerrado");
     }
 }
 
 void ComunicacionControladorSimple::openPort() {
     fd = open(puerto.c_str(), O_RDWR | O_NOCTTY | O_SYNC);
     if (fd < 0) {
-        std::cerr << "❌ No se pudo abrir " << puerto << ": " << strerror(errno) << std::endl;
-        std::cout << "📝 Modo simulación activado" << std::endl;
+        CONSOLA_ERROR("❌ No se pudo abrir " << puerto << ": " << strerror(errno));
+        CONSOLA_INFO("📝 Modo simulación activado");
         return;
     }
 
     // Configuración del puerto
     struct termios tty;
     if (tcgetattr(fd, &tty) != 0) {
-        std::cerr << "❌ Error tcgetattr: " << strerror(errno) << std::endl;
+        CONSOLA_ERROR("❌ Error tcgetattr: " << strerror(errno));
         close(fd);
         fd = -1;
         return;
@@ -46,14 +47,14 @@ void ComunicacionControladorSimple::openPort() {
     tty.c_cflag &= ~CRTSCTS;
 
     if (tcsetattr(fd, TCSANOW, &tty) != 0) {
-        std::cerr << "❌ Error tcsetattr" << std::endl;
+        CONSOLA_ERROR("❌ Error tcsetattr");
         close(fd);
         fd = -1;
         return;
     }
 
-     std::cout << "✅ Puerto abierto: " << puerto << " (" << baudrate << " baud)" << std::endl;
-    std::cout << "⏳ Esperando inicialización del Arduino..." << std::endl;
+    CONSOLA_INFO("✅ Puerto abierto: " << puerto << " (" << baudrate << " baud)");
+    CONSOLA_INFO("⏳ Esperando inicialización del Arduino...");
     // Esperar inicialización
     std::this_thread::sleep_for(std::chrono::seconds(3));
     char buffer[256];
@@ -64,16 +65,16 @@ void ComunicacionControladorSimple::openPort() {
             cleared += n;
         }
     if (cleared > 0) {
-            std::cout << "🧹 Limpiados " << cleared << " bytes del buffer" << std::endl;
+            CONSOLA_DEBUG("🧹 Limpiados " << cleared << " bytes del buffer");
         }
         
         tcflush(fd, TCIOFLUSH);
-        std::cout << "🚀 Arduino listo para comandos" << std::endl;
+        CONSOLA_INFO("🚀 Arduino listo para comandos");
     }
 
 std::string ComunicacionControladorSimple::enviarComando(const std::string& comando, int timeout_ms) {
     if (fd < 0) {
-        std::cout << "➡️ SIMULACIÓN: " << comando << std::endl;
+        CONSOLA_TRAZA("➡️ SIMULACIÓN: " << comando);
         return "SIM:OK";
     }
 
@@ -86,11 +87,11 @@ std::string ComunicacionControladorSimple::enviarComando(const std::string& coma
     }
     cmd += "\r\n";
 
-    std::cout << "📤 ENVIANDO: '" << comando << "'" << std::endl;
+    CONSOLA_TRAZA("📤 ENVIANDO: '" << comando << "'");
     
     ssize_t w = write(fd, cmd.c_str(), cmd.length());
     if (w < 0) {
-        std::cerr << "❌ Error escribiendo: " << strerror(errno) << std::endl;
+        CONSOLA_ERROR("❌ Error escribiendo: " << strerror(errno));
         return "ERROR:WRITE";
     }
     tcdrain(fd);
@@ -114,7 +115,7 @@ std::string ComunicacionControladorSimple::recibirRespuesta(int timeout_ms) {
     bool response_complete = false;
     bool received_anything = false;
     
-    std::cout << "📥 Esperando respuesta..." << std::endl;
+    CONSOLA_TRAZA("📥 Esperando respuesta...");
 
     while (true) {
         // Verificar timeout
@@ -123,7 +124,7 @@ std::string ComunicacionControladorSimple::recibirRespuesta(int timeout_ms) {
             current_time - start_time).count();
         
         if (elapsed > timeout_ms) {
-            std::cout << "⏰ Timeout después de " << elapsed << "ms" << std::endl;
+            CONSOLA_AVISO("⏰ Timeout después de " << elapsed << "ms");
             break;
         }
 
@@ -134,7 +135,7 @@ std::string ComunicacionControladorSimple::recibirRespuesta(int timeout_ms) {
             respuesta += buffer;
             received_anything = true;
             
-            std::cout << "📥 Recibido: " << buffer;
+            CONSOLA_TRAZA("📥 Recibido: " << buffer);
             
             // Verificar si tenemos "ok" o "error" (como en el test)
             std::string resp_lower = respuesta;
@@ -143,7 +144,7 @@ std::string ComunicacionControladorSimple::recibirRespuesta(int timeout_ms) {
             if (resp_lower.find("ok") != std::string::npos || 
                 resp_lower.find("error") != std::string::npos) {
                 
-                std::cout << "✅ Respuesta completa detectada" << std::endl;
+                CONSOLA_TRAZA("✅ Respuesta completa detectada");
                 response_complete = true;
                 
                 // ESPERAR 500ms EXTRA para datos pendientes (COMO EL TEST)
@@ -153,7 +154,7 @@ std::string ComunicacionControladorSimple::recibirRespuesta(int timeout_ms) {
                     if (n > 0) {
                         buffer[n] = '\0';
                         respuesta += buffer;
-                        std::cout << "📥 Extra: " << buffer;
+                        CONSOLA_TRAZA("📥 Extra: " << buffer);
                     }
                     std::this_thread::sleep_for(std::chrono::milliseconds(10));
                 }
@@ -172,7 +173,7 @@ std::string ComunicacionControladorSimple::recibirRespuesta(int timeout_ms) {
         } else {
             // Error de lectura
             if (errno != EAGAIN && errno != EWOULDBLOCK) {
-                std::cerr << "❌ Error leyendo: " << strerror(errno) << std::endl;
+                CONSOLA_ERROR("❌ Error leyendo: " << strerror(errno));
                 break;
             }
             std::this_thread::sleep_for(std::chrono::milliseconds(10));
@@ -191,8 +192,7 @@ std::string ComunicacionControladorSimple::recibirRespuesta(int timeout_ms) {
         }
     }
 
-    std::cout << "📥 RESPUESTA FINAL (" << respuesta.length() << " chars):" << std::endl;
-    std::cout << respuesta << std::endl;
+    CONSOLA_DEBUG("📥 RESPUESTA FINAL (" << respuesta.length() << " chars):\n" << respuesta);
     
     return respuesta.empty() ? "TIMEOUT" : respuesta;
 }
\ No newline at end of file
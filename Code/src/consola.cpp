@@ -0,0 +1,51 @@
+#include "consola.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+int nivelInicial() {
+    NivelConsola n = NivelConsola::INFO;
+    if (const char* env = std::getenv("CONSOLA_NIVEL")) consola::nivelDesdeTexto(env, n);
+    return static_cast<int>(n);
+}
+
+const char* const kNombres[] = {"traza", "debug", "info", "aviso", "error", "nada"};
+}
+
+namespace consola {
+
+std::atomic<int> nivelActual{nivelInicial()};
+
+void fijarNivel(NivelConsola n) {
+    nivelActual.store(static_cast<int>(n), std::memory_order_relaxed);
+}
+
+NivelConsola nivel() {
+    return static_cast<NivelConsola>(nivelActual.load(std::memory_order_relaxed));
+}
+
+bool nivelDesdeTexto(const std::string& texto, NivelConsola& n) {
+    for (int i = 0; i <= static_cast<int>(NivelConsola::NADA); ++i) {
+        if (texto == kNombres[i] || texto == std::to_string(i)) {
+            n = static_cast<NivelConsola>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* nombreNivel(NivelConsola n) {
+    const int i = static_cast<int>(n);
+    return i >= 0 && i <= static_cast<int>(NivelConsola::NADA) ? kNombres[i] : "?";
+}
+
+void escribir(NivelConsola n, const std::string& mensaje) {
+    // Un solo fwrite por mensaje (stdio bloquea el FILE): no se mezclan
+    // líneas de hilos distintos y se respeta el orden con std::cout
+    std::string linea = mensaje;
+    if (linea.empty() || linea.back() != '\n') linea += '\n';
+    std::fwrite(linea.data(), 1, linea.size(), n >= NivelConsola::AVISO ? stderr : stdout);
+}
+
+} // namespace consola
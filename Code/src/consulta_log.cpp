@@ -0,0 +1,299 @@
+#include "consulta_log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <unordered_set>
+
+#include <sys/stat.h>
+#include <zlib.h>
+
+IndiceLog indiceLog; // definición de la instancia global
+
+namespace fs = std::filesystem;
+
+namespace {
+enum Campo : uint32_t { DETALLE = 1, USUARIO, NODO, MODULO };
+
+uint64_t bitHuella(uint32_t id, Campo campo) {
+    return 1ull << (((id * 0x9E3779B1u) ^ (campo * 0x85EBCA6Bu)) >> 26);
+}
+
+bool terminaEn(const std::string& s, const char* sufijo) {
+    const size_t n = std::char_traits<char>::length(sufijo);
+    return s.size() >= n && s.compare(s.size() - n, n, sufijo) == 0;
+}
+
+uint16_t claseCodigo(int codigo) {
+    return static_cast<uint16_t>(1u << std::clamp(codigo / 100, 0, 15));
+}
+
+// Sólo la cabecera: alcanza para ordenar y descartar por tiempo sin descomprimir
+bool leerCabecera(const std::string& ruta, int64_t& msBase) {
+    gzFile f = gzopen(ruta.c_str(), "rb");
+    if (!f) return false;
+    char buf[16];
+    const int n = gzread(f, buf, sizeof(buf));
+    gzclose(f);
+    if (n <= 0) return false;
+    std::vector<std::string> tabla;
+    registro_log::Lector lector(std::string_view(buf, static_cast<size_t>(n)), tabla);
+    return lector.cabecera(&msBase);
+}
+}
+
+IndiceLog::IndiceLog(const std::string& ruta) : base(ruta) {
+    if (!fs::path(base).has_parent_path()) base = (fs::path("logs") / base).string();
+}
+
+void IndiceLog::sincronizar() {
+    const fs::path p(base);
+    const std::string prefijo = p.filename().string();
+    std::map<std::string, struct stat> actuales;
+    std::error_code ec;
+    for (const auto& e : fs::directory_iterator(p.parent_path(), ec)) {
+        const std::string nombre = e.path().filename().string();
+        const bool archivado = nombre.rfind(prefijo + "-", 0) == 0 &&
+                               (terminaEn(nombre, ".blog") || terminaEn(nombre, ".blog.gz"));
+        if (!archivado && nombre != prefijo + ".blog") continue;
+        struct stat st;
+        if (::stat(e.path().c_str(), &st) == 0) actuales.emplace(e.path().string(), st);
+    }
+
+    // Un índice sin archivo (o cuyo archivo ya es otro) puede seguir valiendo
+    // con otro nombre: el activo que rotó o un archivado que pasó a .gz
+    std::unordered_set<std::string> huerfanos;
+    for (const auto& [ruta, s] : segmentos) {
+        auto it = actuales.find(ruta);
+        if (it == actuales.end() || static_cast<uint64_t>(it->second.st_ino) != s.inodo) huerfanos.insert(ruta);
+    }
+    auto adoptar = [&](const std::string& ruta, std::map<std::string, Segmento>& destino, const std::string& nueva) {
+        auto nodo = segmentos.extract(ruta);
+        huerfanos.erase(ruta);
+        nodo.key() = nueva;
+        return destino.insert(std::move(nodo)).position;
+    };
+
+    std::map<std::string, Segmento> nuevos;
+    for (const auto& [ruta, st] : actuales) {
+        const bool comprimido = terminaEn(ruta, ".gz");
+        const uint64_t inodo = static_cast<uint64_t>(st.st_ino);
+        std::map<std::string, Segmento>::iterator it;
+        if (segmentos.count(ruta) && !huerfanos.count(ruta)) {
+            it = adoptar(ruta, nuevos, ruta);
+        } else if (comprimido && huerfanos.count(ruta.substr(0, ruta.size() - 3))) {
+            it = adoptar(ruta.substr(0, ruta.size() - 3), nuevos, ruta);
+            // El .gz puede tener una cola que no se llegó a leer del plano
+            it->second.comprimido = true;
+            it->second.completo = false;
+            std::string().swap(it->second.datos);
+        } else {
+            auto previo = std::find_if(huerfanos.begin(), huerfanos.end(), [&](const std::string& h) {
+                const Segmento& s = segmentos.at(h);
+                return !comprimido && !s.comprimido && s.inodo == inodo;
+            });
+            if (previo != huerfanos.end()) {
+                const std::string anterior = *previo;
+                it = adoptar(anterior, nuevos, ruta);
+            } else {
+                it = nuevos.emplace(ruta, Segmento{}).first;
+                Segmento& s = it->second;
+                s.comprimido = comprimido;
+                s.valido = leerCabecera(ruta, s.msBase);
+            }
+        }
+        Segmento& s = it->second;
+        s.ruta = ruta;
+        s.inodo = inodo;
+        s.tamanoDisco = static_cast<uint64_t>(st.st_size);
+        if (!s.comprimido && s.indexado && s.tamanoDisco < s.tamanoIndexado) {
+            // Truncado: se vuelve a indexar desde cero
+            Segmento limpio;
+            limpio.ruta = ruta;
+            limpio.inodo = inodo;
+            limpio.tamanoDisco = s.tamanoDisco;
+            limpio.valido = leerCabecera(ruta, limpio.msBase);
+            s = std::move(limpio);
+        }
+        if (!s.valido && !s.indexado) s.valido = leerCabecera(ruta, s.msBase);
+    }
+    segmentos = std::move(nuevos);
+}
+
+bool IndiceLog::cargarDatos(Segmento& s) {
+    if (s.comprimido) {
+        return !s.datos.empty() || registro_log::cargarSegmento(s.ruta, s.datos);
+    }
+    // Plano: sólo se lee lo que falta (el activo sólo crece)
+    std::ifstream in(s.ruta, std::ios::binary);
+    if (!in) return false;
+    in.seekg(static_cast<std::streamoff>(s.datos.size()));
+    char buf[64 * 1024];
+    while (in.read(buf, sizeof(buf)) || in.gcount() > 0) s.datos.append(buf, static_cast<size_t>(in.gcount()));
+    return true;
+}
+
+bool IndiceLog::indexar(Segmento& s) {
+    if (!s.valido) return false;
+    const bool alDia = s.indexado && (s.comprimido ? s.completo : s.tamanoDisco <= s.tamanoIndexado);
+    if (alDia) return true;
+    if (!cargarDatos(s)) return false;
+    s.ultimoUso = ++reloj;
+
+    registro_log::Lector lector(s.datos, s.tabla);
+    if (!s.indexado) {
+        if (!lector.cabecera(&s.msBase)) {
+            s.valido = false;
+            return false;
+        }
+        s.msFinal = s.msBase;
+        s.indexado = true;
+    } else {
+        lector.posicionar(s.finIndexado, s.msFinal);
+    }
+
+    registro_log::RegistroCrudo c;
+    for (;;) {
+        const size_t desplazamiento = lector.posicion();
+        const int64_t msPrevio = lector.ultimoMs();
+        if (!lector.siguiente(c)) break;
+        if (s.bloques.empty() || s.bloques.back().registros >= kRegistrosPorBloque) {
+            Bloque b;
+            b.desplazamiento = desplazamiento;
+            b.msPrevio = msPrevio;
+            s.bloques.push_back(b);
+        }
+        Bloque& b = s.bloques.back();
+        ++b.registros;
+        b.msMin = std::min(b.msMin, c.ms);
+        b.msMax = std::max(b.msMax, c.ms);
+        b.categorias |= static_cast<uint8_t>(1u << c.categoria);
+        b.huella |= bitHuella(c.usuario, USUARIO);
+        if (c.categoria == RegistroLog::PETICION) {
+            b.clasesCodigo |= claseCodigo(c.codigo);
+            b.huella |= bitHuella(c.detalle, DETALLE) | bitHuella(c.nodo, NODO);
+        } else {
+            b.huella |= bitHuella(c.modulo, MODULO);
+        }
+        s.msMin = std::min(s.msMin, c.ms);
+        s.msMax = std::max(s.msMax, c.ms);
+        s.categorias |= b.categorias;
+        s.clasesCodigo |= b.clasesCodigo;
+        ++s.registros;
+    }
+    s.finIndexado = lector.posicion();
+    s.msFinal = lector.ultimoMs();
+    s.tamanoIndexado = s.datos.size();
+    s.completo = s.comprimido;
+    for (uint32_t i = static_cast<uint32_t>(s.ids.size()); i < s.tabla.size(); ++i) s.ids.emplace(s.tabla[i], i);
+    return true;
+}
+
+void IndiceLog::recortarCache(const Segmento& enUso) {
+    size_t total = 0;
+    for (const auto& [ruta, s] : segmentos) total += s.datos.size();
+    while (total > kCacheBytes) {
+        Segmento* victima = nullptr;
+        for (auto& [ruta, s] : segmentos) {
+            if (&s == &enUso || s.datos.empty()) continue;
+            if (!victima || s.ultimoUso < victima->ultimoUso) victima = &s;
+        }
+        if (!victima) return;
+        total -= victima->datos.size();
+        std::string().swap(victima->datos);
+    }
+}
+
+EstadisticasConsulta IndiceLog::consultar(const FiltroLog& f, const std::function<bool(const RegistroLog&)>& visitar) {
+    const auto inicio = std::chrono::steady_clock::now();
+    EstadisticasConsulta est;
+    std::lock_guard<std::mutex> l(mtx);
+    sincronizar();
+
+    std::vector<Segmento*> orden;
+    for (auto& [ruta, s] : segmentos) {
+        if (s.valido) orden.push_back(&s);
+    }
+    std::sort(orden.begin(), orden.end(), [](const Segmento* a, const Segmento* b) {
+        return a->msBase != b->msBase ? a->msBase < b->msBase : a->ruta < b->ruta;
+    });
+    est.segmentos = static_cast<uint32_t>(orden.size());
+
+    const uint8_t categorias = f.categorias ? static_cast<uint8_t>(f.categorias) : 0xFF;
+    uint16_t clases = 0;
+    if (f.codigoMin > 0 || f.codigoMax > 0) {
+        const int desde = std::max(f.codigoMin, 0), hasta = f.codigoMax > 0 ? f.codigoMax : 999;
+        for (int c = desde / 100; c <= hasta / 100 && c < 16; ++c) clases |= static_cast<uint16_t>(1u << c);
+    }
+
+    bool seguir = true;
+    RegistroLog r;
+    for (size_t i = 0; i < orden.size() && seguir; ++i) {
+        Segmento& s = *orden[i];
+        // Todo lo de un segmento es anterior a la cabecera del siguiente
+        if (i + 1 < orden.size() && orden[i + 1]->msBase < f.desdeMs) continue;
+        if (s.msBase - kMargenMs > f.hastaMs) continue;
+        if (!indexar(s) || s.registros == 0) continue;
+        if (s.msMax < f.desdeMs || s.msMin > f.hastaMs) continue;
+        if (!(s.categorias & categorias) || (clases && !(s.clasesCodigo & clases))) continue;
+
+        // Lo buscado tiene que estar en la tabla del segmento
+        uint32_t idUsuario = registro_log::RegistroCrudo::kSinId, idNodo = idUsuario, idModulo = idUsuario;
+        uint64_t huella = 0;
+        auto resolver = [&](const std::string& valor, Campo campo, uint32_t& id) {
+            if (valor.empty()) return true;
+            auto it = s.ids.find(valor);
+            if (it == s.ids.end()) return false;
+            id = it->second;
+            huella |= bitHuella(id, campo);
+            return true;
+        };
+        if (!resolver(f.usuario, USUARIO, idUsuario) || !resolver(f.nodo, NODO, idNodo) ||
+            !resolver(f.modulo, MODULO, idModulo)) {
+            continue;
+        }
+        if (!cargarDatos(s)) continue;
+        s.ultimoUso = ++reloj;
+        ++est.segmentosLeidos;
+
+        registro_log::Lector lector(std::string_view(s.datos).substr(0, s.finIndexado), s.tabla);
+        registro_log::RegistroCrudo c;
+        for (const Bloque& b : s.bloques) {
+            ++est.bloques;
+            if (!seguir || b.msMax < f.desdeMs || b.msMin > f.hastaMs || !(b.categorias & categorias) ||
+                (clases && !(b.clasesCodigo & clases)) || (b.huella & huella) != huella) {
+                continue;
+            }
+            ++est.bloquesLeidos;
+            lector.posicionar(b.desplazamiento, b.msPrevio);
+            for (uint32_t k = 0; k < b.registros && lector.siguiente(c); ++k) {
+                ++est.registrosLeidos;
+                if (c.ms < f.desdeMs || c.ms > f.hastaMs || !(categorias & (1u << c.categoria))) continue;
+                if (idUsuario != registro_log::RegistroCrudo::kSinId && c.usuario != idUsuario) continue;
+                if (idNodo != registro_log::RegistroCrudo::kSinId && c.nodo != idNodo) continue;
+                if (idModulo != registro_log::RegistroCrudo::kSinId && c.modulo != idModulo) continue;
+                if (clases) {
+                    if (c.categoria != RegistroLog::PETICION) continue;
+                    if (f.codigoMin > 0 && c.codigo < f.codigoMin) continue;
+                    if (f.codigoMax > 0 && c.codigo > f.codigoMax) continue;
+                }
+                if (!f.texto.empty()) {
+                    const std::string_view donde = c.categoria == RegistroLog::PETICION
+                                                       ? std::string_view(s.tabla[c.detalle])
+                                                       : c.mensaje;
+                    if (donde.find(f.texto) == std::string_view::npos) continue;
+                }
+                ++est.coincidencias;
+                lector.materializar(c, r);
+                if (!visitar(r)) {
+                    seguir = false;
+                    break;
+                }
+            }
+        }
+        recortarCache(s);
+    }
+    est.milisegundos = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - inicio).count();
+    return est;
+}
@@ -0,0 +1,234 @@
+#include "conversor_csv.h"
+#include "archivo_io.h"
+#include "programa_gcode.h"
+#include "almacen_blobs.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+constexpr size_t kBloqueSalida = 64 * 1024;
+
+bool igualSinMayusculas(const std::string& a, const char* b) {
+    const size_t n = std::strlen(b);
+    if (a.size() != n) return false;
+    for (size_t i = 0; i < n; ++i) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != b[i]) return false;
+    }
+    return true;
+}
+
+int abrirTmp(const std::string& ruta) {
+    return ::open((ruta + ".tmp").c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+}
+}
+
+ConversorCsvGcode::ConversorCsvGcode(std::string gcode, std::string csv)
+    : rutaGcode(std::move(gcode)), rutaCsv(std::move(csv)),
+      hashGcode(gcode::kSemillaHash), hashCsv(gcode::kSemillaHash) {
+    r.rutaGcode = rutaGcode;
+    r.rutaCsv = rutaCsv;
+}
+
+ConversorCsvGcode::~ConversorCsvGcode() {
+    if (fdGcode >= 0 || fdCsv >= 0) abortar("Conversión sin terminar");
+}
+
+bool ConversorCsvGcode::abrir() {
+    fdGcode = abrirTmp(rutaGcode);
+    if (fdGcode < 0) return false;
+    if (!rutaCsv.empty()) {
+        fdCsv = abrirTmp(rutaCsv);
+        if (fdCsv < 0) {
+            abortar("No se pudo crear el CSV");
+            return false;
+        }
+    }
+    salida.reserve(kBloqueSalida + kMaxCampo);
+    campo.reserve(256);
+    return true;
+}
+
+void ConversorCsvGcode::agregar(char c) {
+    if (campo.size() >= kMaxCampo) {
+        campoCortado = true;
+        return;
+    }
+    campo.push_back(c);
+    hayDatosFila = true;
+}
+
+void ConversorCsvGcode::finCampo() {
+    if (esCabecera) {
+        cabecera.push_back(campo);
+    } else if (columna == columnaGcode) {
+        valor.swap(campo);
+    }
+    campo.clear();
+    ++columna;
+}
+
+void ConversorCsvGcode::anotarError(const std::string& motivo) {
+    ++r.invalidas;
+    if (r.errores.size() < kMaxErrores) r.errores.push_back({lineaFila, motivo});
+}
+
+void ConversorCsvGcode::finFila() {
+    finCampo();
+    if (esCabecera) {
+        esCabecera = false;
+        for (size_t i = 0; i < cabecera.size(); ++i) {
+            if (igualSinMayusculas(cabecera[i], "gcode")) {
+                columnaGcode = i;
+                break;
+            }
+        }
+        cabecera.clear();
+    } else if (!hayDatosFila || std::all_of(valor.begin(), valor.end(), [](unsigned char c) { return std::isspace(c); })) {
+        ++r.filas;
+        ++r.vacias;
+    } else {
+        ++r.filas;
+        if (filaConSaltos) {
+            // Un G-code no puede ocupar varias líneas: no se escribe
+            anotarError("salto de línea dentro del campo");
+        } else {
+            if (campoCortado) {
+                anotarError("línea de más de " + std::to_string(kMaxCampo) + " caracteres (cortada)");
+            } else if (filaMalFormada) {
+                anotarError("comillas mal cerradas");
+            }
+            salida += valor;
+            salida += '\n';
+            ++r.lineasGcode;
+            origenLineas.push_back(static_cast<uint32_t>(lineaFila));
+            if (salida.size() >= kBloqueSalida) volcar();
+        }
+    }
+    valor.clear();
+    columna = 0;
+    filaConSaltos = filaMalFormada = campoCortado = hayDatosFila = false;
+    lineaFila = lineaFisica;
+}
+
+bool ConversorCsvGcode::volcar() {
+    if (salida.empty() || fallo) return !fallo;
+    hashGcode = gcode::hashContenido(salida, hashGcode);
+    if (!escribirTodo(fdGcode, salida.data(), salida.size())) fallo = true;
+    salida.clear();
+    return !fallo;
+}
+
+bool ConversorCsvGcode::alimentar(const char* datos, size_t n) {
+    if (fallo || fdGcode < 0) return false;
+    r.bytesCsv += n;
+    if (fdCsv >= 0) {
+        hashCsv = gcode::hashContenido(std::string_view(datos, n), hashCsv);
+        if (!escribirTodo(fdCsv, datos, n)) {
+            fallo = true;
+            return false;
+        }
+    }
+    for (size_t i = 0; i < n; ++i) {
+        const char c = datos[i];
+        if (c == '\n') ++lineaFisica;
+        switch (estado) {
+            case Estado::INICIO_CAMPO:
+            case Estado::CAMPO:
+                if (c == '"' && estado == Estado::INICIO_CAMPO) {
+                    estado = Estado::COMILLAS;
+                    hayDatosFila = true;
+                } else if (c == ',') {
+                    finCampo();
+                    estado = Estado::INICIO_CAMPO;
+                } else if (c == '\n') {
+                    finFila();
+                    estado = Estado::INICIO_CAMPO;
+                } else if (c != '\r') {
+                    // Una comilla suelta en un campo sin comillas se acepta tal cual
+                    agregar(c);
+                    estado = Estado::CAMPO;
+                }
+                break;
+            case Estado::COMILLAS:
+                if (c == '"') {
+                    estado = Estado::COMILLA;
+                } else {
+                    if (c == '\n') filaConSaltos = true;
+                    agregar(c);
+                }
+                break;
+            case Estado::COMILLA:
+                if (c == '"') {         // "" dentro de comillas
+                    agregar('"');
+                    estado = Estado::COMILLAS;
+                } else if (c == ',') {
+                    finCampo();
+                    estado = Estado::INICIO_CAMPO;
+                } else if (c == '\n') {
+                    finFila();
+                    estado = Estado::INICIO_CAMPO;
+                } else if (c != '\r') {
+                    filaMalFormada = true;
+                    agregar(c);
+                    estado = Estado::CAMPO;
+                }
+                break;
+        }
+    }
+    return volcar();
+}
+
+uint64_t ConversorCsvGcode::lineaCsv(uint64_t lineaGcode) const {
+    if (lineaGcode == 0 || lineaGcode > origenLineas.size()) return 0;
+    return origenLineas[lineaGcode - 1];
+}
+
+ResultadoConversion ConversorCsvGcode::terminar() {
+    if (fdGcode < 0) {
+        if (r.error.empty()) r.error = "Conversión no iniciada";
+        return r;
+    }
+    if (estado == Estado::COMILLAS) filaMalFormada = true;
+    // Última fila sin salto final
+    if (hayDatosFila || columna > 0) finFila();
+    volcar();
+    if (fallo) {
+        abortar(std::string("Error escribiendo: ") + std::strerror(errno));
+        return r;
+    }
+    bool ok = ::fdatasync(fdGcode) == 0;
+    if (fdCsv >= 0) ok = (::fdatasync(fdCsv) == 0) && ok;
+    cerrar();
+    // Una subida repetida (o idéntica a otro trabajo) no ocupa disco de más
+    ok = ok && almacenBlobs.publicar(rutaGcode + ".tmp", hashGcode, rutaGcode);
+    if (ok && !rutaCsv.empty()) ok = almacenBlobs.publicar(rutaCsv + ".tmp", hashCsv, rutaCsv);
+    if (!ok) {
+        ::unlink((rutaGcode + ".tmp").c_str());
+        if (!rutaCsv.empty()) ::unlink((rutaCsv + ".tmp").c_str());
+        r.error = std::string("No se pudo publicar el resultado: ") + std::strerror(errno);
+        return r;
+    }
+    r.ok = true;
+    r.hashGcode = hashGcode;
+    return r;
+}
+
+void ConversorCsvGcode::cerrar() {
+    if (fdGcode >= 0) ::close(fdGcode);
+    if (fdCsv >= 0) ::close(fdCsv);
+    fdGcode = fdCsv = -1;
+}
+
+void ConversorCsvGcode::abortar(const std::string& motivo) {
+    cerrar();
+    ::unlink((rutaGcode + ".tmp").c_str());
+    if (!rutaCsv.empty()) ::unlink((rutaCsv + ".tmp").c_str());
+    r.ok = false;
+    r.error = motivo;
+}
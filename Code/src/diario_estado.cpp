@@ -0,0 +1,492 @@
+#include "diario_estado.h"
+#include "archivo_io.h"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+DiarioEstado diarioEstado; // definición de la instancia global
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr char kMagiaSnapshot[4] = {'D', 'E', 'S', '1'};
+constexpr uint64_t kMaxBytesDiario = 4u << 20;     // compactar al superar 4 MB
+constexpr int64_t kIntervaloSyncMs = 1000;
+constexpr int64_t kIntervaloProgresoMs = 500;
+constexpr uint32_t kMaxLargoRegistro = 1u << 20;
+
+enum TipoRegistro : uint8_t {
+    REG_ROBOT = 1,
+    REG_REMOTO,
+    REG_APRENDIZAJE,
+    REG_TRABAJO_INICIO,
+    REG_TRABAJO_PROGRESO,
+    REG_TRABAJO_FIN,
+    REG_SESION_ALTA,
+    REG_SESION_BAJA
+};
+
+int64_t ahoraMs() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+uint32_t crc32(const char* datos, size_t n) {
+    static const auto tabla = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1u) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < n; ++i) c = tabla[(c ^ static_cast<uint8_t>(datos[i])) & 0xFFu] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+template <typename T>
+void escribirPod(std::string& out, const T& v) {
+    out.append(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+void escribirTexto(std::string& out, const std::string& s) {
+    escribirPod(out, static_cast<uint32_t>(s.size()));
+    out += s;
+}
+
+struct Lector {
+    std::string_view datos;
+    bool ok = true;
+
+    template <typename T>
+    T pod() {
+        T v{};
+        if (datos.size() < sizeof(T)) {
+            ok = false;
+            return v;
+        }
+        std::memcpy(&v, datos.data(), sizeof(T));
+        datos.remove_prefix(sizeof(T));
+        return v;
+    }
+    std::string texto() {
+        const uint32_t n = pod<uint32_t>();
+        if (!ok || datos.size() < n) {
+            ok = false;
+            return {};
+        }
+        std::string s(datos.substr(0, n));
+        datos.remove_prefix(n);
+        return s;
+    }
+};
+
+// [largo u32][crc u32][tipo u8][datos]; largo y crc cubren tipo + datos
+std::string codificar(uint8_t tipo, const std::string& datos) {
+    std::string cuerpo;
+    cuerpo.reserve(datos.size() + 1);
+    cuerpo.push_back(static_cast<char>(tipo));
+    cuerpo += datos;
+    std::string out;
+    out.reserve(cuerpo.size() + 8);
+    escribirPod(out, static_cast<uint32_t>(cuerpo.size()));
+    escribirPod(out, crc32(cuerpo.data(), cuerpo.size()));
+    out += cuerpo;
+    return out;
+}
+
+std::string datosRobot(const EstadoPersistido::Robot& r) {
+    std::string d;
+    escribirPod(d, r.x);
+    escribirPod(d, r.y);
+    escribirPod(d, r.z);
+    escribirPod(d, r.e);
+    const uint8_t flags = static_cast<uint8_t>((r.motores ? 1 : 0) | (r.garra ? 2 : 0) |
+                                               (r.modoAbs ? 4 : 0) | (r.emergencia ? 8 : 0));
+    escribirPod(d, flags);
+    return d;
+}
+
+// Aplica un registro al estado. false si los datos no tienen el formato esperado.
+bool aplicar(EstadoPersistido& st, uint8_t tipo, std::string_view datos) {
+    Lector in{datos};
+    switch (tipo) {
+        case REG_ROBOT: {
+            EstadoPersistido::Robot r;
+            r.x = in.pod<float>();
+            r.y = in.pod<float>();
+            r.z = in.pod<float>();
+            r.e = in.pod<float>();
+            const uint8_t flags = in.pod<uint8_t>();
+            r.motores = flags & 1;
+            r.garra = flags & 2;
+            r.modoAbs = flags & 4;
+            r.emergencia = flags & 8;
+            if (!in.ok) return false;
+            st.robot = r;
+            st.hayRobot = true;
+            return true;
+        }
+        case REG_REMOTO: {
+            const uint8_t on = in.pod<uint8_t>();
+            if (!in.ok) return false;
+            st.remoto = on != 0;
+            st.hayRemoto = true;
+            return true;
+        }
+        case REG_APRENDIZAJE: {
+            const uint8_t activo = in.pod<uint8_t>();
+            std::string ruta = in.texto();
+            if (!in.ok) return false;
+            st.aprendiendo = activo != 0;
+            st.rutaAprendizaje = std::move(ruta);
+            return true;
+        }
+        case REG_TRABAJO_INICIO: {
+            EstadoPersistido::Trabajo t;
+            t.ruta = in.texto();
+            t.hash = in.pod<uint64_t>();
+            t.inicioMs = in.pod<int64_t>();
+            if (!in.ok) return false;
+            t.activo = true;
+            st.trabajo = std::move(t);
+            return true;
+        }
+        case REG_TRABAJO_PROGRESO: {
+            const uint32_t linea = in.pod<uint32_t>();
+            if (!in.ok) return false;
+            st.trabajo.linea = linea;
+            return true;
+        }
+        case REG_TRABAJO_FIN:
+            st.trabajo.activo = false;
+            return true;
+        case REG_SESION_ALTA: {
+            std::string token = in.texto();
+            EstadoPersistido::Sesion s;
+            s.usuario = in.texto();
+            s.privilegio = in.texto();
+            // Los registros anteriores terminaban en el privilegio
+            if (in.ok && !in.datos.empty()) s.creadaMs = in.pod<int64_t>();
+            if (!in.ok) return false;
+            st.sesiones[token] = std::move(s);
+            return true;
+        }
+        case REG_SESION_BAJA: {
+            std::string token = in.texto();
+            if (!in.ok) return false;
+            st.sesiones.erase(token);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Recorre registros completos y válidos; devuelve los bytes consumidos.
+size_t reproducir(std::string_view buf, EstadoPersistido& st, size_t& registros) {
+    size_t pos = 0;
+    while (buf.size() - pos >= 8) {
+        uint32_t largo = 0, crc = 0;
+        std::memcpy(&largo, buf.data() + pos, 4);
+        std::memcpy(&crc, buf.data() + pos + 4, 4);
+        if (largo == 0 || largo > kMaxLargoRegistro || buf.size() - pos - 8 < largo) break;
+        const char* cuerpo = buf.data() + pos + 8;
+        if (crc32(cuerpo, largo) != crc) break;
+        if (!aplicar(st, static_cast<uint8_t>(cuerpo[0]), std::string_view(cuerpo + 1, largo - 1))) break;
+        pos += 8 + largo;
+        ++registros;
+    }
+    return pos;
+}
+
+std::string leerArchivo(const std::string& ruta) {
+    std::ifstream in(ruta, std::ios::binary);
+    if (!in) return {};
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+}
+
+DiarioEstado::DiarioEstado(std::string dir) : directorio(std::move(dir)) {
+    escritorRobot = std::thread(&DiarioEstado::bucleRobot, this);
+}
+
+DiarioEstado::~DiarioEstado() {
+    {
+        std::lock_guard<std::mutex> l(mtxEscritor);
+        pararEscritor = true;
+    }
+    cvEscritor.notify_one();
+    if (escritorRobot.joinable()) escritorRobot.join();   // escribe lo que quedó encolado
+    if (const uint64_t perdidos = robotDescartados.load()) {
+        std::cerr << "⚠️ Diario de estado: " << perdidos << " cambios intermedios del robot sin registrar (cola llena)" << std::endl;
+    }
+    if (fd >= 0) {
+        ::fdatasync(fd);
+        ::close(fd);
+    }
+}
+
+std::string DiarioEstado::rutaDiario() const { return (fs::path(directorio) / "diario.log").string(); }
+std::string DiarioEstado::rutaSnapshot() const { return (fs::path(directorio) / "snapshot.bin").string(); }
+
+bool DiarioEstado::abrirDiarioLocked(bool truncar) {
+    if (fd >= 0) ::close(fd);
+    int flags = O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC;
+    if (truncar) flags |= O_TRUNC;
+    fd = ::open(rutaDiario().c_str(), flags, 0644);
+    if (fd < 0) {
+        std::cerr << "❌ No se pudo abrir el diario de estado: " << rutaDiario() << std::endl;
+        return false;
+    }
+    if (truncar) bytesDiario = 0;
+    return true;
+}
+
+ReporteRecuperacion DiarioEstado::recuperar() {
+    const auto inicio = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mtx);
+    ReporteRecuperacion rep;
+    std::error_code ec;
+    fs::create_directories(directorio, ec);
+
+    EstadoPersistido st;
+    const std::string snap = leerArchivo(rutaSnapshot());
+    if (snap.size() >= sizeof(kMagiaSnapshot) &&
+        std::memcmp(snap.data(), kMagiaSnapshot, sizeof(kMagiaSnapshot)) == 0) {
+        size_t n = 0;
+        std::string_view cuerpo(snap.data() + sizeof(kMagiaSnapshot), snap.size() - sizeof(kMagiaSnapshot));
+        // El snapshot se escribe entero antes del rename: si no cierra, se ignora
+        if (reproducir(cuerpo, st, n) == cuerpo.size()) {
+            rep.snapshot = true;
+        } else {
+            st = EstadoPersistido{};
+            std::cerr << "⚠️ Snapshot de estado inválido, se usa sólo el diario" << std::endl;
+        }
+    }
+
+    const std::string diario = leerArchivo(rutaDiario());
+    const size_t validos = reproducir(diario, st, rep.registros);
+    rep.bytesDescartados = diario.size() - validos;
+    estado = std::move(st);
+
+    // Se corta la cola rota para que lo nuevo no quede detrás de basura
+    if (rep.bytesDescartados > 0) {
+        ::truncate(rutaDiario().c_str(), static_cast<off_t>(validos));
+    }
+    bytesDiario = validos;
+    abrirDiarioLocked(false);
+    rep.milisegundos = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - inicio).count();
+    return rep;
+}
+
+EstadoPersistido DiarioEstado::copia() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return estado;
+}
+
+EstadoPersistido::Trabajo DiarioEstado::trabajo() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return estado.trabajo;
+}
+
+void DiarioEstado::agregarLocked(uint8_t tipo, const std::string& datos, bool sincronizar) {
+    aplicar(estado, tipo, datos);
+    if (fd < 0) return;
+    const std::string registro = codificar(tipo, datos);
+    if (!escribirTodo(fd, registro)) {
+        std::cerr << "❌ Error escribiendo el diario de estado: " << strerror(errno) << std::endl;
+        return;
+    }
+    bytesDiario += registro.size();
+    // Los cambios de posición llegan seguido: se sincronizan a lo sumo una
+    // vez por segundo; el resto (sesiones, trabajos, modo) al momento.
+    const int64_t ahora = ahoraMs();
+    if (sincronizar || ahora - ultimoSyncMs >= kIntervaloSyncMs) {
+        ::fdatasync(fd);
+        ultimoSyncMs = ahora;
+    }
+    if (bytesDiario > kMaxBytesDiario) compactarLocked();
+}
+
+void DiarioEstado::registrarRobot(const EstadoRobot::Snapshot& s) {
+    EstadoPersistido::Robot r;
+    r.x = s.x;
+    r.y = s.y;
+    r.z = s.z;
+    r.e = s.e;
+    r.motores = s.motores;
+    r.garra = s.garra;
+    r.modoAbs = s.modoAbs;
+    r.emergencia = s.emergencia;
+    std::lock_guard<std::mutex> lock(mtx);
+    agregarLocked(REG_ROBOT, datosRobot(r), false);
+}
+
+void DiarioEstado::encolarRobot(const EstadoRobot::Snapshot& s) {
+    // Sin notificar: el escritor pasa cada kPeriodoRobotMs
+    if (colaRobot.encolar(s)) return;
+    robotDescartados.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> l(mtxDesborde);
+    if (s.version >= desborde.version) desborde = s;
+    hayDesborde.store(true, std::memory_order_release);
+}
+
+void DiarioEstado::bucleRobot() {
+    EstadoRobot::Snapshot s{}, ultimo{};
+    for (;;) {
+        bool salir;
+        {
+            std::unique_lock<std::mutex> l(mtxEscritor);
+            cvEscritor.wait_for(l, std::chrono::milliseconds(kPeriodoRobotMs), [&] { return pararEscritor; });
+            salir = pararEscritor;
+        }
+        bool hay = false;
+        while (colaRobot.desencolar(s)) {
+            ultimo = s;
+            hay = true;
+        }
+        if (hayDesborde.exchange(false, std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> l(mtxDesborde);
+            if (!hay || desborde.version > ultimo.version) ultimo = desborde;
+            hay = true;
+        }
+        if (hay) registrarRobot(ultimo);
+        if (salir) return;
+    }
+}
+
+void DiarioEstado::registrarRemoto(bool on) {
+    std::string d;
+    escribirPod(d, static_cast<uint8_t>(on ? 1 : 0));
+    std::lock_guard<std::mutex> lock(mtx);
+    agregarLocked(REG_REMOTO, d, true);
+}
+
+void DiarioEstado::registrarAprendizaje(bool activo, const std::string& ruta) {
+    std::string d;
+    escribirPod(d, static_cast<uint8_t>(activo ? 1 : 0));
+    escribirTexto(d, ruta);
+    std::lock_guard<std::mutex> lock(mtx);
+    agregarLocked(REG_APRENDIZAJE, d, true);
+}
+
+void DiarioEstado::inicioTrabajo(const std::string& ruta, uint64_t hash) {
+    std::string d;
+    escribirTexto(d, ruta);
+    escribirPod(d, hash);
+    escribirPod(d, ahoraMs());
+    std::lock_guard<std::mutex> lock(mtx);
+    ultimoProgresoMs = 0;
+    agregarLocked(REG_TRABAJO_INICIO, d, true);
+}
+
+void DiarioEstado::progresoTrabajo(uint32_t linea) {
+    const int64_t ahora = ahoraMs();
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!estado.trabajo.activo) return;
+    if (ahora - ultimoProgresoMs < kIntervaloProgresoMs) {
+        estado.trabajo.linea = linea; // en memoria siempre al día
+        return;
+    }
+    ultimoProgresoMs = ahora;
+    std::string d;
+    escribirPod(d, linea);
+    agregarLocked(REG_TRABAJO_PROGRESO, d, false);
+}
+
+void DiarioEstado::finTrabajo() {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!estado.trabajo.activo) return;
+    // La última línea enviada, aunque haya caído entre dos registros de progreso
+    std::string d;
+    escribirPod(d, estado.trabajo.linea);
+    agregarLocked(REG_TRABAJO_PROGRESO, d, false);
+    agregarLocked(REG_TRABAJO_FIN, std::string(), true);
+}
+
+void DiarioEstado::altaSesion(const std::string& token, const std::string& usuario, const std::string& privilegio) {
+    std::string d;
+    escribirTexto(d, token);
+    escribirTexto(d, usuario);
+    escribirTexto(d, privilegio);
+    escribirPod(d, ahoraMs());
+    std::lock_guard<std::mutex> lock(mtx);
+    agregarLocked(REG_SESION_ALTA, d, true);
+}
+
+void DiarioEstado::bajaSesion(const std::string& token) {
+    std::string d;
+    escribirTexto(d, token);
+    std::lock_guard<std::mutex> lock(mtx);
+    // Sin fdatasync: si se pierde, la sesión vuelve al arrancar y vence de nuevo
+    agregarLocked(REG_SESION_BAJA, d, false);
+}
+
+bool DiarioEstado::compactar() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return compactarLocked();
+}
+
+bool DiarioEstado::compactarLocked() {
+    if (fd < 0) return false;
+    std::string snap(kMagiaSnapshot, sizeof(kMagiaSnapshot));
+    if (estado.hayRobot) snap += codificar(REG_ROBOT, datosRobot(estado.robot));
+    if (estado.hayRemoto) {
+        std::string d;
+        escribirPod(d, static_cast<uint8_t>(estado.remoto ? 1 : 0));
+        snap += codificar(REG_REMOTO, d);
+    }
+    {
+        std::string d;
+        escribirPod(d, static_cast<uint8_t>(estado.aprendiendo ? 1 : 0));
+        escribirTexto(d, estado.rutaAprendizaje);
+        snap += codificar(REG_APRENDIZAJE, d);
+    }
+    if (!estado.trabajo.ruta.empty() || estado.trabajo.hash != 0) {
+        std::string d;
+        escribirTexto(d, estado.trabajo.ruta);
+        escribirPod(d, estado.trabajo.hash);
+        escribirPod(d, estado.trabajo.inicioMs);
+        snap += codificar(REG_TRABAJO_INICIO, d);
+        std::string p;
+        escribirPod(p, estado.trabajo.linea);
+        snap += codificar(REG_TRABAJO_PROGRESO, p);
+        if (!estado.trabajo.activo) snap += codificar(REG_TRABAJO_FIN, std::string());
+    }
+    for (const auto& [token, s] : estado.sesiones) {
+        std::string d;
+        escribirTexto(d, token);
+        escribirTexto(d, s.usuario);
+        escribirTexto(d, s.privilegio);
+        escribirPod(d, s.creadaMs);
+        snap += codificar(REG_SESION_ALTA, d);
+    }
+
+    const std::string tmp = rutaSnapshot() + ".tmp";
+    int sfd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (sfd < 0) return false;
+    const bool ok = escribirTodo(sfd, snap) && ::fsync(sfd) == 0;
+    ::close(sfd);
+    if (!ok || ::rename(tmp.c_str(), rutaSnapshot().c_str()) != 0) {
+        ::unlink(tmp.c_str());
+        return false;
+    }
+    // El rename tiene que llegar a disco antes de vaciar el diario
+    int dfd = ::open(directorio.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dfd >= 0) {
+        ::fsync(dfd);
+        ::close(dfd);
+    }
+    return abrirDiarioLocked(true);
+}
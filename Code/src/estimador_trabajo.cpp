@@ -0,0 +1,216 @@
+#include "estimador_trabajo.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr int kEjes = 4;
+constexpr CampoGcode kCampoEje[kEjes] = {CAMPO_X, CAMPO_Y, CAMPO_Z, CAMPO_E};
+
+// Bytes aproximados de las respuestas del firmware ("INFO: LINEAR MOVE: [...]" + "OK")
+constexpr int kBytesRespuestaMovimiento = 60;
+constexpr int kBytesRespuestaSimple = 30;
+constexpr int kBitsPorByte = 10; // 8N1
+
+// Timeouts de ComunicacionControladorSimple::enviarComando
+constexpr double kTimeoutLargoS = 10.0;
+constexpr double kTimeoutCortoS = 2.0;
+
+// Muestras por movimiento para detectar la salida del espacio de trabajo
+constexpr int kMuestrasMin = 8;
+constexpr int kMuestrasMax = 64;
+
+// Fracción de 1/tmul a la que el perfil alcanza progress >= 1
+double fraccionFinal(brazo::PerfilVelocidad perfil) {
+    if (perfil == brazo::PerfilVelocidad::ARCTAN) {
+        return (std::tan(1.0) + brazo::kPi * 0.5) / brazo::kPi;
+    }
+    return 1.0;
+}
+
+// Inversa del perfil: t*tmul necesario para llegar a un progreso p
+double fraccionParaProgreso(brazo::PerfilVelocidad perfil, double p) {
+    p = std::clamp(p, 0.0, 1.0);
+    switch (perfil) {
+        case brazo::PerfilVelocidad::PLANO:
+            return p;
+        case brazo::PerfilVelocidad::ARCTAN:
+            return std::max(0.0, (std::tan(2.0 * p - 1.0) + brazo::kPi * 0.5) / brazo::kPi);
+        case brazo::PerfilVelocidad::COSENO:
+            return std::acos(1.0 - 2.0 * p) / brazo::kPi;
+    }
+    return p;
+}
+
+double segundosSerie(size_t bytes, int baudios) {
+    return static_cast<double>(bytes * kBitsPorByte) / baudios;
+}
+
+struct Movimiento {
+    double segundos = 0.0;
+    double distancia = 0.0;
+    bool fueraDeEspacio = false;
+};
+
+// Simula un G0/G1 desde `pos` hacia `destino`; deja en `pos` la posición final.
+Movimiento simularMovimiento(float pos[kEjes], const float destino[kEjes], float f,
+                             brazo::PerfilVelocidad perfil) {
+    Movimiento m;
+    double d[kEjes];
+    for (int e = 0; e < kEjes; ++e) d[e] = static_cast<double>(destino[e]) - pos[e];
+    double dist = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+    const double de = std::fabs(d[3]);
+    if (dist < de) dist = de;
+
+    double v = f;
+    if (v < 5.0) v = std::sqrt(dist) * 10.0;
+    if (v < 5.0) v = 5.0;
+    if (dist <= 0.0) {
+        for (int e = 0; e < kEjes; ++e) pos[e] = destino[e];
+        return m; // tmul infinito: termina en la primera iteración
+    }
+    const double unoSobreTmul = dist / v;
+
+    // Recorrido muestreado: el firmware detiene el movimiento en la última
+    // posición permitida en cuanto una muestra cae fuera del espacio.
+    const int muestras = std::clamp(static_cast<int>(dist), kMuestrasMin, kMuestrasMax);
+    double progresoValido = 0.0;
+    for (int k = 1; k <= muestras; ++k) {
+        const double p = static_cast<double>(k) / muestras;
+        float q[kEjes];
+        for (int e = 0; e < kEjes; ++e) q[e] = static_cast<float>(pos[e] + p * d[e]);
+        if (!brazo::dentroDelEspacio(q[0], q[1], q[2], q[3])) {
+            m.fueraDeEspacio = true;
+            m.segundos = fraccionParaProgreso(perfil, p) * unoSobreTmul;
+            m.distancia = progresoValido * dist;
+            for (int e = 0; e < kEjes; ++e) pos[e] = static_cast<float>(pos[e] + progresoValido * d[e]);
+            return m;
+        }
+        progresoValido = p;
+    }
+    m.segundos = fraccionFinal(perfil) * unoSobreTmul;
+    m.distancia = dist;
+    for (int e = 0; e < kEjes; ++e) pos[e] = destino[e];
+    return m;
+}
+}
+
+namespace gcode {
+
+EstimacionTrabajo estimarDuracion(const ProgramaGcode& programa, const OpcionesEstimador& opciones,
+                                  bool conSegmentos) {
+    EstimacionTrabajo r;
+    if (conSegmentos) r.segmentos.reserve(programa.instrucciones.size());
+
+    float pos[kEjes] = {brazo::kInicialX, brazo::kInicialY, brazo::kInicialZ, brazo::kInicialE};
+    float offset[kEjes] = {};
+    bool relativo = false;
+
+    double host = 0.0;      // instante en que el host envía la instrucción
+    double fwLibre = 0.0;   // instante en que el interpolador termina el movimiento en curso
+    double finReal = 0.0;
+
+    std::vector<InstruccionGcode> segmentosArco;
+    // Una instrucción tal como la envía RobotControllerSimple; los arcos
+    // llegan acá ya segmentados y acumulan sus cuerdas en el mismo `seg`.
+    auto enviar = [&](const InstruccionGcode& ins, SegmentoEstimado& seg, bool primera) {
+        const std::string texto = gcode::aTexto(ins);
+        const double llegada = opciones.incluirHost
+            ? host + segundosSerie(texto.size() + 2, opciones.baudios) : host;
+        // El loop del firmware sólo saca de la cola cuando terminó el movimiento anterior
+        const double inicio = std::max(llegada, fwLibre);
+        if (primera) seg.inicio = inicio;
+
+        double duracion = 0.0;
+        double bloqueo = 0.0;
+        int bytesRespuesta = kBytesRespuestaSimple;
+
+        switch (ins.op) {
+            case OpGcode::MOVER: {
+                float destino[kEjes];
+                for (int e = 0; e < kEjes; ++e) {
+                    if (!ins.tiene(kCampoEje[e])) destino[e] = pos[e];
+                    else if (relativo) destino[e] = ins.valor(kCampoEje[e]) + pos[e];
+                    else destino[e] = ins.valor(kCampoEje[e]) + offset[e];
+                }
+                const float f = ins.tiene(CAMPO_F) ? ins.valor(CAMPO_F) : 0.0f;
+                Movimiento m = simularMovimiento(pos, destino, f, opciones.perfil);
+                duracion = m.segundos;
+                if (m.fueraDeEspacio && !seg.fueraDeEspacio) {
+                    seg.fueraDeEspacio = true;
+                    ++r.fueraDeEspacio;
+                }
+                r.distanciaMm += m.distancia;
+                fwLibre = inicio + m.segundos;
+                bytesRespuesta = kBytesRespuestaMovimiento;
+                break;
+            }
+            case OpGcode::PAUSA:
+                bloqueo = ins.tiene(CAMPO_S) ? std::max(0.0f, ins.valor(CAMPO_S)) : 0.0;
+                break;
+            case OpGcode::HOME:
+                pos[0] = brazo::kInicialX;
+                pos[1] = brazo::kInicialY;
+                pos[2] = brazo::kInicialZ;
+                pos[3] = brazo::kInicialE;
+                bloqueo = opciones.segundosHome;
+                break;
+            case OpGcode::GARRA_ON:
+            case OpGcode::GARRA_OFF:
+                bloqueo = opciones.segundosGarra;
+                break;
+            case OpGcode::ABSOLUTO: relativo = false; break;
+            case OpGcode::RELATIVO: relativo = true; break;
+            case OpGcode::OFFSET:
+                for (int e = 0; e < kEjes; ++e) {
+                    float nuevo = ins.tiene(kCampoEje[e]) ? ins.valor(kCampoEje[e]) : pos[e];
+                    offset[e] = pos[e] - nuevo;
+                }
+                break;
+            default:
+                break;
+        }
+        if (bloqueo > 0.0) {
+            duracion = bloqueo;
+            fwLibre = inicio + bloqueo;
+        }
+        seg.duracion += duracion;
+        r.segundosFirmware += duracion;
+        finReal = std::max(finReal, inicio + duracion);
+
+        if (opciones.incluirHost) {
+            // El "OK" sale al terminar executeCommand: enseguida para movimientos,
+            // al final del bloqueo para G4/G28/M3/M5.
+            double respuesta = inicio + bloqueo + segundosSerie(bytesRespuesta, opciones.baudios);
+            const bool largo = ins.op == OpGcode::MOVER || ins.op == OpGcode::HOME;
+            const double timeout = largo ? kTimeoutLargoS : kTimeoutCortoS;
+            respuesta = std::min(respuesta, host + timeout);
+            host = respuesta + opciones.esperaExtraHostS;
+        } else {
+            host = inicio + bloqueo;
+        }
+    };
+
+    for (const auto& ins : programa.instrucciones) {
+        if (!ins.valida()) continue; // RobotControllerSimple no las envía
+
+        SegmentoEstimado seg;
+        seg.linea = ins.linea;
+        seg.op = ins.op;
+        if (ins.esArco()) {
+            if (gcode::segmentarArco(ins, pos, offset, relativo, opciones.arcos, segmentosArco) !=
+                ResultadoArco::OK) {
+                continue; // RobotControllerSimple lo omite
+            }
+            for (size_t k = 0; k < segmentosArco.size(); ++k) enviar(segmentosArco[k], seg, k == 0);
+        } else {
+            enviar(ins, seg, true);
+        }
+        ++r.instrucciones;
+        if (conSegmentos) r.segmentos.push_back(seg);
+    }
+    r.segundosTotales = std::max(host, finReal);
+    return r;
+}
+
+} // namespace gcode
@@ -0,0 +1,210 @@
+#include "fotogramas_aprendizaje.h"
+#include "modelo_brazo.h"
+#include "varint.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace {
+constexpr char kMagia[4] = {'T', 'C', 'H', '1'};
+constexpr float kEscala = 100.0f;       // centésimas de mm
+
+constexpr uint8_t kFlagGarra = 1u << 0;
+constexpr uint8_t kFlagFeed = 1u << 1;
+
+int32_t cuantizar(float v) { return static_cast<int32_t>(std::lround(v * kEscala)); }
+
+bool puntoValido(float x, float y, float z, float e, const float offset[4]) {
+    return brazo::dentroDelEspacio(x + offset[0], y + offset[1], z + offset[2], e + offset[3]);
+}
+}
+
+namespace fotogramas {
+
+std::string Codificador::cabecera() { return std::string(kMagia, sizeof(kMagia)); }
+
+void Codificador::continuar(const Fotograma& ultimo) {
+    primero = false;
+    ms = ultimo.ms;
+    q[0] = cuantizar(ultimo.x);
+    q[1] = cuantizar(ultimo.y);
+    q[2] = cuantizar(ultimo.z);
+    q[3] = cuantizar(ultimo.e);
+    feed = static_cast<int32_t>(std::lround(std::max(0.0f, ultimo.feed)));
+    garra = ultimo.garra;
+}
+
+bool Codificador::codificar(const Fotograma& f, std::string& out) {
+    const int32_t nq[4] = {cuantizar(f.x), cuantizar(f.y), cuantizar(f.z), cuantizar(f.e)};
+    const int32_t nfeed = static_cast<int32_t>(std::lround(std::max(0.0f, f.feed)));
+    uint8_t flags = f.garra ? kFlagGarra : 0;
+    if (nfeed != feed) flags |= kFlagFeed;
+    if (!primero && std::memcmp(q, nq, sizeof(q)) == 0 && !(flags & kFlagFeed) &&
+        ((flags & kFlagGarra) != 0) == garra) {
+        return false;
+    }
+
+    const int64_t dt = primero ? std::max<int64_t>(0, f.ms) : std::max<int64_t>(0, f.ms - ms);
+    out.push_back(static_cast<char>(flags));
+    escribirVarint(out, static_cast<uint64_t>(dt));
+    for (int i = 0; i < 4; ++i) escribirVarint(out, zigzag(static_cast<int64_t>(nq[i]) - q[i]));
+    if (flags & kFlagFeed) escribirVarint(out, static_cast<uint64_t>(nfeed));
+
+    primero = false;
+    ms += dt;
+    std::memcpy(q, nq, sizeof(q));
+    feed = nfeed;
+    garra = f.garra;
+    return true;
+}
+
+bool leer(const std::string& ruta, std::vector<Fotograma>& out, size_t& bytesDescartados, std::string& error) {
+    out.clear();
+    bytesDescartados = 0;
+    std::ifstream in(ruta, std::ios::binary);
+    if (!in) {
+        error = "No se pudo abrir " + ruta;
+        return false;
+    }
+    const std::string buf((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (buf.size() < sizeof(kMagia) || std::memcmp(buf.data(), kMagia, sizeof(kMagia)) != 0) {
+        error = "No es una grabación .teach válida";
+        return false;
+    }
+
+    size_t pos = sizeof(kMagia);
+    int64_t ms = 0, q[4] = {};
+    uint64_t feed = 0;
+    while (pos < buf.size()) {
+        const size_t inicio = pos;
+        const uint8_t flags = static_cast<uint8_t>(buf[pos++]);
+        uint64_t dt = 0, d[4] = {}, nfeed = feed;
+        bool ok = (flags & ~(kFlagGarra | kFlagFeed)) == 0 && leerVarint(buf, pos, dt);
+        for (int i = 0; ok && i < 4; ++i) ok = leerVarint(buf, pos, d[i]);
+        if (ok && (flags & kFlagFeed)) ok = leerVarint(buf, pos, nfeed);
+        if (!ok) {
+            bytesDescartados = buf.size() - inicio;
+            break;
+        }
+        ms += static_cast<int64_t>(dt);
+        for (int i = 0; i < 4; ++i) q[i] += desZigzag(d[i]);
+        feed = nfeed;
+
+        Fotograma f;
+        f.ms = ms;
+        f.x = static_cast<float>(q[0]) / kEscala;
+        f.y = static_cast<float>(q[1]) / kEscala;
+        f.z = static_cast<float>(q[2]) / kEscala;
+        f.e = static_cast<float>(q[3]) / kEscala;
+        f.feed = static_cast<float>(feed);
+        f.garra = flags & kFlagGarra;
+        out.push_back(f);
+    }
+    return true;
+}
+
+PlanReproduccion planificar(const std::vector<Fotograma>& fotogramas, const OpcionesReproduccion& opciones) {
+    PlanReproduccion plan;
+    plan.fotogramas = fotogramas.size();
+    if (fotogramas.empty()) return plan;
+    const double velocidad = opciones.velocidad > 0.0 ? opciones.velocidad : 1.0;
+    const int64_t origen = fotogramas.front().ms;
+    auto escalar = [&](int64_t ms) { return static_cast<int64_t>(std::llround((ms - origen) / velocidad)); };
+
+    auto marcarFuera = [&](const Fotograma& f) {
+        ++plan.fueraDeEspacio;
+        if (!plan.tieneFuera) {
+            plan.tieneFuera = true;
+            plan.primerFuera = f;
+        }
+    };
+
+    // El primer fotograma es el punto de partida: se va a velocidad de grabación
+    const Fotograma& primero = fotogramas.front();
+    PasoReproduccion inicio;
+    inicio.x = primero.x;
+    inicio.y = primero.y;
+    inicio.z = primero.z;
+    inicio.e = primero.e;
+    inicio.feed = std::clamp(primero.feed > 0 ? primero.feed : opciones.feedMaximo,
+                             opciones.feedMinimo, opciones.feedMaximo);
+    if (!puntoValido(primero.x, primero.y, primero.z, primero.e, opciones.offset)) marcarFuera(primero);
+    plan.pasos.push_back(inicio);
+    // La garra se fija siempre: no se sabe cómo la dejó lo anterior
+    bool garra = primero.garra;
+    PasoReproduccion g;
+    g.tipo = garra ? PasoReproduccion::GARRA_ON : PasoReproduccion::GARRA_OFF;
+    plan.pasos.push_back(g);
+
+    const Fotograma* previo = &primero;
+    int64_t msPrevio = 0;
+    for (size_t i = 1; i < fotogramas.size(); ++i) {
+        const Fotograma& f = fotogramas[i];
+        const bool cambiaGarra = f.garra != garra;
+        const bool ultimo = i + 1 == fotogramas.size();
+        const int64_t ms = escalar(f.ms);
+        if (!cambiaGarra && !ultimo && ms - msPrevio < opciones.pasoMinimoMs) {
+            ++plan.omitidos;
+            continue;
+        }
+
+        // Tramo recto previo -> f: se valida también por dentro
+        const double dx = f.x - previo->x, dy = f.y - previo->y, dz = f.z - previo->z, de = f.e - previo->e;
+        const double distancia = std::sqrt(dx * dx + dy * dy + dz * dz + de * de);
+        if (distancia > 1e-3) {
+            const int muestras = std::max(1, static_cast<int>(std::ceil(distancia / opciones.muestreoEspacioMm)));
+            for (int k = 1; k <= muestras; ++k) {
+                const double t = static_cast<double>(k) / muestras;
+                Fotograma p = f;
+                p.x = static_cast<float>(previo->x + dx * t);
+                p.y = static_cast<float>(previo->y + dy * t);
+                p.z = static_cast<float>(previo->z + dz * t);
+                p.e = static_cast<float>(previo->e + de * t);
+                if (!puntoValido(p.x, p.y, p.z, p.e, opciones.offset)) {
+                    marcarFuera(p);
+                    break;
+                }
+            }
+
+            PasoReproduccion paso;
+            paso.ms = ms;
+            paso.x = f.x;
+            paso.y = f.y;
+            paso.z = f.z;
+            paso.e = f.e;
+            // Avance grabado escalado; si no se grabó, el que cubre el tramo en el tiempo escalado
+            double feed = f.feed * velocidad;
+            if (f.feed <= 0) {
+                const double segundos = (ms - msPrevio) / 1000.0;
+                feed = segundos > 0 ? distancia / segundos : opciones.feedMaximo;   // mm/s
+            }
+            if (feed > opciones.feedMaximo) {
+                feed = opciones.feedMaximo;
+                ++plan.feedLimitado;
+            }
+            paso.feed = static_cast<float>(std::max<double>(feed, opciones.feedMinimo));
+            plan.pasos.push_back(paso);
+        }
+        if (cambiaGarra) {
+            PasoReproduccion g;
+            g.tipo = f.garra ? PasoReproduccion::GARRA_ON : PasoReproduccion::GARRA_OFF;
+            g.ms = ms;
+            plan.pasos.push_back(g);
+            garra = f.garra;
+        }
+        previo = &f;
+        msPrevio = ms;
+    }
+    plan.duracionMs = msPrevio;
+    return plan;
+}
+
+std::string rutaGrabacion(const std::string& rutaGcode) {
+    return std::filesystem::path(rutaGcode).replace_extension(".teach").string();
+}
+
+} // namespace fotogramas
@@ -0,0 +1,313 @@
+#include "hash_clave.h"
+
+#include <cstring>
+#include <random>
+
+#include <sys/random.h>
+
+namespace hash_clave {
+
+namespace {
+constexpr uint32_t kK[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+constexpr uint32_t kInicial[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                  0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+inline uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+// Comprime un bloque de 16 palabras big-endian ya decodificadas
+void comprimir(uint32_t h[8], const uint32_t bloque[16]) {
+    uint32_t w[64];
+    std::memcpy(w, bloque, sizeof(uint32_t) * 16);
+    for (int i = 16; i < 64; ++i) {
+        const uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        const uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+    for (int i = 0; i < 64; ++i) {
+        const uint32_t t1 = k + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + kK[i] + w[i];
+        const uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        k = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+}
+
+void comprimirBytes(uint32_t h[8], const uint8_t* p) {
+    uint32_t bloque[16];
+    for (int i = 0; i < 16; ++i) {
+        bloque[i] = (uint32_t(p[4 * i]) << 24) | (uint32_t(p[4 * i + 1]) << 16) | (uint32_t(p[4 * i + 2]) << 8) | p[4 * i + 3];
+    }
+    comprimir(h, bloque);
+}
+
+// SHA-256 incremental, sólo lo que necesita HMAC
+struct Sha256 {
+    uint32_t h[8];
+    uint8_t pendiente[64];
+    size_t usados = 0;
+    uint64_t total = 0;
+
+    Sha256() { std::memcpy(h, kInicial, sizeof(h)); }
+
+    void agregar(const uint8_t* p, size_t n) {
+        total += n;
+        if (usados) {
+            const size_t tomar = std::min(n, 64 - usados);
+            std::memcpy(pendiente + usados, p, tomar);
+            usados += tomar;
+            p += tomar;
+            n -= tomar;
+            if (usados < 64) return;
+            comprimirBytes(h, pendiente);
+            usados = 0;
+        }
+        for (; n >= 64; p += 64, n -= 64) comprimirBytes(h, p);
+        std::memcpy(pendiente, p, n);
+        usados = n;
+    }
+
+    void terminar(uint8_t salida[32]) {
+        const uint64_t bits = total * 8;
+        const uint8_t uno = 0x80, cero = 0;
+        agregar(&uno, 1);
+        while (usados != 56) agregar(&cero, 1);
+        uint8_t largo[8];
+        for (int i = 0; i < 8; ++i) largo[i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+        agregar(largo, 8);
+        for (int i = 0; i < 8; ++i) {
+            salida[4 * i] = static_cast<uint8_t>(h[i] >> 24);
+            salida[4 * i + 1] = static_cast<uint8_t>(h[i] >> 16);
+            salida[4 * i + 2] = static_cast<uint8_t>(h[i] >> 8);
+            salida[4 * i + 3] = static_cast<uint8_t>(h[i]);
+        }
+    }
+};
+
+const uint8_t* bytes(std::string_view s) { return reinterpret_cast<const uint8_t*>(s.data()); }
+
+void aleatorio(uint8_t* p, size_t n) {
+    size_t hecho = 0;
+    while (hecho < n) {
+        const ssize_t r = ::getrandom(p + hecho, n - hecho, 0);
+        if (r <= 0) break;
+        hecho += static_cast<size_t>(r);
+    }
+    if (hecho < n) {
+        std::random_device rd;
+        for (; hecho < n; ++hecho) p[hecho] = static_cast<uint8_t>(rd());
+    }
+}
+
+std::string aHex(const uint8_t* p, size_t n) {
+    static const char kHex[] = "0123456789abcdef";
+    std::string s(2 * n, '0');
+    for (size_t i = 0; i < n; ++i) {
+        s[2 * i] = kHex[p[i] >> 4];
+        s[2 * i + 1] = kHex[p[i] & 0x0F];
+    }
+    return s;
+}
+
+bool desdeHex(std::string_view hex, std::string& salida) {
+    if (hex.size() % 2) return false;
+    auto valor = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+    salida.resize(hex.size() / 2);
+    for (size_t i = 0; i < salida.size(); ++i) {
+        const int alto = valor(hex[2 * i]), bajo = valor(hex[2 * i + 1]);
+        if (alto < 0 || bajo < 0) return false;
+        salida[i] = static_cast<char>((alto << 4) | bajo);
+    }
+    return true;
+}
+
+struct Partes {
+    uint32_t iteraciones = 0;
+    std::string sal, derivada;
+};
+
+bool separar(std::string_view almacenado, Partes& p) {
+    if (almacenado.substr(0, kPrefijo.size()) != kPrefijo || almacenado.size() <= kPrefijo.size() ||
+        almacenado[kPrefijo.size()] != '$') {
+        return false;
+    }
+    std::string_view resto = almacenado.substr(kPrefijo.size() + 1);
+    const size_t a = resto.find('$');
+    if (a == std::string_view::npos || a == 0 || a > 9) return false;
+    const size_t b = resto.find('$', a + 1);
+    if (b == std::string_view::npos) return false;
+    uint64_t n = 0;
+    for (char c : resto.substr(0, a)) {
+        if (c < '0' || c > '9') return false;
+        n = n * 10 + static_cast<uint64_t>(c - '0');
+    }
+    if (n < 1 || n > kIteracionesMax) return false;
+    p.iteraciones = static_cast<uint32_t>(n);
+    return desdeHex(resto.substr(a + 1, b - a - 1), p.sal) && desdeHex(resto.substr(b + 1), p.derivada) &&
+           !p.derivada.empty();
+}
+}
+
+std::array<uint8_t, 32> sha256(std::string_view datos) {
+    Sha256 s;
+    s.agregar(bytes(datos), datos.size());
+    std::array<uint8_t, 32> out;
+    s.terminar(out.data());
+    return out;
+}
+
+void pbkdf2Sha256(std::string_view clave, std::string_view sal, uint32_t iteraciones, uint8_t* salida, size_t largo) {
+    // Clave de HMAC: la contraseña, o su hash si supera un bloque
+    uint8_t k[64] = {0};
+    if (clave.size() > 64) {
+        const auto h = sha256(clave);
+        std::memcpy(k, h.data(), h.size());
+    } else {
+        std::memcpy(k, clave.data(), clave.size());
+    }
+    uint8_t ipad[64], opad[64];
+    for (int i = 0; i < 64; ++i) {
+        ipad[i] = k[i] ^ 0x36;
+        opad[i] = k[i] ^ 0x5c;
+    }
+    Sha256 interno, externo;
+    interno.agregar(ipad, 64);
+    externo.agregar(opad, 64);
+
+    // Bloque de relleno fijo para un mensaje de 64 + 32 bytes: cada
+    // iteración comprime U (32 bytes) una vez con cada estado
+    uint32_t relleno[16] = {0};
+    relleno[8] = 0x80000000u;
+    relleno[15] = (64 + 32) * 8;
+
+    for (uint32_t bloque = 1; largo > 0; ++bloque) {
+        // U1 = HMAC(clave, sal || INT(bloque))
+        Sha256 s = interno;
+        s.agregar(bytes(sal), sal.size());
+        const uint8_t indice[4] = {uint8_t(bloque >> 24), uint8_t(bloque >> 16), uint8_t(bloque >> 8), uint8_t(bloque)};
+        s.agregar(indice, 4);
+        uint8_t u[32];
+        s.terminar(u);
+        Sha256 e = externo;
+        e.agregar(u, 32);
+        e.terminar(u);
+
+        uint32_t t[8];
+        for (int i = 0; i < 8; ++i) {
+            relleno[i] = (uint32_t(u[4 * i]) << 24) | (uint32_t(u[4 * i + 1]) << 16) | (uint32_t(u[4 * i + 2]) << 8) | u[4 * i + 3];
+            t[i] = relleno[i];
+        }
+        for (uint32_t it = 1; it < iteraciones; ++it) {
+            uint32_t h[8];
+            std::memcpy(h, interno.h, sizeof(h));
+            comprimir(h, relleno);
+            std::memcpy(relleno, h, sizeof(h));
+            std::memcpy(h, externo.h, sizeof(h));
+            comprimir(h, relleno);
+            std::memcpy(relleno, h, sizeof(h));
+            for (int i = 0; i < 8; ++i) t[i] ^= h[i];
+        }
+
+        const size_t n = std::min<size_t>(largo, 32);
+        for (size_t i = 0; i < n; ++i) salida[i] = static_cast<uint8_t>(t[i / 4] >> (24 - 8 * (i % 4)));
+        salida += n;
+        largo -= n;
+    }
+}
+
+std::string derivar(std::string_view clave, uint32_t iteraciones) {
+    if (iteraciones < kIteracionesMin) iteraciones = kIteracionesMin;
+    if (iteraciones > kIteracionesMax) iteraciones = kIteracionesMax;
+    uint8_t sal[kBytesSal];
+    aleatorio(sal, sizeof(sal));
+    uint8_t dk[kBytesDerivada];
+    pbkdf2Sha256(clave, std::string_view(reinterpret_cast<const char*>(sal), sizeof(sal)), iteraciones, dk, sizeof(dk));
+    return std::string(kPrefijo) + "$" + std::to_string(iteraciones) + "$" + aHex(sal, sizeof(sal)) + "$" +
+           aHex(dk, sizeof(dk));
+}
+
+bool verificar(std::string_view clave, std::string_view almacenado) {
+    Partes p;
+    if (!separar(almacenado, p) || p.derivada.size() > 4 * kBytesDerivada) return false;
+    std::string calculada(p.derivada.size(), '\0');
+    pbkdf2Sha256(clave, p.sal, p.iteraciones, reinterpret_cast<uint8_t*>(calculada.data()), calculada.size());
+    return igualesTiempoConstante(calculada, p.derivada);
+}
+
+uint32_t iteraciones(std::string_view almacenado) {
+    Partes p;
+    return separar(almacenado, p) ? p.iteraciones : 0;
+}
+
+bool igualesTiempoConstante(std::string_view a, std::string_view b) {
+    // El largo no es secreto; el contenido sí
+    if (a.size() != b.size()) return false;
+    uint8_t dif = 0;
+    for (size_t i = 0; i < a.size(); ++i) dif |= static_cast<uint8_t>(a[i] ^ b[i]);
+    return dif == 0;
+}
+
+bool autoprueba(std::string* fallo) {
+    struct CasoSha {
+        const char* nombre;
+        std::string mensaje;
+        const char* esperado;
+    };
+    const CasoSha casosSha[] = {
+        {"sha256(\"abc\")", "abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+        {"sha256(\"\")", "", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+        {"sha256(448 bits)", "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+         "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+        {"sha256(10^6 x 'a')", std::string(1000000, 'a'),
+         "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"},
+    };
+    for (const auto& c : casosSha) {
+        const auto h = sha256(c.mensaje);
+        if (aHex(h.data(), h.size()) != c.esperado) {
+            if (fallo) *fallo = c.nombre;
+            return false;
+        }
+    }
+
+    struct CasoPbkdf2 {
+        const char* nombre;
+        const char* clave;
+        const char* sal;
+        uint32_t iteraciones;
+        const char* esperado;   // dkLen = 64: dos bloques de salida
+    };
+    const CasoPbkdf2 casosPbkdf2[] = {
+        {"pbkdf2(\"passwd\", \"salt\", 1)", "passwd", "salt", 1,
+         "55ac046e56e3089fec1691c22544b605f94185216dde0465e68b9d57c20dacbc"
+         "49ca9cccf179b645991664b39d77ef317c71b845b1e30bd509112041d3a19783"},
+        {"pbkdf2(\"Password\", \"NaCl\", 80000)", "Password", "NaCl", 80000,
+         "4ddcd8f60b98be21830cee5ef22701f9641a4418d04c0414aeff08876b34ab56"
+         "a1d425a1225833549adb841b51c9b3176a272bdebba1d078478f62b397f33c8d"},
+    };
+    for (const auto& c : casosPbkdf2) {
+        uint8_t dk[64];
+        pbkdf2Sha256(c.clave, c.sal, c.iteraciones, dk, sizeof(dk));
+        if (aHex(dk, sizeof(dk)) != c.esperado) {
+            if (fallo) *fallo = c.nombre;
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace hash_clave
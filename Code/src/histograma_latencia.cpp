@@ -0,0 +1,60 @@
+#include "histograma_latencia.h"
+
+#include <algorithm>
+#include <cmath>
+
+int HistogramaLatencia::cubeta(uint64_t us) {
+    // Por debajo de kSubcubetas µs, una cubeta por µs
+    if (us < kSubcubetas) return static_cast<int>(us);
+    const int bits = 63 - __builtin_clzll(us);                 // us >= 2^bits
+    const int exponente = bits - 2;                             // 2^3 = kSubcubetas
+    const int sub = static_cast<int>((us >> (bits - 3)) & (kSubcubetas - 1));
+    return std::min(exponente * kSubcubetas + sub, kSubcubetas * kExponentes - 1);
+}
+
+uint64_t HistogramaLatencia::techo(int indice) {
+    if (indice < kSubcubetas) return static_cast<uint64_t>(indice);
+    const int exponente = indice / kSubcubetas;
+    const int sub = indice % kSubcubetas;
+    const int bits = exponente + 2;
+    return ((static_cast<uint64_t>(kSubcubetas + sub + 1)) << (bits - 3)) - 1;
+}
+
+void HistogramaLatencia::registrar(uint64_t us) {
+    cubetas[cubeta(us)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    sumaUs.fetch_add(us, std::memory_order_relaxed);
+    uint64_t previo = maximoUs.load(std::memory_order_relaxed);
+    while (us > previo && !maximoUs.compare_exchange_weak(previo, us, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t HistogramaLatencia::percentil(double p) const {
+    uint64_t n = 0;
+    std::array<uint64_t, kSubcubetas * kExponentes> copia;
+    for (size_t i = 0; i < copia.size(); ++i) {
+        copia[i] = cubetas[i].load(std::memory_order_relaxed);
+        n += copia[i];
+    }
+    if (n == 0) return 0;
+    const uint64_t objetivo = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(n * p / 100.0)));
+    uint64_t acumulado = 0;
+    for (size_t i = 0; i < copia.size(); ++i) {
+        acumulado += copia[i];
+        if (acumulado >= objetivo) {
+            return std::min(techo(static_cast<int>(i)), maximoUs.load(std::memory_order_relaxed));
+        }
+    }
+    return maximoUs.load(std::memory_order_relaxed);
+}
+
+ResumenLatencia HistogramaLatencia::resumen() const {
+    ResumenLatencia r;
+    r.muestras = total.load(std::memory_order_relaxed);
+    r.p50Us = percentil(50);
+    r.p90Us = percentil(90);
+    r.p99Us = percentil(99);
+    r.maxUs = maximoUs.load(std::memory_order_relaxed);
+    r.mediaUs = r.muestras ? static_cast<double>(sumaUs.load(std::memory_order_relaxed)) / r.muestras : 0.0;
+    return r;
+}
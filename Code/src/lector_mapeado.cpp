@@ -0,0 +1,78 @@
+#include "lector_mapeado.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+constexpr size_t kVentanaLectura = 4u << 20;   // readahead pedido por delante
+constexpr size_t kBloqueLiberar = 16u << 20;   // páginas consumidas que se sueltan
+
+size_t alinearAPagina(size_t offset) {
+    static const size_t pagina = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return offset - (offset % pagina);
+}
+}
+
+LectorMapeado::LectorMapeado(const std::string& ruta) {
+    fd = open(ruta.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        fd = -1;
+        return;
+    }
+    tam = static_cast<size_t>(st.st_size);
+    if (tam == 0) return; // archivo vacío: abierto pero sin mapeo
+
+    void* p = mmap(nullptr, tam, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+        std::cerr << "❌ mmap falló para " << ruta << ": " << strerror(errno) << std::endl;
+        close(fd);
+        fd = -1;
+        tam = 0;
+        return;
+    }
+    base = static_cast<const char*>(p);
+    madvise(const_cast<char*>(base), tam, MADV_SEQUENTIAL);
+    avisarKernel();
+}
+
+LectorMapeado::~LectorMapeado() {
+    if (base) munmap(const_cast<char*>(base), tam);
+    if (fd >= 0) close(fd);
+}
+
+void LectorMapeado::avisarKernel() {
+    if (!base) return;
+    // Pedir la próxima ventana antes de llegar a ella
+    if (pos + kVentanaLectura / 2 >= prefetchHasta && prefetchHasta < tam) {
+        size_t desde = alinearAPagina(pos);
+        size_t largo = std::min(kVentanaLectura, tam - desde);
+        madvise(const_cast<char*>(base) + desde, largo, MADV_WILLNEED);
+        prefetchHasta = desde + largo;
+    }
+    // Soltar lo ya consumido para que el RSS no crezca con el archivo
+    if (pos - liberadoHasta >= kBloqueLiberar) {
+        size_t hasta = alinearAPagina(pos);
+        madvise(const_cast<char*>(base) + liberadoHasta, hasta - liberadoHasta, MADV_DONTNEED);
+        liberadoHasta = hasta;
+    }
+}
+
+bool LectorMapeado::siguienteLinea(std::string_view& linea) {
+    if (!base || pos >= tam) return false;
+    const char* inicio = base + pos;
+    const void* nl = std::memchr(inicio, '\n', tam - pos);
+    size_t largo = nl ? static_cast<size_t>(static_cast<const char*>(nl) - inicio) : tam - pos;
+    pos += largo + (nl ? 1 : 0);
+    if (largo > 0 && inicio[largo - 1] == '\r') --largo;
+    linea = std::string_view(inicio, largo);
+    avisarKernel();
+    return true;
+}
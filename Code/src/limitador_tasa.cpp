@@ -0,0 +1,106 @@
+#include "limitador_tasa.h"
+
+#include <algorithm>
+#include <cmath>
+
+LimitadorTasa limitadorTasa; // definición de la instancia global
+
+namespace {
+size_t indice(ClaseTrafico c) { return static_cast<size_t>(c); }
+}
+
+LimitadorTasa::LimitadorTasa() {
+    // Un panel sondea el estado cada 200-500 ms y al mover manda ráfagas
+    // cortas; una carga de página pide decenas de archivos de una vez
+    presupuestos[indice(ClaseTrafico::MOVIMIENTO)] = {10, 20};
+    presupuestos[indice(ClaseTrafico::ESTADO)] = {20, 40};
+    presupuestos[indice(ClaseTrafico::ESTATICO)] = {50, 150};
+    presupuestos[indice(ClaseTrafico::OTRO)] = {5, 20};
+}
+
+const char* LimitadorTasa::nombreClase(ClaseTrafico clase) {
+    switch (clase) {
+        case ClaseTrafico::MOVIMIENTO: return "movimiento";
+        case ClaseTrafico::ESTADO: return "estado";
+        case ClaseTrafico::ESTATICO: return "estatico";
+        case ClaseTrafico::OTRO: return "otro";
+        default: return "?";
+    }
+}
+
+void LimitadorTasa::fijarPresupuesto(ClaseTrafico clase, PresupuestoTasa p) {
+    std::lock_guard<std::mutex> l(mtx);
+    presupuestos[indice(clase)] = p;
+}
+
+PresupuestoTasa LimitadorTasa::presupuesto(ClaseTrafico clase) const {
+    std::lock_guard<std::mutex> l(mtx);
+    return presupuestos[indice(clase)];
+}
+
+LimitadorTasa::Cubeta& LimitadorTasa::cubeta(ClaseTrafico clase, char tipo, const std::string& id, int64_t ahoraMs) {
+    std::string clave;
+    clave.reserve(id.size() + 2);
+    clave.push_back(static_cast<char>('0' + indice(clase)));
+    clave.push_back(tipo);
+    clave += id;
+    const PresupuestoTasa& p = presupuestos[indice(clase)];
+    auto [it, nueva] = cubetas.try_emplace(std::move(clave));
+    Cubeta& c = it->second;
+    if (nueva) {
+        c.fichas = p.rafaga;
+    } else if (ahoraMs > c.ultimoMs) {
+        c.fichas = std::min(p.rafaga, c.fichas + (ahoraMs - c.ultimoMs) * p.porSegundo / 1000.0);
+    }
+    c.ultimoMs = std::max(c.ultimoMs, ahoraMs);
+    return c;
+}
+
+ResultadoAdmision LimitadorTasa::admitir(ClaseTrafico clase, const std::string& ip, const std::string& usuario,
+                                         int64_t ahoraMs) {
+    std::lock_guard<std::mutex> l(mtx);
+    if (ahoraMs - ultimaPurgaMs >= kPurgaMs) purgar(ahoraMs);
+
+    const PresupuestoTasa& p = presupuestos[indice(clase)];
+    Cubeta& porIp = cubeta(clase, 'i', ip, ahoraMs);
+    Cubeta* porUsuario = usuario.empty() ? nullptr : &cubeta(clase, 'u', usuario, ahoraMs);
+
+    // Se mira la más vacía antes de consumir: no se gasta la ficha de una
+    // si la otra rechaza
+    const double minimo = porUsuario ? std::min(porIp.fichas, porUsuario->fichas) : porIp.fichas;
+    ResultadoAdmision r;
+    if (minimo < 1.0) {
+        r.admitida = false;
+        r.reintentarMs = p.porSegundo > 0 ? static_cast<int64_t>(std::ceil((1.0 - minimo) * 1000.0 / p.porSegundo)) : 60000;
+        ++rechazadas[indice(clase)];
+        if (porIp.fichas < 1.0) ++rechazadasPorIp;
+        else ++rechazadasPorUsuario;
+        return r;
+    }
+    porIp.fichas -= 1.0;
+    if (porUsuario) porUsuario->fichas -= 1.0;
+    ++admitidas[indice(clase)];
+    return r;
+}
+
+void LimitadorTasa::purgar(int64_t ahoraMs) {
+    ultimaPurgaMs = ahoraMs;
+    for (auto it = cubetas.begin(); it != cubetas.end();) {
+        const PresupuestoTasa& p = presupuestos[static_cast<size_t>(it->first[0] - '0')];
+        const double fichas = it->second.fichas + (ahoraMs - it->second.ultimoMs) * p.porSegundo / 1000.0;
+        if (fichas >= p.rafaga) it = cubetas.erase(it);
+        else ++it;
+    }
+}
+
+EstadisticasLimitador LimitadorTasa::estadisticas() const {
+    EstadisticasLimitador e;
+    std::lock_guard<std::mutex> l(mtx);
+    e.admitidas = admitidas;
+    e.rechazadas = rechazadas;
+    e.rechazadasPorIp = rechazadasPorIp;
+    e.rechazadasPorUsuario = rechazadasPorUsuario;
+    e.exentas = exentas.load(std::memory_order_relaxed);
+    e.cubetas = cubetas.size();
+    return e;
+}
@@ -1,105 +1,297 @@
 #include "../inc/logger.h"
-#include <fstream>
+#include "../inc/archivo_io.h"
 #include <filesystem>
-#include <mutex>
 #include <chrono>
-#include <iomanip>
-#include <sstream>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 Logger logger; // definición de la instancia global
 
 namespace fs = std::filesystem;
-static std::mutex log_mtx;
 
-static std::string nowIso() {
+namespace {
+int64_t ahoraMs() {
     using namespace std::chrono;
-    auto now = system_clock::now();
-    auto t = system_clock::to_time_t(now);
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+// <base>-AAAAMMDD-HHMMSS[-n].blog, sin pisar uno existente (ni su .gz)
+std::string nombreArchivado(const std::string& base, int64_t ms) {
+    const time_t t = static_cast<time_t>(ms / 1000);
     std::tm tm;
     localtime_r(&t, &tm);
-    std::ostringstream ss;
-    ss << std::put_time(&tm, "%Y-%m-%dT%H:%M:%S");
-    return ss.str();
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "-%Y%m%d-%H%M%S", &tm);
+    std::string nombre = base + buf + ".blog";
+    std::error_code ec;
+    for (int n = 1; fs::exists(nombre, ec) || fs::exists(nombre + ".gz", ec); ++n) {
+        nombre = base + buf + "-" + std::to_string(n) + ".blog";
+    }
+    return nombre;
 }
-
-Logger::Logger(const std::string& path) : filepath(path) {
-    ensureLogFile();
 }
 
-Logger::~Logger() {}
-
-void Logger::ensureLogFile() {
-    std::lock_guard<std::mutex> l(log_mtx);
-    fs::path p = filepath;
+Logger::Logger(const std::string& ruta) : base(ruta) {
+    fs::path p = base;
+    std::error_code ec;
     if (!p.has_parent_path()) {
         // ensure logs/ exists
-        fs::create_directories("logs");
         p = fs::path("logs") / p;
-        filepath = p.string();
-    } else {
-        fs::create_directories(p.parent_path());
+        base = p.string();
+    }
+    fs::create_directories(p.parent_path(), ec);
+
+    // Segmentos archivados que quedaron sin comprimir por un cierre a mitad de camino
+    for (const auto& e : fs::directory_iterator(p.parent_path(), ec)) {
+        const std::string nombre = e.path().string();
+        if (nombre.rfind(base + "-", 0) == 0 && e.path().extension() == ".blog") porComprimir.push_back(nombre);
+    }
+    // El activo de la ejecución anterior también se archiva: la tabla de
+    // cadenas de ese segmento sólo la conocía aquel proceso
+    archivarActivo();
+    abrirSegmento(ahoraMs());
+    escritor = std::thread(&Logger::bucleEscritor, this);
+    compresor = std::thread(&Logger::bucleCompresor, this);
+}
+
+Logger::~Logger() {
+    {
+        std::lock_guard<std::mutex> l(mtxEscritor);
+        parar = true;
+    }
+    cvEscritor.notify_one();
+    if (escritor.joinable()) escritor.join();   // vacía la cola antes de salir
+    if (fd >= 0) ::close(fd);
+    {
+        std::lock_guard<std::mutex> l(mtxCompresor);
+        pararCompresor = true;
+    }
+    cvCompresor.notify_one();
+    if (compresor.joinable()) compresor.join();
+    if (const uint64_t perdidas = descartadas.load()) {
+        std::cerr << "⚠️ Logger: " << perdidas << " registros descartados (cola llena)" << std::endl;
+    }
+}
+
+bool Logger::abrirSegmento(int64_t ms) {
+    const std::string ruta = rutaActiva();
+    fd = ::open(ruta.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "❌ No se pudo abrir el log " << ruta << std::endl;
+        return false;
+    }
+    inicioSegmentoMs = ms;
+    codificador = registro_log::Codificador(ms);
+    const std::string cabecera = registro_log::cabecera(ms);
+    escribirTodo(fd, cabecera);
+    bytesSegmento = cabecera.size();
+    return true;
+}
+
+void Logger::archivarActivo() {
+    const std::string activo = rutaActiva();
+    std::ifstream in(activo, std::ios::binary);
+    if (!in) return;
+    const std::string datos((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    int64_t msBase = 0;
+    size_t registros = 0;
+    const bool valido = registro_log::recorrer(datos, [&](const RegistroLog&) { ++registros; return true; }, &msBase);
+    if (!valido || registros == 0) {
+        ::unlink(activo.c_str());
+        return;
+    }
+    const std::string destino = nombreArchivado(base, msBase);
+    if (::rename(activo.c_str(), destino.c_str()) == 0) {
+        std::lock_guard<std::mutex> l(mtxCompresor);
+        porComprimir.push_back(destino);
+    }
+}
+
+void Logger::rotar() {
+    if (fd >= 0) {
+        ::fdatasync(fd);
+        ::close(fd);
+        fd = -1;
+    }
+    const std::string destino = nombreArchivado(base, inicioSegmentoMs);
+    if (::rename(rutaActiva().c_str(), destino.c_str()) == 0) {
+        {
+            std::lock_guard<std::mutex> l(mtxCompresor);
+            porComprimir.push_back(destino);
+        }
+        cvCompresor.notify_one();
     }
+    rotaciones.fetch_add(1, std::memory_order_relaxed);
+    abrirSegmento(ahoraMs());
+}
+
+void Logger::despertar() {
+    cvEscritor.notify_one();
+}
 
-    bool writeHeader = !fs::exists(filepath) || fs::file_size(filepath) == 0;
-    if (writeHeader) {
-        std::ofstream f(filepath, std::ios::app);
-        if (f) {
-            // Cabecera: timestamp,category,detail,user,node,response_code,module,message
-            f << "timestamp,category,detail,user,node,response_code,module,message\n";
+void Logger::encolar(RegistroLog&& r, size_t largoAprox) {
+    const int64_t largo = static_cast<int64_t>(largoAprox);
+    if (!cola.intentarEncolar(r)) {
+        // Contrapresión: se le da al escritor la oportunidad de vaciar
+        esperas.fetch_add(1, std::memory_order_relaxed);
+        despertar();
+        const auto limite = std::chrono::steady_clock::now() + std::chrono::microseconds(kEsperaMaxUs);
+        bool ok = false;
+        while (!ok && std::chrono::steady_clock::now() < limite) {
+            std::this_thread::yield();
+            ok = cola.intentarEncolar(r);
+        }
+        if (!ok) {
+            descartadas.fetch_add(1, std::memory_order_relaxed);
+            return;
         }
     }
+    encoladas.fetch_add(1, std::memory_order_relaxed);
+    // Sólo se despierta al escritor al cruzar el umbral del lote; el resto
+    // lo recoge el temporizador
+    const int64_t lote = static_cast<int64_t>(kLoteBytes);
+    const int64_t antes = bytesPendientes.fetch_add(largo, std::memory_order_relaxed);
+    if (antes < lote && antes + largo >= lote) despertar();
 }
 
 void Logger::logRequest(const std::string& detail, const std::string& user,
                         const std::string& node, int response_code) {
-    std::lock_guard<std::mutex> l(log_mtx);
-    std::ofstream out(filepath, std::ios::app);
-    if (!out) return;
-    std::string ts = nowIso();
-    // escape double quotes by doubling them
-    auto esc = [](const std::string& s){
-        std::string out; out.reserve(s.size()+4);
-        for (char c: s) {
-            if (c == '"') { out += '"'; out += '"'; }
-            else out += c;
+    RegistroLog r;
+    r.categoria = RegistroLog::PETICION;
+    r.ms = ahoraMs();
+    r.detalle = detail;
+    r.usuario = user;
+    r.nodo = node;
+    r.codigo = response_code;
+    encolar(std::move(r), 8);   // detalle, usuario y nodo casi siempre van por id
+}
+
+void Logger::logEvent(const std::string& module, const std::string& message, const std::string& user) {
+    RegistroLog r;
+    r.categoria = RegistroLog::EVENTO;
+    r.ms = ahoraMs();
+    r.modulo = module;
+    r.mensaje = message;
+    r.usuario = user;
+    encolar(std::move(r), 8 + message.size());
+}
+
+void Logger::flush() {
+    std::unique_lock<std::mutex> l(mtxEscritor);
+    if (!escritor.joinable()) return;
+    const uint64_t objetivo = ++pedidosFlush;
+    cvEscritor.notify_one();
+    cvVaciado.wait(l, [&] { return flushHechos >= objetivo || parar; });
+}
+
+EstadisticasLogger Logger::estadisticas() const {
+    EstadisticasLogger e;
+    e.encoladas = encoladas.load(std::memory_order_relaxed);
+    e.escritas = escritas.load(std::memory_order_relaxed);
+    e.descartadas = descartadas.load(std::memory_order_relaxed);
+    e.esperas = esperas.load(std::memory_order_relaxed);
+    e.lotes = lotes.load(std::memory_order_relaxed);
+    e.bytes = bytes.load(std::memory_order_relaxed);
+    e.rotaciones = rotaciones.load(std::memory_order_relaxed);
+    e.comprimidos = comprimidos.load(std::memory_order_relaxed);
+    return e;
+}
+
+void Logger::bucleEscritor() {
+    std::string lote;
+    lote.reserve(2 * kLoteBytes);
+    RegistroLog r;
+    for (;;) {
+        bool salir;
+        uint64_t flushPedido;
+        {
+            std::unique_lock<std::mutex> l(mtxEscritor);
+            cvEscritor.wait_for(l, std::chrono::milliseconds(kPeriodoFlushMs), [&] {
+                return parar || pedidosFlush != flushHechos ||
+                       bytesPendientes.load(std::memory_order_relaxed) >= static_cast<int64_t>(kLoteBytes);
+            });
+            salir = parar;
+            flushPedido = pedidosFlush;
+        }
+
+        uint64_t filas = 0;
+        int64_t pendientes = 0;
+        registro_log::Codificador::Marca marca;
+        auto volcar = [&] {
+            if (!lote.empty() && fd >= 0) {
+                if (escribirTodo(fd, lote)) {
+                    lotes.fetch_add(1, std::memory_order_relaxed);
+                    bytes.fetch_add(lote.size(), std::memory_order_relaxed);
+                    escritas.fetch_add(filas, std::memory_order_relaxed);
+                    bytesSegmento += lote.size();
+                } else {
+                    // Las altas de cadenas del lote no llegaron: si el
+                    // codificador las diera por conocidas, los registros
+                    // siguientes apuntarían a ids que no están en el
+                    // segmento. Se olvidan y se corta lo escrito a medias;
+                    // si ni eso se puede, segmento nuevo.
+                    codificador.deshacer(marca);
+                    if (::ftruncate(fd, static_cast<off_t>(bytesSegmento)) != 0 ||
+                        ::lseek(fd, static_cast<off_t>(bytesSegmento), SEEK_SET) < 0) {
+                        rotar();
+                    }
+                }
+            }
+            bytesPendientes.fetch_sub(pendientes, std::memory_order_relaxed);
+            lote.clear();
+            filas = 0;
+            pendientes = 0;
+        };
+        const int64_t ahora = ahoraMs();
+        bool primero = true;
+        while (cola.desencolar(r)) {
+            // La rotación sólo se decide con algo para escribir: no quedan segmentos vacíos
+            if (primero && bytesSegmento > registro_log::cabecera(inicioSegmentoMs).size() &&
+                ahora - inicioSegmentoMs >= kMaxSegmentoS * 1000) {
+                rotar();
+            }
+            primero = false;
+            if (lote.empty()) marca = codificador.marca();
+            codificador.codificar(r, lote);
+            ++filas;
+            pendientes += r.categoria == RegistroLog::EVENTO ? 8 + static_cast<int64_t>(r.mensaje.size()) : 8;
+            if (lote.size() >= kLoteBytes || bytesSegmento + lote.size() >= kMaxSegmentoBytes) {
+                volcar();
+                if (bytesSegmento >= kMaxSegmentoBytes) rotar();
+            }
+        }
+        volcar();
+
+        {
+            std::lock_guard<std::mutex> l(mtxEscritor);
+            flushHechos = flushPedido;
+        }
+        cvVaciado.notify_all();
+        if (salir) return;
+    }
+}
+
+void Logger::bucleCompresor() {
+    for (;;) {
+        std::string ruta;
+        {
+            std::unique_lock<std::mutex> l(mtxCompresor);
+            cvCompresor.wait(l, [&] { return pararCompresor || !porComprimir.empty(); });
+            // Al cerrar se deja lo pendiente para el próximo arranque
+            if (pararCompresor) return;
+            ruta = std::move(porComprimir.front());
+            porComprimir.pop_front();
         }
-        return out;
-    };
-    std::string d = esc(detail);
-    std::string u = esc(user);
-    std::string n = esc(node);
-
-    out << '"' << ts << '"' << ','
-        << '"' << "request" << '"' << ','
-        << '"' << d << '"' << ','
-        << '"' << u << '"' << ','
-        << '"' << n << '"' << ','
-        << response_code << ','
-        << ',' // module empty
-        << ',' << '\n';
-}
-
-void Logger::logEvent(const std::string& module, const std::string& message) {
-    std::lock_guard<std::mutex> l(log_mtx);
-    std::ofstream f(filepath, std::ios::app);
-    if (!f) return;
-    std::string ts = nowIso();
-    auto esc = [](const std::string& s){
-        std::string out; out.reserve(s.size()+4);
-        for (char c: s) {
-            if (c=='"') out += '"', out += '"';
-            else out += c;
+        if (registro_log::comprimir(ruta)) {
+            comprimidos.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            std::cerr << "⚠️ No se pudo comprimir " << ruta << std::endl;
         }
-        return out;
-    };
-    std::string m = esc(module);
-    std::string msg = esc(message);
-    f << '"' << ts << '"' << ','
-      << '"' << "event" << '"' << ','
-      << ',' // detail empty
-      << ',' // user empty
-      << ',' // node empty
-      << ',' // response_code empty
-      << '"' << m << '"' << ','
-      << '"' << msg << '"' << '\n';
+    }
 }
@@ -1,148 +1,267 @@
 #include "login.h"
 #include "logger.h"
+#include "consola.h"
+#include "diario_estado.h"
+#include "hash_clave.h"
 #include <sqlite3.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
 #include <string>
-// storage for tokens
-struct TokenInfo {
-    std::string username;
-    std::string privilege;
-};
-static std::unordered_map<std::string, TokenInfo> tokens;
-static std::mutex token_mtx;
-
-Login::Login() {
-    std::cout << "🔌 Conectando a base de datos SQLite..." << std::endl;
-    if (sqlite3_open("users.sqlite3", &db) != SQLITE_OK) {
-        std::cerr << "❌ Error abriendo base SQLite: " << sqlite3_errmsg(db) << std::endl;
-        db = nullptr;
+#include <thread>
+
+namespace {
+// LOGIN_ITERACIONES permite ajustar el costo sin recompilar
+uint32_t iteracionesIniciales() {
+    uint32_t n = hash_clave::kIteracionesPorDefecto;
+    if (const char* env = std::getenv("LOGIN_ITERACIONES")) {
+        const unsigned long v = std::strtoul(env, nullptr, 10);
+        if (v > 0) n = static_cast<uint32_t>(std::clamp<unsigned long>(v, hash_clave::kIteracionesMin, hash_clave::kIteracionesMax));
+    }
+    return n;
+}
+
+// La mitad de los núcleos, hasta una conexión del pool SQLite por hilo:
+// una tanda de logins no se queda con toda la CPU
+unsigned hilosAutenticacion() {
+    return std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u);
+}
+}
+
+// Las sesiones vencidas tampoco se restauran al arrancar
+Login::Login()
+    : iteraciones(iteracionesIniciales()),
+      sesiones([](const std::string& token) { diarioEstado.bajaSesion(token); }),
+      trabajadores(hilosAutenticacion()) {
+    // Si el SHA-256 propio se rompiera, ningún hash guardado verificaría
+    std::string fallo;
+    if (!hash_clave::autoprueba(&fallo)) {
+        CONSOLA_ERROR("❌ Autoprueba de hash de contraseñas fallida: " << fallo << " no coincide con el vector conocido");
+    }
+
+    CONSOLA_INFO("🔌 Conectando a base de datos SQLite...");
+    if (!pool.abierto()) {
+        CONSOLA_ERROR("❌ Error abriendo base SQLite: " << pool.ultimoError());
+        return;
+    }
+    CONSOLA_INFO("✅ Conectado a SQLite correctamente (WAL, " << pool.tamano() << " conexiones)");
+    auto con = pool.tomar();
+    sqlite3* db = con.db();
+
+    // Crear tabla si no existe
+    const char* create_sql =
+        "CREATE TABLE IF NOT EXISTS users ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+        "username TEXT NOT NULL UNIQUE,"
+        "password_hash TEXT NOT NULL,"
+        "privilege TEXT NOT NULL DEFAULT 'viewer'"
+        ");";
+    char* err = nullptr;
+    int rc = sqlite3_exec(db, create_sql, nullptr, nullptr, &err);
+    if (rc != SQLITE_OK) {
+        CONSOLA_ERROR("❌ Error creando tabla users: " << (err?err:""));
+        sqlite3_free(err);
     } else {
-        std::cout << "✅ Conectado a SQLite correctamente" << std::endl;
-        
-        // Crear tabla si no existe
-        const char* create_sql =
-            "CREATE TABLE IF NOT EXISTS users ("
-            "id INTEGER PRIMARY KEY AUTOINCREMENT,"
-            "username TEXT NOT NULL UNIQUE,"
-            "password_hash TEXT NOT NULL,"
-            "privilege TEXT NOT NULL DEFAULT 'viewer'"
-            ");";
-        char* err = nullptr;
-        int rc = sqlite3_exec(db, create_sql, nullptr, nullptr, &err);
-        if (rc != SQLITE_OK) {
-            std::cerr << "❌ Error creando tabla users: " << (err?err:"") << std::endl;
-            sqlite3_free(err);
-        } else {
-            std::cout << "✅ Tabla 'users' verificada/creada" << std::endl;
-        }
+        CONSOLA_DEBUG("✅ Tabla 'users' verificada/creada");
+    }
 
-        // Insertar usuarios por defecto si la tabla está vacía
-        const char* count_sql = "SELECT COUNT(*) FROM users;";
-        sqlite3_stmt* stmt = nullptr;
-        rc = sqlite3_prepare_v2(db, count_sql, -1, &stmt, nullptr);
-        if (rc == SQLITE_OK) {
-            rc = sqlite3_step(stmt);
-            int count = 0;
-            if (rc == SQLITE_ROW) {
-                count = sqlite3_column_int(stmt, 0);
+    // Insertar usuarios por defecto si la tabla está vacía
+    int count = 0;
+    {
+        auto stmt = con.sentencia("SELECT COUNT(*) FROM users;");
+        if (!stmt) return;
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            count = sqlite3_column_int(stmt, 0);
+        }
+    }
+    if (count == 0) {
+        CONSOLA_INFO("👥 Creando usuarios por defecto...");
+        const std::pair<const char*, const char*> porDefecto[] = {{"ADMIN", "admin"}, {"USER", "user"}, {"VIEWER", "viewer"}};
+        bool creados = true;
+        for (const auto& [nombre, privilegio] : porDefecto) {
+            // Contraseña inicial = nombre de usuario, ya con hash
+            const std::string hash = hash_clave::derivar(nombre, iteracionesActuales());
+            auto stmt = con.sentencia("INSERT INTO users (username, password_hash, privilege) VALUES (?, ?, ?);");
+            if (!stmt) {
+                creados = false;
+                break;
             }
-            sqlite3_finalize(stmt);
-
-            if (count == 0) {
-                std::cout << "👥 Creando usuarios por defecto..." << std::endl;
-                const char* insert_sql =
-                    "INSERT INTO users (username, password_hash, privilege) VALUES"
-                    "('ADMIN','ADMIN','admin'),"
-                    "('USER','USER','user'),"
-                    "('VIEWER','VIEWER','viewer');";
-                rc = sqlite3_exec(db, insert_sql, nullptr, nullptr, &err);
-                if (rc != SQLITE_OK) {
-                    std::cerr << "❌ Error insertando usuarios por defecto: " << (err?err:"") << std::endl;
-                    sqlite3_free(err);
-                } else {
-                    std::cout << "✅ Usuarios por defecto creados (ADMIN/USER/VIEWER)" << std::endl;
-                }
-            } else {
-                std::cout << "📊 Usuarios en BD: " << count << std::endl;
+            sqlite3_bind_text(stmt, 1, nombre, -1, SQLITE_STATIC);
+            sqlite3_bind_text(stmt, 2, hash.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, 3, privilegio, -1, SQLITE_STATIC);
+            if (sqlite3_step(stmt) != SQLITE_DONE) {
+                CONSOLA_ERROR("❌ Error insertando usuarios por defecto: " << sqlite3_errmsg(db));
+                creados = false;
+                break;
             }
         }
+        if (creados) {
+            CONSOLA_INFO("✅ Usuarios por defecto creados (ADMIN/USER/VIEWER)");
+        }
+    } else {
+        CONSOLA_DEBUG("📊 Usuarios en BD: " << count);
     }
 }
 
-Login::~Login() {
-    if (db) {
-        sqlite3_close(db);
-    }
-}
+Login::~Login() = default;
 
 bool Login::isConnected() const { 
-    return db != nullptr; 
+    return pool.abierto(); 
 }
 
 Login::AuthResult Login::authenticate(const std::string& username, const std::string& password) {
     AuthResult result{false, "viewer", "", "Credenciales inválidas"};
-    
-    if (!db) {
+    const auto inicio = std::chrono::steady_clock::now();
+    // La latencia se registra en cualquier salida
+    struct Medicion {
+        HistogramaLatencia& h;
+        std::chrono::steady_clock::time_point t0;
+        ~Medicion() {
+            h.registrar(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - t0).count()));
+        }
+    } medicion{latencias, inicio};
+
+    if (!pool.abierto()) {
         result.message = "Error de conexión a la base de datos";
-        std::cerr << "❌ Intento de login sin conexión a BD" << std::endl;
+        CONSOLA_ERROR("❌ Intento de login sin conexión a BD");
+        errores.fetch_add(1, std::memory_order_relaxed);
         return result;
     }
 
-    std::cout << "🔐 Autenticando usuario: '" << username << "' con password: '" << password << "'" << std::endl;
+    CONSOLA_DEBUG("🔐 Autenticando usuario: '" << username << "'");
 
-    // CONSULTA CORREGIDA - comparación exacta (sin UPPER)
-    const char* sql = "SELECT privilege FROM users WHERE username = ? AND password_hash = ? LIMIT 1;";
-    sqlite3_stmt* stmt = nullptr;
+    bool existe = false;
+    std::string almacenado;
+    {
+        // Conexión y sentencia sólo durante la consulta, no durante el hash
+        auto con = pool.tomar();
+        auto stmt = con.sentencia("SELECT privilege, password_hash FROM users WHERE username = ? LIMIT 1;");
+        if (!stmt) {
+            result.message = sqlite3_errmsg(con.db());
+            CONSOLA_ERROR("❌ Error preparando consulta: " << result.message);
+            errores.fetch_add(1, std::memory_order_relaxed);
+            return result;
+        }
+        sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_TRANSIENT);
 
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-        result.message = sqlite3_errmsg(db);
-        std::cerr << "❌ Error preparando consulta: " << result.message << std::endl;
-        return result;
+        const int rc = sqlite3_step(stmt);
+        CONSOLA_TRAZA("📊 Resultado SQLite: " << rc << " (SQLITE_ROW=" << SQLITE_ROW << ")");
+        if (rc == SQLITE_ROW) {
+            const char* privilege = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+            const char* hash = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+            result.privilege = privilege ? privilege : "viewer";
+            almacenado = hash ? hash : "";
+            existe = true;
+        } else if (rc != SQLITE_DONE) {
+            result.message = sqlite3_errmsg(con.db());
+            CONSOLA_ERROR("❌ Error consultando usuarios: " << result.message);
+            errores.fetch_add(1, std::memory_order_relaxed);
+            return result;
+        }
     }
 
-    // Bind de parámetros - CORREGIDO
-    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, password.c_str(), -1, SQLITE_TRANSIENT);
+    const uint32_t costo = iteracionesActuales();
+    const uint32_t costoGuardado = hash_clave::iteraciones(almacenado);
+    bool valido = false;
+    if (!existe) {
+        // Mismo trabajo que con un usuario real: el tiempo de respuesta no
+        // dice si el usuario existe
+        uint8_t descarte[hash_clave::kBytesDerivada];
+        hash_clave::pbkdf2Sha256(password, "-", costo, descarte, sizeof(descarte));
+    } else if (costoGuardado > 0) {
+        valido = hash_clave::verificar(password, almacenado);
+    } else {
+        // Fila de antes de los hashes: texto plano, se migra abajo
+        valido = hash_clave::igualesTiempoConstante(password, almacenado);
+    }
 
-    int rc = sqlite3_step(stmt);
-    std::cout << "📊 Resultado SQLite: " << rc << " (SQLITE_ROW=" << SQLITE_ROW << ")" << std::endl;
-    
-    if (rc == SQLITE_ROW) {
-        // USUARIO VÁLIDO - existe en la base de datos
-        const char* privilege = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-        result.success = true;
-        result.privilege = privilege ? privilege : "viewer";
-        result.token = generateToken();
-        // Guardar token activo -> usuario
-        {
-            std::lock_guard<std::mutex> l(token_mtx);
-            tokens[result.token] = TokenInfo{username, result.privilege};
+    if (valido && costoGuardado != costo) {
+        const std::string nuevo = hash_clave::derivar(password, costo);
+        auto con = pool.tomar();
+        // Sólo si nadie lo cambió mientras tanto
+        auto stmt = con.sentencia("UPDATE users SET password_hash = ? WHERE username = ? AND password_hash = ?;");
+        if (stmt) {
+            sqlite3_bind_text(stmt, 1, nuevo.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, 2, username.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, 3, almacenado.c_str(), -1, SQLITE_TRANSIENT);
+            if (sqlite3_step(stmt) == SQLITE_DONE && sqlite3_changes(con.db()) > 0) {
+                migrados.fetch_add(1, std::memory_order_relaxed);
+                CONSOLA_DEBUG("🔑 Hash de " << username << " rehecho con " << costo << " iteraciones");
+            }
         }
+    }
+
+    if (valido) {
+        // USUARIO VÁLIDO - existe y la contraseña corresponde
+        result.success = true;
+        result.token = sesiones.crear(username, result.privilege);
+        diarioEstado.altaSesion(result.token, username, result.privilege);
         result.message = "Login exitoso";
-        std::cout << "✅ Login exitoso - Usuario: " << username << ", Privilegio: " << result.privilege << std::endl;
-        logger.logEvent("auth", std::string("Login exitoso usuario:") + username + std::string(" privilegio:") + result.privilege);
+        exitos.fetch_add(1, std::memory_order_relaxed);
+        CONSOLA_INFO("✅ Login exitoso - Usuario: " << username << ", Privilegio: " << result.privilege);
+        logger.logEvent("auth", std::string("Login exitoso usuario:") + username + std::string(" privilegio:") + result.privilege,
+                        username);
     } else {
         // USUARIO INVÁLIDO - no existe o credenciales incorrectas
-        std::cout << "❌ Login fallido - Usuario: " << username << " no encontrado o password incorrecto" << std::endl;
+        CONSOLA_AVISO("❌ Login fallido - Usuario: " << username << " no encontrado o password incorrecto");
         result.success = false;
         result.message = "Usuario o contraseña incorrectos";
-        logger.logEvent("auth", std::string("Login fallido usuario:") + username);
+        fallos.fetch_add(1, std::memory_order_relaxed);
+        logger.logEvent("auth", std::string("Login fallido usuario:") + username, username);
     }
-
-    sqlite3_finalize(stmt);
     return result;
 }
 
-std::string Login::usernameForToken(const std::string& token) {
-    std::lock_guard<std::mutex> l(token_mtx);
-    auto it = tokens.find(token);
-    if (it != tokens.end()) return it->second.username;
-    return std::string();
+bool Login::authenticateAsync(const std::string& username, const std::string& password,
+                              std::function<void(const AuthResult&)> listo) {
+    const bool encolado = trabajadores.intentarEncolar(
+        [this, username, password, listo = std::move(listo)] { listo(authenticate(username, password)); },
+        kMaxPendientes);
+    if (!encolado) {
+        rechazados.fetch_add(1, std::memory_order_relaxed);
+        CONSOLA_AVISO("⏳ Login de " << username << " rechazado: " << kMaxPendientes << " en espera");
+    }
+    return encolado;
+}
+
+void Login::fijarIteraciones(uint32_t n) {
+    iteraciones.store(std::clamp(n, hash_clave::kIteracionesMin, hash_clave::kIteracionesMax), std::memory_order_relaxed);
+}
+
+EstadisticasAuth Login::estadisticas() const {
+    EstadisticasAuth e;
+    e.exitos = exitos.load(std::memory_order_relaxed);
+    e.fallos = fallos.load(std::memory_order_relaxed);
+    e.errores = errores.load(std::memory_order_relaxed);
+    e.rechazados = rechazados.load(std::memory_order_relaxed);
+    e.migrados = migrados.load(std::memory_order_relaxed);
+    e.conexiones = pool.tamano();
+    e.hilos = trabajadores.tamano();
+    e.pendientes = trabajadores.pendientes();
+    e.iteraciones = iteracionesActuales();
+    e.latencia = latencias.resumen();
+    return e;
+}
+
+std::optional<SesionActiva> Login::resolverSesion(const std::string& token) {
+    if (token.empty()) return std::nullopt;
+    return sesiones.resolver(token);
+}
+
+std::optional<SesionActiva> Login::consultarSesion(const std::string& token) const {
+    if (token.empty()) return std::nullopt;
+    return sesiones.consultar(token);
+}
+
+bool Login::cerrarSesion(const std::string& token) {
+    if (!sesiones.cerrar(token)) return false;
+    diarioEstado.bajaSesion(token);
+    return true;
 }
 
-std::string Login::privilegeForToken(const std::string& token) {
-    std::lock_guard<std::mutex> l(token_mtx);
-    auto it = tokens.find(token);
-    if (it != tokens.end()) return it->second.privilege;
-    return std::string();
+void Login::restaurarSesion(const std::string& token, const std::string& username, const std::string& privilege,
+                            int64_t creadaMs) {
+    sesiones.restaurar(token, username, privilege, creadaMs);
 }
@@ -21,15 +21,28 @@
 #include <unistd.h>
 #include <atomic>
 #include <cmath>
+#include <cerrno>
+#include <sys/time.h>
 
 #include "login.h"
 #include "robot_controller_simple.h"
 #include "comunicacion_controlador_simple.h"
 #include "estado_robot.h"
+#include "telemetria.h"
+#include "diario_estado.h"
+#include "catalogo_trabajos.h"
+#include "almacen_blobs.h"
+#include "logger.h"
+#include "consulta_log.h"
+#include "consola.h"
 #include "aprendizaje.h"
 #include "administrador_sistema.h"
 #include "json.hpp"
 #include "server.h"
+#include "conversor_csv.h"
+#include "validador_gcode.h"
+#include "limitador_tasa.h"
+#include "estimador_trabajo.h"
 
 using json = nlohmann::json;
 namespace fs = std::filesystem;
@@ -77,15 +90,6 @@ bool parseOnOffToken(const std::string& token, bool& value) {
     return false;
 }
 
-bool snapshotsEqual(const EstadoRobot::Snapshot& a, const EstadoRobot::Snapshot& b) {
-    auto approx = [](float lhs, float rhs) {
-        return std::fabs(lhs - rhs) < 1e-3f;
-    };
-    return approx(a.x, b.x) && approx(a.y, b.y) && approx(a.z, b.z)
-        && a.motores == b.motores && a.garra == b.garra
-        && a.modoAbs == b.modoAbs && a.emergencia == b.emergencia;
-}
-
 std::string runRpc(CommandContext& ctx, const std::string& method, const json& payload = json::object()) {
     if (!ctx.login || !ctx.robot || !ctx.estado || !ctx.aprendizaje || !ctx.admin) {
         return "RPC no disponible en este contexto";
@@ -125,8 +129,14 @@ std::ostringstream print_help(){
 "┃ 🌐 enableRemote | disableRemote                                          ┃\n"
 "┃    Habilita / deshabilita el control remoto                              ┃\n"
 "┃                                                                          ┃\n"
-"┃ 📤 exportLog [dir]                                                       ┃\n"
-"┃    Copia HTML/static_server.log a un archivo timestamped                 ┃\n"
+"┃ 📤 exportLog [dir] [minutos]                                             ┃\n"
+"┃    Exporta el log a CSV (o sólo los últimos minutos) y static_server.log ┃\n"
+"┃                                                                          ┃\n"
+"┃ 🔈 logLevel [traza|debug|info|aviso|error|nada]                          ┃\n"
+"┃    Muestra o cambia el nivel de los mensajes de consola                  ┃\n"
+"┃                                                                          ┃\n"
+"┃ 🔑 authCost [iteraciones]                                                ┃\n"
+"┃    Muestra o cambia el costo PBKDF2 de las contraseñas                   ┃\n"
 "┃                                                                          ┃\n"
 "┃ 💬 rpc <metodo> [json]                                                   ┃\n"
 "┃    Envía una llamada RPC manual                                          ┃\n"
@@ -187,6 +197,35 @@ std::unordered_map<std::string, CommandFn> buildCommandTable() {
         return "Server state: " + toString(ctx.server.getState());
     };
 
+    cmds["logLevel"] = cmds["loglevel"] = [](const std::string& args, CommandContext&) {
+        const std::string nombre = trimCopy(args);
+        if (!nombre.empty()) {
+            NivelConsola n;
+            if (!consola::nivelDesdeTexto(nombre, n)) {
+                return std::string("Nivel inválido (traza, debug, info, aviso, error o nada)");
+            }
+            consola::fijarNivel(n);
+        }
+        std::string respuesta = std::string("Nivel de consola: ") + consola::nombreNivel(consola::nivel());
+        if (static_cast<int>(consola::nivel()) < CONSOLA_NIVEL_MINIMO) {
+            respuesta += std::string(" (compilado desde ") +
+                         consola::nombreNivel(static_cast<NivelConsola>(CONSOLA_NIVEL_MINIMO)) + ")";
+        }
+        return respuesta;
+    };
+
+    cmds["authCost"] = cmds["authcost"] = [](const std::string& args, CommandContext& ctx) {
+        if (!ctx.login) return std::string("Login no disponible");
+        const std::string valor = trimCopy(args);
+        if (!valor.empty()) {
+            const unsigned long n = std::strtoul(valor.c_str(), nullptr, 10);
+            if (n == 0) return std::string("Iteraciones inválidas");
+            ctx.login->fijarIteraciones(static_cast<uint32_t>(std::min<unsigned long>(n, UINT32_MAX)));
+        }
+        return "Costo PBKDF2: " + std::to_string(ctx.login->iteracionesActuales()) +
+               " iteraciones (los hashes existentes se rehacen en el próximo login)";
+    };
+
     cmds["rpc"] = [](const std::string& args, CommandContext& ctx) {
         if (!ctx.login || !ctx.robot || !ctx.estado || !ctx.aprendizaje || !ctx.admin) {
             return std::string("RPC not available in current context");
@@ -302,24 +341,47 @@ std::unordered_map<std::string, CommandFn> buildCommandTable() {
 
     cmds["exportLog"] = cmds["exportlog"] = [](const std::string& args, CommandContext&) {
         namespace fs = std::filesystem;
-        fs::path source = fs::path("HTML") / "static_server.log";
-        if (!fs::exists(source)) {
-            return std::string("No existe el archivo de log en ") + source.string();
-        }
-        fs::path targetDir = trimCopy(args);
-        if (targetDir.empty()) targetDir = "exported_logs";
+        std::istringstream iss(args);
+        std::string dir, minutos;
+        iss >> dir >> minutos;
+        fs::path targetDir = dir.empty() ? fs::path("exported_logs") : fs::path(dir);
         std::error_code ec;
         fs::create_directories(targetDir, ec);
         auto now = std::chrono::system_clock::now();
         std::time_t t = std::chrono::system_clock::to_time_t(now);
         std::ostringstream filename;
-        filename << "log_" << std::put_time(std::localtime(&t), "%Y%m%d_%H%M%S") << ".log";
-        fs::path dest = fs::path(targetDir) / filename.str();
-        fs::copy_file(source, dest, fs::copy_options::overwrite_existing, ec);
-        if (ec) {
-            return std::string("No se pudo exportar log: ") + ec.message();
+        filename << "log_" << std::put_time(std::localtime(&t), "%Y%m%d_%H%M%S");
+
+        // Log del servidor (segmentos binarios) pasado a CSV, opcionalmente
+        // sólo los últimos N minutos
+        FiltroLog filtro;
+        if (!minutos.empty()) {
+            filtro.desdeMs = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count() -
+                             std::atoll(minutos.c_str()) * 60000;
+        }
+        fs::path dest = fs::path(targetDir) / (filename.str() + ".csv");
+        std::ofstream out(dest, std::ios::binary);
+        if (!out) {
+            return std::string("No se pudo exportar log: no se pudo crear ") + dest.string();
+        }
+        logger.flush();
+        out << registro_log::cabeceraCsv();
+        const EstadisticasConsulta est = indiceLog.consultar(filtro, [&](const RegistroLog& r) {
+            out << registro_log::aCsv(r);
+            return true;
+        });
+        out.close();
+        std::string resultado = "Log exportado en " + dest.string() + " (" + std::to_string(est.coincidencias) +
+                                " registros)";
+
+        // El log del servidor estático se sigue copiando tal cual
+        fs::path source = fs::path("HTML") / "static_server.log";
+        if (fs::exists(source)) {
+            fs::path copia = fs::path(targetDir) / (filename.str() + "_static.log");
+            fs::copy_file(source, copia, fs::copy_options::overwrite_existing, ec);
+            if (!ec) resultado += " y " + copia.string();
         }
-        return std::string("Log exportado en ") + dest.string();
+        return resultado;
     };
 
 
@@ -347,6 +409,51 @@ std::string dispatchCommand(const std::string& line,
     return it->second(args, ctx);
 }
 
+// Ruta para el log: el valor de token= en la query (subidas) no se guarda
+std::string rutaParaLog(const std::string& path) {
+    const auto q = path.find('?');
+    if (q == std::string::npos) return path;
+    std::string out = path.substr(0, q + 1);
+    size_t pos = q + 1;
+    while (pos <= path.size()) {
+        size_t fin = path.find('&', pos);
+        if (fin == std::string::npos) fin = path.size();
+        const std::string param = path.substr(pos, fin - pos);
+        out += param.rfind("token=", 0) == 0 ? "token=-" : param;
+        if (fin < path.size()) out += '&';
+        pos = fin + 1;
+    }
+    return out;
+}
+
+std::string respuesta429(int64_t reintentarMs) {
+    const int64_t segundos = std::max<int64_t>(1, (reintentarMs + 999) / 1000);
+    const std::string cuerpo = "429 Too Many Requests";
+    std::ostringstream out;
+    out << "HTTP/1.1 429 Too Many Requests\r\n"
+        << "Content-Type: text/plain\r\n"
+        << "Content-Length: " << cuerpo.size() << "\r\n"
+        << "Retry-After: " << segundos << "\r\n"
+        << "Access-Control-Allow-Origin: *\r\n"
+        << "Access-Control-Expose-Headers: Retry-After\r\n"
+        << "\r\n"
+        << cuerpo;
+    return out.str();
+}
+
+std::string respuestaRpcHttp(const std::string& resp) {
+    std::ostringstream out;
+    out << "HTTP/1.1 200 OK\r\n"
+        << "Access-Control-Allow-Origin: *\r\n"
+        << "Access-Control-Allow-Methods: POST, OPTIONS\r\n"
+        << "Access-Control-Allow-Headers: Content-Type\r\n"
+        << "Content-Type: text/xml\r\n"
+        << "Content-Length: " << resp.size() << "\r\n"
+        << "\r\n"
+        << resp;
+    return out.str();
+}
+
 
 
 int main(int argc, char* argv[]) {
@@ -385,12 +492,52 @@ int main(int argc, char* argv[]) {
     Login login;
     if(!login.isConnected()) return 1;
 
+    // Estado anterior a una caída: snapshot + diario
+    const ReporteRecuperacion recuperacion = diarioEstado.recuperar();
+    const EstadoPersistido previo = diarioEstado.copia();
+    std::cout << "💾 Estado recuperado en " << std::fixed << std::setprecision(2) << recuperacion.milisegundos
+              << " ms (" << recuperacion.registros << " registros"
+              << (recuperacion.snapshot ? " + snapshot" : "") << ")" << std::defaultfloat << std::endl;
+    if (recuperacion.bytesDescartados > 0) {
+        std::cerr << "⚠️ Diario de estado: " << recuperacion.bytesDescartados
+                  << " bytes finales descartados (escritura incompleta)" << std::endl;
+    }
+
     EstadoRobot estado;
+    if (previo.hayRobot) {
+        estado.setPos(previo.robot.x, previo.robot.y, previo.robot.z, previo.robot.e);
+        estado.setMotores(previo.robot.motores);
+        estado.setGarra(previo.robot.garra);
+        estado.setModo(previo.robot.modoAbs);
+        estado.setEmergencia(previo.robot.emergencia);
+    }
+    estado.setObservador([](const EstadoRobot::Snapshot& s) {
+        telemetria.registrar(s);
+        diarioEstado.encolarRobot(s);
+    });
     ComunicacionControladorSimple comm("/dev/ttyUSB0", B19200);
     Aprendizaje aprendizaje;
     AdministradorSistema admin;
+    if (previo.hayRemoto) admin.setRemoto(previo.remoto);
+    for (const auto& [token, sesion] : previo.sesiones) {
+        login.restaurarSesion(token, sesion.usuario, sesion.privilegio, sesion.creadaMs);
+    }
+    if (previo.aprendiendo) aprendizaje.reanudar(previo.rutaAprendizaje);
+    if (previo.trabajo.activo) {
+        std::cerr << "⚠️ Trabajo interrumpido: " << previo.trabajo.ruta << " (última línea enviada "
+                  << previo.trabajo.linea << ")" << std::endl;
+        logger.logEvent("diario", "Trabajo interrumpido " + previo.trabajo.ruta + " linea:" +
+                                      std::to_string(previo.trabajo.linea));
+        // Ya se informó: no se reanuda solo, se cierra para no avisarlo en cada arranque
+        diarioEstado.finTrabajo();
+    }
     RobotControllerSimple robot(comm, estado);
     robot.setAprendizaje(&aprendizaje);
+    // Blobs que ya no tienen ningún nombre (trabajos borrados a mano)
+    if (const uint64_t huerfanos = almacenBlobs.recolectar()) {
+        std::cout << "🧹 " << huerfanos << " blobs sin referencias eliminados" << std::endl;
+    }
+    catalogoTrabajos.iniciar({"jobs", "uploads", "aprendizajes", "aprendizaje gcode"});
 
     ctx.login = &login;
     ctx.robot = &robot;
@@ -415,7 +562,9 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
-    listen(server_fd, 5);
+    // Con el límite de tasa un exceso se despacha rápido con 429; mejor
+    // encolarlo que hacer reintentar el SYN al cliente (1 s o más)
+    listen(server_fd, 64);
     std::cout << "🚀 Servidor escuchando en puerto 8080" << std::endl;
     std::cout << "🔗 Mandar [start] para empezar el servidor." << std::endl;
     ServerB.press_enter(cleanTerminal);
@@ -431,11 +580,16 @@ int main(int argc, char* argv[]) {
     bool hasCachedRequest = false;
 
     while(ctx.running || closing) {
-        int client_fd = accept(server_fd, nullptr, nullptr);
+        sockaddr_in cliente{};
+        socklen_t largoCliente = sizeof(cliente);
+        int client_fd = accept(server_fd, reinterpret_cast<sockaddr*>(&cliente), &largoCliente);
         if (client_fd < 0) {
             if (closing) break;
             else continue;
         }
+        // El bucle es uno solo: una conexión que no manda nada no lo puede retener
+        timeval esperaLectura{2, 0};
+        setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &esperaLectura, sizeof(esperaLectura));
         char buffer[8192] = {0};
         ssize_t n = read(client_fd, buffer, sizeof(buffer) - 1);
         bool suppressLogging = false;
@@ -445,11 +599,15 @@ int main(int argc, char* argv[]) {
         std::chrono::steady_clock::time_point requestTimestamp;
         EstadoRobot::Snapshot snapshotBefore{};
         std::string respuestaHttp;
+        std::string requestLine;
+        bool respuestaDiferida = false;     // la conexión la cierra otro hilo
+        bool rechazada = false;             // fuera de presupuesto: 429 sin procesar
         
         if(n > 0) {
             std::string req(buffer, n);
             std::string method, path;
             ServerB.parseHttpRequest(req, method, path);
+            requestLine = method + " " + rutaParaLog(path);
             requestTimestamp = std::chrono::steady_clock::now();
             snapshotBefore = estado.leer();
             snapshotCaptured = true;
@@ -463,25 +621,49 @@ int main(int argc, char* argv[]) {
                 }
             }
             suppressLogging = isHealthCheck || isStatusPoll;
-            if (hasCachedRequest) {
+            // Admisión antes que nada: también antes del caché de duplicados
+            if (!closing && method != "OPTIONS") {
+                char ip[INET_ADDRSTRLEN] = "-";
+                inet_ntop(AF_INET, &cliente.sin_addr, ip, sizeof(ip));
+                Server::IdentidadRPC id;
+                if (method == "GET") {
+                    id.clase = isHealthCheck ? ClaseTrafico::ESTADO : ClaseTrafico::ESTATICO;
+                } else if (method == "POST" && path.rfind("/upload", 0) != 0) {
+                    id = ServerB.identificarRPC(req, login);
+                }
+                if (id.critica) {
+                    limitadorTasa.registrarExenta();
+                } else {
+                    const int64_t ahora = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        requestTimestamp.time_since_epoch()).count();
+                    const ResultadoAdmision adm = limitadorTasa.admitir(id.clase, ip, id.usuario, ahora);
+                    if (!adm.admitida) {
+                        rechazada = true;
+                        respuestaHttp = respuesta429(adm.reintentarMs);
+                        CONSOLA_DEBUG("🚦 429 " << LimitadorTasa::nombreClase(id.clase) << " " << ip
+                                      << (id.usuario.empty() ? "" : " " + id.usuario) << " " << requestLine);
+                    }
+                }
+            }
+            if (hasCachedRequest && !rechazada) {
                 const bool withinWindow = (requestTimestamp - lastRequestCache.timestamp) <= kRequestDedupWindow;
                 if (withinWindow &&
                     requestSignature == lastRequestCache.signature &&
-                    snapshotsEqual(snapshotBefore, lastRequestCache.estado)) {
+                    snapshotBefore.version == lastRequestCache.estado.version) {
                     duplicateRequest = true;
                     suppressLogging = true;
                     respuestaHttp = lastRequestCache.response;
                 }
             }
-            if (!suppressLogging) {
+            if (!suppressLogging && consola::activo(NivelConsola::DEBUG)) {
                 if (cleanTerminal && !firstFeedback) {
                     std::system("clear");
                 }
                 firstFeedback = false;
-                std::cout << "🌐 SOLICITUD: " << method << " " << path << std::endl;
+                CONSOLA_DEBUG("🌐 SOLICITUD: " << requestLine);
             }
             
-            if (!duplicateRequest) {
+            if (!duplicateRequest && !rechazada) {
                 if (closing) {
                     std::string closingHtml = ServerB.readFile("HTML/server_terminated.html");
                     if (closingHtml.empty()) {
@@ -525,18 +707,45 @@ int main(int argc, char* argv[]) {
                         if (body_pos != std::string::npos) {
                             std::string body = req.substr(body_pos + 4);
 
-                            // Si la ruta es /upload -> guardar CSV, convertir a .gcode y ejecutar
+                            // Si la ruta es /upload -> convertir el CSV a .gcode mientras llega (y guardarlo si se pide)
                             if (path.rfind("/upload", 0) == 0) {
                                 try {
                                     // Extraer nombre de archivo desde query ?name=...
                                     std::string filename = "uploaded.csv";
+                                    std::string uploader;
+                                    bool conservarCsv = true;
+                                    bool reporteJson = false;
+                                    OpcionesValidacion opcionesValidacion;
                                     auto qpos = path.find('?');
                                     if (qpos != std::string::npos) {
                                         std::string query = path.substr(qpos + 1);
+                                        // valor de clave= hasta el próximo '&'
+                                        auto parametro = [&query](const std::string& clave) -> std::string {
+                                            size_t p = 0;
+                                            while ((p = query.find(clave + "=", p)) != std::string::npos) {
+                                                if (p == 0 || query[p - 1] == '&') {
+                                                    size_t ini = p + clave.size() + 1;
+                                                    return query.substr(ini, query.find('&', ini) - ini);
+                                                }
+                                                p += clave.size();
+                                            }
+                                            return std::string();
+                                        };
+                                        // quien sube el archivo queda como creador en el catálogo
+                                        const std::string token = parametro("token");
+                                        if (auto activa = login.resolverSesion(token)) uploader = activa->usuario;
+                                        // keepCsv=0: sólo queda el .gcode
+                                        conservarCsv = parametro("keepCsv") != "0";
+                                        // format=json: reporte de validación estructurado
+                                        reporteJson = parametro("format") == "json";
+                                        const std::string maxFeed = parametro("maxFeed");
+                                        if (!maxFeed.empty()) opcionesValidacion.feedMaximo = std::strtof(maxFeed.c_str(), nullptr);
+                                        const std::string maxProblemas = parametro("maxProblems");
+                                        if (!maxProblemas.empty()) opcionesValidacion.maxProblemas = std::strtoul(maxProblemas.c_str(), nullptr, 10);
                                         // buscar name=
                                         auto npos = query.find("name=");
                                         if (npos != std::string::npos) {
-                                            filename = query.substr(npos + 5);
+                                            filename = parametro("name");
                                             // decode simple %20 etc.
                                             auto urlDecode = [](std::string s){
                                                 std::string out; out.reserve(s.size());
@@ -562,52 +771,130 @@ int main(int argc, char* argv[]) {
                                     fs::create_directories("uploads");
                                     fs::create_directories("jobs");
 
-                                    fs::path csvpath = fs::path("uploads") / filename;
-                                    // Guardar CSV crudo
-                                    std::ofstream fout(csvpath, std::ios::out | std::ios::binary);
-                                    fout << body;
-                                    fout.close();
-
-                                    // Convertir CSV a GCODE (.gcode)
-                                    std::ifstream fin(csvpath);
                                     std::string base = filename;
                                     // quitar extension .csv
                                     auto posdot = base.find_last_of('.');
                                     if (posdot != std::string::npos) base = base.substr(0,posdot);
                                     fs::path gcodepath = fs::path("jobs") / (base + ".gcode");
-                                    std::ofstream gout(gcodepath, std::ios::out | std::ios::trunc);
-                                    if (fin && gout) {
-                                        std::string line;
-                                        bool first = true;
-                                        while (std::getline(fin, line)) {
-                                            if (first) { first = false; continue; } // saltar header
-                                            // trim
-                                            auto l = line;
-                                            while (!l.empty() && (l.back()=='\r' || l.back()=='\n')) l.pop_back();
-                                            if (l.size()>=2 && l.front()=='"' && l.back()=='"') {
-                                                l = l.substr(1, l.size()-2);
-                                                // des-escape ""
-                                                std::string tmp; tmp.reserve(l.size());
-                                                for (size_t i=0;i<l.size();++i) {
-                                                    if (l[i]=='"' && i+1<l.size() && l[i+1]=='"') { tmp.push_back('"'); ++i; }
-                                                    else tmp.push_back(l[i]);
-                                                }
-                                                l = tmp;
-                                            }
-                                            if (!l.empty()) gout << l << "\n";
-                                        }
-                                        gout.close();
-                                        fin.close();
+                                    fs::path csvpath = fs::path("uploads") / filename;
 
-                                        // No ejecutar automáticamente: guardar el GCODE y devolver ruta.
+                                    // El cuerpo se convierte a medida que llega: nunca está entero en memoria
+                                    long long largo = -1;
+                                    {
+                                        std::string cabeceras = req.substr(0, body_pos);
+                                        std::string minus = cabeceras;
+                                        std::transform(minus.begin(), minus.end(), minus.begin(), [](unsigned char c) { return std::tolower(c); });
+                                        auto cl = minus.find("\r\ncontent-length:");
+                                        if (cl != std::string::npos) largo = std::atoll(cabeceras.c_str() + cl + 17);
+                                    }
+                                    auto responder = [&respuestaHttp](const char* estadoHttp, const std::string& texto) {
                                         std::ostringstream out;
-                                        std::string ok = std::string("Archivo subido: ") + gcodepath.string();
-                                        out << "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: " << ok.size() << "\r\nAccess-Control-Allow-Origin: *\r\n\r\n" << ok;
+                                        out << "HTTP/1.1 " << estadoHttp << "\r\nContent-Type: text/plain\r\nContent-Length: " << texto.size() << "\r\nAccess-Control-Allow-Origin: *\r\n\r\n" << texto;
                                         respuestaHttp = out.str();
+                                    };
+                                    if (largo < 0) {
+                                        responder("411 Length Required", "Falta Content-Length");
                                     } else {
-                                        std::string err = "Error al convertir CSV a GCODE";
-                                        std::ostringstream out; out << "HTTP/1.1 500 Internal Server Error\r\nContent-Type: text/plain\r\nContent-Length: " << err.size() << "\r\nAccess-Control-Allow-Origin: *\r\n\r\n" << err;
-                                        respuestaHttp = out.str();
+                                        ConversorCsvGcode conversor(gcodepath.string(), conservarCsv ? csvpath.string() : std::string());
+                                        if (!conversor.abrir()) {
+                                            responder("500 Internal Server Error", "Error al convertir CSV a GCODE");
+                                        } else {
+                                            size_t recibidos = std::min<size_t>(body.size(), static_cast<size_t>(largo));
+                                            bool escrito = conversor.alimentar(body.data(), recibidos);
+                                            body.clear();
+                                            body.shrink_to_fit();
+                                            // Un cliente que deja de mandar no bloquea el servidor para siempre
+                                            timeval espera{10, 0};
+                                            setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &espera, sizeof(espera));
+                                            char bloque[64 * 1024];
+                                            while (escrito && recibidos < static_cast<size_t>(largo)) {
+                                                const size_t pedir = std::min(sizeof(bloque), static_cast<size_t>(largo) - recibidos);
+                                                ssize_t r = read(client_fd, bloque, pedir);
+                                                if (r < 0 && errno == EINTR) continue;
+                                                if (r <= 0) break;
+                                                recibidos += static_cast<size_t>(r);
+                                                escrito = conversor.alimentar(bloque, static_cast<size_t>(r));
+                                            }
+                                            if (!escrito) {
+                                                conversor.abortar("Error de escritura");
+                                                responder("500 Internal Server Error", "Error al convertir CSV a GCODE");
+                                            } else if (recibidos < static_cast<size_t>(largo)) {
+                                                conversor.abortar("Cuerpo incompleto");
+                                                responder("400 Bad Request", "Cuerpo incompleto: " + std::to_string(recibidos) + " de " + std::to_string(largo) + " bytes");
+                                            } else {
+                                                const ResultadoConversion res = conversor.terminar();
+                                                if (!res.ok) {
+                                                    responder("500 Internal Server Error", "Error al convertir CSV a GCODE: " + res.error);
+                                                } else {
+                                                    catalogoTrabajos.registrarCreador(gcodepath.string(), uploader);
+                                                    // Validación completa en paralelo sobre el .gcode recién publicado
+                                                    ReporteValidacion val;
+                                                    const bool validado = gcode::validarArchivo(gcodepath.string(), opcionesValidacion, val);
+                                                    double segundos = -1.0;
+                                                    // Estimación de duración sobre el IR recién compilado
+                                                    if (auto programa = cacheGcode.obtener(gcodepath.string())) {
+                                                        segundos = gcode::estimarDuracion(*programa, OpcionesEstimador{}, false).segundosTotales;
+                                                    }
+                                                    if (reporteJson) {
+                                                        json problemas = json::array();
+                                                        for (const auto& e : res.errores) {
+                                                            problemas.push_back({{"linea", nullptr}, {"lineaCsv", e.linea}, {"tipo", "csv"}, {"detalle", e.motivo}});
+                                                        }
+                                                        json porTipo = json::object();
+                                                        for (const auto& p : val.problemas) {
+                                                            problemas.push_back({{"linea", p.linea}, {"lineaCsv", conversor.lineaCsv(p.linea)},
+                                                                                 {"tipo", gcode::describirProblema(p.tipo)}, {"detalle", p.detalle}});
+                                                        }
+                                                        for (size_t t = 0; t < static_cast<size_t>(TipoProblema::NUM_TIPOS); ++t) {
+                                                            porTipo[gcode::describirProblema(static_cast<TipoProblema>(t))] = val.porTipo[t];
+                                                        }
+                                                        json cuerpo = {
+                                                            {"gcode", gcodepath.string()},
+                                                            {"csv", res.rutaCsv},
+                                                            {"hash", gcode::hashHex(res.hashGcode)},
+                                                            {"segundosEstimados", segundos},
+                                                            {"lineas", res.lineasGcode},
+                                                            {"vacias", res.vacias},
+                                                            {"erroresCsv", res.invalidas},
+                                                            {"validado", validado},
+                                                            {"valido", validado && val.ok() && res.invalidas == 0},
+                                                            {"instrucciones", val.instrucciones},
+                                                            {"movimientos", val.movimientos},
+                                                            {"lineasConProblemas", val.conProblemas},
+                                                            {"porTipo", porTipo},
+                                                            {"truncado", val.truncado || res.invalidas > res.errores.size()},
+                                                            {"problemas", problemas},
+                                                            {"milisegundosValidacion", val.milisegundos},
+                                                            {"hilos", val.hilos}
+                                                        };
+                                                        const std::string texto = cuerpo.dump();
+                                                        std::ostringstream out;
+                                                        out << "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: " << texto.size() << "\r\nAccess-Control-Allow-Origin: *\r\n\r\n" << texto;
+                                                        respuestaHttp = out.str();
+                                                    } else {
+                                                        // No ejecutar automáticamente: guardar el GCODE y devolver ruta.
+                                                        std::string ok = std::string("Archivo subido: ") + gcodepath.string();
+                                                        if (segundos >= 0.0) {
+                                                            std::ostringstream dur;
+                                                            dur << std::fixed << std::setprecision(1) << segundos;
+                                                            ok += " (duración estimada " + dur.str() + " s)";
+                                                        }
+                                                        ok += "\n" + std::to_string(res.lineasGcode) + " líneas, " + std::to_string(res.vacias) + " vacías, " +
+                                                              std::to_string(res.invalidas + val.conProblemas) + " con problemas";
+                                                        for (const auto& e : res.errores) {
+                                                            ok += "\nCSV línea " + std::to_string(e.linea) + ": " + e.motivo;
+                                                        }
+                                                        for (const auto& p : val.problemas) {
+                                                            ok += "\nlínea " + std::to_string(p.linea) + " (CSV " + std::to_string(conversor.lineaCsv(p.linea)) +
+                                                                  "): " + gcode::describirProblema(p.tipo) + ": " + p.detalle;
+                                                        }
+                                                        if (!validado) ok += "\nNo se pudo validar el G-code";
+                                                        else if (val.truncado) ok += "\n(hay más problemas; se muestran los primeros " + std::to_string(val.problemas.size()) + ")";
+                                                        responder("200 OK", ok);
+                                                    }
+                                                }
+                                            }
+                                        }
                                     }
                                 }                                 
                                 catch (const std::exception& e) {
@@ -616,25 +903,27 @@ int main(int argc, char* argv[]) {
                                     respuestaHttp = out.str();
                                     ServerB.press_enter(cleanTerminal);
                                 }
+                            } else if (ServerB.procesarLoginAsync(body, login, [client_fd, requestLine, cliente](const std::string& resp) {
+                                           // Desde el pool de autenticación: responde, cierra y registra
+                                           const std::string http = respuestaRpcHttp(resp);
+                                           write(client_fd, http.c_str(), http.size());
+                                           close(client_fd);
+                                           char ip[INET_ADDRSTRLEN] = "-";
+                                           inet_ntop(AF_INET, &cliente.sin_addr, ip, sizeof(ip));
+                                           logger.logRequest(requestLine, "-", ip, 200);
+                                       })) {
+                                // La derivación PBKDF2 no frena el bucle de accept
+                                respuestaDiferida = true;
                             } else {
                                 const bool quietRpc = isStatusPoll;
                                 std::string resp = ServerB.procesarRPC(body, login, robot, estado, aprendizaje, admin, quietRpc);
-                        
-                                std::ostringstream out;
-                                out << "HTTP/1.1 200 OK\r\n"
-                                    << "Access-Control-Allow-Origin: *\r\n"
-                                    << "Access-Control-Allow-Methods: POST, OPTIONS\r\n"
-                                    << "Access-Control-Allow-Headers: Content-Type\r\n"
-                                    << "Content-Type: text/xml\r\n"
-                                    << "Content-Length: " << resp.size() << "\r\n"
-                                    << "\r\n"
-                                    << resp;
-                                respuestaHttp = out.str();
+                                respuestaHttp = respuestaRpcHttp(resp);
                             }
                         }
                 }
             }
             
+            if (respuestaDiferida) continue;
             const bool wasClosingResponse = closing;
             if (!respuestaHttp.empty()) {
                 write(client_fd, respuestaHttp.c_str(), respuestaHttp.size());
@@ -642,9 +931,13 @@ int main(int argc, char* argv[]) {
                     closingServed.store(true);
                 }
                 if (!suppressLogging) {
-                    std::cout << "✅ RESPUESTA ENVIADA (" << respuestaHttp.size() << " bytes)" << std::endl;
+                    CONSOLA_DEBUG("✅ RESPUESTA ENVIADA (" << respuestaHttp.size() << " bytes)");
+                    // "HTTP/1.1 200 ..." -> 200; el registro sólo encola, no toca el disco
+                    char ip[INET_ADDRSTRLEN] = "-";
+                    inet_ntop(AF_INET, &cliente.sin_addr, ip, sizeof(ip));
+                    logger.logRequest(requestLine, "-", ip, std::atoi(respuestaHttp.c_str() + 9));
                 }
-                if (snapshotCaptured) {
+                if (snapshotCaptured && !rechazada) {
                     lastRequestCache.signature = requestSignature;
                     lastRequestCache.response = respuestaHttp;
                     lastRequestCache.estado = snapshotBefore;
@@ -655,13 +948,16 @@ int main(int argc, char* argv[]) {
                 std::string error = "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\nContent-Length: 13\r\nAccess-Control-Allow-Origin: *\r\n\r\n404 Not Found";
                 write(client_fd, error.c_str(), error.size());
                 if (!suppressLogging) {
-                    std::cout << "❌ ENVIADO 404" << std::endl;
+                    CONSOLA_DEBUG("❌ ENVIADO 404");
+                    char ip[INET_ADDRSTRLEN] = "-";
+                    inet_ntop(AF_INET, &cliente.sin_addr, ip, sizeof(ip));
+                    logger.logRequest(requestLine, "-", ip, 404);
                 }
             }
         }
         close(client_fd);
         if (!suppressLogging) {
-            std::cout << "----------------------------------------" << std::endl;
+            CONSOLA_DEBUG("----------------------------------------");
         }
     }
     close(server_fd);
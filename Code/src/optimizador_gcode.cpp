@@ -0,0 +1,270 @@
+#include "optimizador_gcode.h"
+
+#include <cmath>
+
+namespace {
+constexpr int kEjes = 4; // X Y Z E
+constexpr CampoGcode kCampoEje[kEjes] = {CAMPO_X, CAMPO_Y, CAMPO_Z, CAMPO_E};
+constexpr float kEpsilon = 1e-4f;
+
+// Estado modal simulado. -1 = desconocido.
+struct EstadoModal {
+    int modoAbs = -1;
+    int motores = -1;
+    int garra = -1;
+    bool conocido[kEjes] = {};
+    float pos[kEjes] = {};
+
+    bool posicionConocida() const {
+        return conocido[0] && conocido[1] && conocido[2];
+    }
+    void olvidarPosicion() {
+        for (bool& c : conocido) c = false;
+    }
+};
+
+bool iguales(float a, float b) { return std::fabs(a - b) <= kEpsilon; }
+
+// Calcula el destino de un G0/G1. Devuelve false si no se puede determinar.
+bool destinoMovimiento(const EstadoModal& st, const InstruccionGcode& ins,
+                       float destino[kEjes], bool conocido[kEjes]) {
+    if (st.modoAbs < 0) return false;
+    for (int e = 0; e < kEjes; ++e) {
+        const bool especificado = ins.tiene(kCampoEje[e]);
+        if (!especificado) {
+            destino[e] = st.pos[e];
+            conocido[e] = st.conocido[e];
+        } else if (st.modoAbs == 1) {
+            destino[e] = ins.valor(kCampoEje[e]);
+            conocido[e] = true;
+        } else {
+            destino[e] = st.pos[e] + ins.valor(kCampoEje[e]);
+            conocido[e] = st.conocido[e];
+        }
+    }
+    return true;
+}
+
+bool esMovimientoNulo(const EstadoModal& st, const InstruccionGcode& ins) {
+    if (st.modoAbs == 0) {
+        for (int e = 0; e < kEjes; ++e) {
+            if (ins.tiene(kCampoEje[e]) && !iguales(ins.valor(kCampoEje[e]), 0.0f)) return false;
+        }
+        return true;
+    }
+    if (st.modoAbs == 1) {
+        for (int e = 0; e < kEjes; ++e) {
+            if (!ins.tiene(kCampoEje[e])) continue;
+            if (!st.conocido[e] || !iguales(ins.valor(kCampoEje[e]), st.pos[e])) return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+float feedDe(const InstruccionGcode& ins) {
+    return ins.tiene(CAMPO_F) ? ins.valor(CAMPO_F) : 0.0f;
+}
+
+// B está sobre el segmento AC (dentro de la tolerancia y sin retroceder).
+// Sólo mira XYZ; quien llama garantiza que E no se mueve.
+bool colineal(const float a[kEjes], const float b[kEjes], const float c[kEjes], float tolerancia) {
+    double ac[3], ab[3];
+    double largo2 = 0.0;
+    for (int e = 0; e < 3; ++e) {
+        ac[e] = c[e] - a[e];
+        ab[e] = b[e] - a[e];
+        largo2 += ac[e] * ac[e];
+    }
+    if (largo2 < 1e-12) return false;
+    double t = (ab[0] * ac[0] + ab[1] * ac[1] + ab[2] * ac[2]) / largo2;
+    if (t <= 0.0 || t >= 1.0) return false;
+    double d2 = 0.0;
+    for (int e = 0; e < 3; ++e) {
+        double r = ab[e] - t * ac[e];
+        d2 += r * r;
+    }
+    return d2 <= static_cast<double>(tolerancia) * tolerancia;
+}
+
+// Cancela un toggle (M3→M5, M17→M18) si la instrucción previa emitida es
+// el opuesto inmediato y el estado anterior a ella ya era el final.
+bool cancelaToggle(std::vector<InstruccionGcode>& salida, OpGcode opuesto,
+                   int estadoPrevioAlOpuesto, int estadoFinal) {
+    if (salida.empty() || salida.back().op != opuesto) return false;
+    if (estadoPrevioAlOpuesto != estadoFinal) return false;
+    salida.pop_back();
+    return true;
+}
+}
+
+namespace gcode {
+
+ProgramaGcode optimizar(const ProgramaGcode& programa, const OpcionesOptimizador& opciones,
+                        ReporteOptimizacion& reporte) {
+    reporte = ReporteOptimizacion{};
+    reporte.lineasOriginales = programa.instrucciones.size();
+
+    ProgramaGcode out;
+    out.lineasFuente = programa.lineasFuente;
+    auto& salida = out.instrucciones;
+    salida.reserve(programa.instrucciones.size());
+
+    EstadoModal st;
+    bool modoSupuesto = opciones.asumirAbsoluto;
+    if (modoSupuesto) st.modoAbs = 1;
+    // Último movimiento emitido, si es la última instrucción de la salida
+    bool hayUltimoMov = false;
+    float origenUltimo[kEjes] = {};
+    // Estado de garra/motores antes de la última M3/M5/M17/M18 emitida
+    int garraPrevia = -1;
+    int motoresPrevios = -1;
+
+    for (const auto& ins : programa.instrucciones) {
+        if (!ins.valida()) {
+            // No se ejecutarían: se descartan y actúan como barrera
+            hayUltimoMov = false;
+            continue;
+        }
+        switch (ins.op) {
+            case OpGcode::MOVER: {
+                if (esMovimientoNulo(st, ins)) {
+                    ++reporte.movimientosNulos;
+                    continue;
+                }
+                float destino[kEjes];
+                bool conocido[kEjes];
+                if (!destinoMovimiento(st, ins, destino, conocido)) {
+                    st.olvidarPosicion();
+                    salida.push_back(ins);
+                    hayUltimoMov = false;
+                    continue;
+                }
+                const bool todoConocido = st.posicionConocida() &&
+                    conocido[0] && conocido[1] && conocido[2] && !ins.tiene(CAMPO_E);
+                if (opciones.fusionarColineales && todoConocido && hayUltimoMov &&
+                    !salida.empty() && salida.back().op == OpGcode::MOVER &&
+                    iguales(feedDe(salida.back()), feedDe(ins)) &&
+                    colineal(origenUltimo, st.pos, destino, opciones.toleranciaColineal)) {
+                    // Se reemplaza A→B→C por A→C
+                    // Los ejes no especificados en C se tomarían desde A, no
+                    // desde B, así que el destino se escribe completo.
+                    InstruccionGcode fusion = ins;
+                    for (int e = 0; e < 3; ++e) {
+                        if (st.modoAbs == 1) {
+                            fusion.fijar(kCampoEje[e], destino[e]);
+                            continue;
+                        }
+                        float delta = destino[e] - origenUltimo[e];
+                        if (iguales(delta, 0.0f)) {
+                            fusion.campos &= static_cast<uint16_t>(~(1u << kCampoEje[e]));
+                        } else {
+                            fusion.fijar(kCampoEje[e], delta);
+                        }
+                    }
+                    salida.back() = fusion;
+                    ++reporte.segmentosFusionados;
+                } else {
+                    for (int e = 0; e < kEjes; ++e) origenUltimo[e] = st.pos[e];
+                    hayUltimoMov = todoConocido;
+                    salida.push_back(ins);
+                }
+                for (int e = 0; e < kEjes; ++e) {
+                    st.pos[e] = destino[e];
+                    st.conocido[e] = conocido[e];
+                }
+                continue;
+            }
+            case OpGcode::ABSOLUTO:
+            case OpGcode::RELATIVO: {
+                const int modo = ins.op == OpGcode::ABSOLUTO ? 1 : 0;
+                const bool primero = modoSupuesto;
+                modoSupuesto = false;
+                if (st.modoAbs == modo && !primero) {
+                    ++reporte.modosRedundantes;
+                    continue;
+                }
+                // Dos cambios de modo seguidos: sólo cuenta el último
+                if (!salida.empty() && (salida.back().op == OpGcode::ABSOLUTO ||
+                                        salida.back().op == OpGcode::RELATIVO)) {
+                    salida.pop_back();
+                    ++reporte.modosRedundantes;
+                }
+                st.modoAbs = modo;
+                salida.push_back(ins);
+                hayUltimoMov = false;
+                continue;
+            }
+            case OpGcode::MOTORES_ON:
+            case OpGcode::MOTORES_OFF: {
+                const int on = ins.op == OpGcode::MOTORES_ON ? 1 : 0;
+                if (st.motores == on) {
+                    ++reporte.motoresRedundantes;
+                    continue;
+                }
+                const OpGcode opuesto = on ? OpGcode::MOTORES_OFF : OpGcode::MOTORES_ON;
+                if (cancelaToggle(salida, opuesto, motoresPrevios, on)) {
+                    reporte.motoresRedundantes += 2;
+                    st.motores = on;
+                    hayUltimoMov = false;
+                    continue;
+                }
+                motoresPrevios = st.motores;
+                st.motores = on;
+                salida.push_back(ins);
+                hayUltimoMov = false;
+                continue;
+            }
+            case OpGcode::GARRA_ON:
+            case OpGcode::GARRA_OFF: {
+                const int on = ins.op == OpGcode::GARRA_ON ? 1 : 0;
+                if (st.garra == on) {
+                    ++reporte.garraRedundante;
+                    continue;
+                }
+                const OpGcode opuesto = on ? OpGcode::GARRA_OFF : OpGcode::GARRA_ON;
+                if (cancelaToggle(salida, opuesto, garraPrevia, on)) {
+                    reporte.garraRedundante += 2;
+                    st.garra = on;
+                    hayUltimoMov = false;
+                    continue;
+                }
+                garraPrevia = st.garra;
+                st.garra = on;
+                salida.push_back(ins);
+                hayUltimoMov = false;
+                continue;
+            }
+            case OpGcode::ARCO_HORARIO:
+            case OpGcode::ARCO_ANTIHORARIO: {
+                // Se conserva tal cual; sólo importa dónde termina
+                float destino[kEjes];
+                bool conocido[kEjes];
+                if (destinoMovimiento(st, ins, destino, conocido)) {
+                    for (int e = 0; e < kEjes; ++e) {
+                        st.pos[e] = destino[e];
+                        st.conocido[e] = conocido[e];
+                    }
+                } else {
+                    st.olvidarPosicion();
+                }
+                break;
+            }
+            case OpGcode::HOME:
+            case OpGcode::OFFSET:
+                st.olvidarPosicion();
+                break;
+            default:
+                break;
+        }
+        salida.push_back(ins);
+        hayUltimoMov = false;
+    }
+
+    reporte.lineasResultantes = salida.size();
+    reporte.segundosAntes = estimarDuracion(programa, opciones.estimador, false).segundosTotales;
+    reporte.segundosDespues = estimarDuracion(out, opciones.estimador, false).segundosTotales;
+    return out;
+}
+
+} // namespace gcode
@@ -0,0 +1,331 @@
+#include "planificador_pick_place.h"
+
+#include "modelo_brazo.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace {
+constexpr int kEjes = 4; // X Y Z E
+constexpr CampoGcode kCampoEje[kEjes] = {CAMPO_X, CAMPO_Y, CAMPO_Z, CAMPO_E};
+// Costo de ir hacia o desde un punto sin solución de cinemática inversa:
+// más que cualquier giro posible, para que el orden lo evite si puede.
+constexpr double kPenalizacion = 4.0 * brazo::kPi;
+constexpr double kMejoraMinima = 1e-9;
+
+// Posición en coordenadas de máquina (lo que ve RobotGeometry), con el
+// offset de G92 aplicado como en el estimador.
+struct EstadoSim {
+    int modoAbs = -1;
+    float pos[kEjes] = {brazo::kInicialX, brazo::kInicialY, brazo::kInicialZ, brazo::kInicialE};
+    float offset[kEjes] = {};
+
+    void destino(const InstruccionGcode& ins, float out[kEjes]) const {
+        for (int e = 0; e < kEjes; ++e) {
+            if (!ins.tiene(kCampoEje[e])) out[e] = pos[e];
+            else if (modoAbs == 0) out[e] = pos[e] + ins.valor(kCampoEje[e]);
+            else out[e] = ins.valor(kCampoEje[e]) + offset[e];
+        }
+    }
+
+    void avanzar(const InstruccionGcode& ins) {
+        if (!ins.valida()) return;
+        switch (ins.op) {
+            case OpGcode::MOVER:
+            case OpGcode::ARCO_HORARIO:
+            case OpGcode::ARCO_ANTIHORARIO: {
+                float d[kEjes];
+                destino(ins, d);
+                std::copy(d, d + kEjes, pos);
+                break;
+            }
+            case OpGcode::HOME:
+                pos[0] = brazo::kInicialX;
+                pos[1] = brazo::kInicialY;
+                pos[2] = brazo::kInicialZ;
+                pos[3] = brazo::kInicialE;
+                break;
+            case OpGcode::OFFSET:
+                for (int e = 0; e < kEjes; ++e) {
+                    float nuevo = ins.tiene(kCampoEje[e]) ? ins.valor(kCampoEje[e]) : pos[e];
+                    offset[e] = pos[e] - nuevo;
+                }
+                break;
+            case OpGcode::ABSOLUTO: modoAbs = 1; break;
+            case OpGcode::RELATIVO: modoAbs = 0; break;
+            default: break;
+        }
+    }
+};
+
+struct Articular {
+    double q[3] = {};
+    bool alcanzable = false;
+};
+
+Articular articular(const float p[3]) {
+    Articular a;
+    a.alcanzable = brazo::cinematicaInversa(p[0], p[1], p[2], a.q[0], a.q[1], a.q[2]);
+    return a;
+}
+
+double costo(const Articular& a, const Articular& b) {
+    if (!a.alcanzable || !b.alcanzable) return kPenalizacion;
+    double m = 0.0;
+    for (int k = 0; k < 3; ++k) m = std::max(m, std::fabs(a.q[k] - b.q[k]));
+    return m;
+}
+
+// Movimiento absoluto que fija X, Y y Z: no depende de la posición previa.
+bool esInicioBloque(const EstadoSim& st, const InstruccionGcode& ins) {
+    return ins.valida() && ins.op == OpGcode::MOVER && st.modoAbs == 1 &&
+           ins.tiene(CAMPO_X) && ins.tiene(CAMPO_Y) && ins.tiene(CAMPO_Z);
+}
+
+struct Tramo {
+    size_t desde = 0, hasta = 0;    // [desde, hasta) en programa.instrucciones
+    bool bloque = false;
+    bool usaE = false;
+    Articular inicio, fin;
+};
+
+// Intenta leer un bloque que empieza en `i`: movimientos, M3, movimientos
+// o pausas, M5 y los movimientos parciales que le siguen (retracción).
+// Devuelve el índice final o `i` si no hay un bloque completo.
+size_t leerBloque(const std::vector<InstruccionGcode>& ins, size_t i, EstadoSim& st, Tramo& tramo) {
+    EstadoSim sim = st;
+    int garra = 0; // 0 = antes de M3, 1 = tras M3, 2 = tras M5
+    bool usaE = false;
+    const bool eInicial = ins[i].tiene(CAMPO_E);
+    float primero[kEjes];
+    sim.destino(ins[i], primero);
+
+    size_t j = i;
+    for (; j < ins.size(); ++j) {
+        const auto& x = ins[j];
+        if (!x.valida()) break;
+        if (x.op == OpGcode::MOVER || x.esArco()) {
+            if (garra == 2 && esInicioBloque(sim, x)) break;
+            usaE = usaE || x.tiene(CAMPO_E);
+            sim.avanzar(x);
+            continue;
+        }
+        if (x.op == OpGcode::PAUSA) continue;
+        if (x.op == OpGcode::GARRA_ON && garra == 0) { garra = 1; continue; }
+        if (x.op == OpGcode::GARRA_OFF && garra == 1) { garra = 2; continue; }
+        break;
+    }
+    // Si el riel se mueve dentro del bloque, el primer movimiento tiene que
+    // fijarlo; si no, el bloque heredaría la E del anterior.
+    if (garra != 2 || (usaE && !eInicial)) return i;
+
+    tramo.desde = i;
+    tramo.hasta = j;
+    tramo.bloque = true;
+    tramo.usaE = usaE;
+    tramo.inicio = articular(primero);
+    tramo.fin = articular(sim.pos);
+    st = sim;
+    return j;
+}
+
+// Costo del recorrido origen → t[0] → … → t[n-1] (→ destino, si hay).
+double costoRecorrido(const std::vector<size_t>& orden, const std::vector<Tramo>& bloques,
+                      const Articular& origen, const Articular* destino) {
+    if (orden.empty()) return 0.0;
+    double total = costo(origen, bloques[orden.front()].inicio);
+    for (size_t k = 0; k + 1 < orden.size(); ++k) {
+        total += costo(bloques[orden[k]].fin, bloques[orden[k + 1]].inicio);
+    }
+    if (destino) total += costo(bloques[orden.back()].fin, *destino);
+    return total;
+}
+
+std::vector<size_t> vecinoMasCercano(const std::vector<Tramo>& bloques, const Articular& origen) {
+    const size_t n = bloques.size();
+    std::vector<size_t> orden;
+    orden.reserve(n);
+    std::vector<bool> usado(n, false);
+    const Articular* actual = &origen;
+    for (size_t paso = 0; paso < n; ++paso) {
+        size_t mejor = n;
+        double mejorCosto = 0.0;
+        for (size_t b = 0; b < n; ++b) {
+            if (usado[b]) continue;
+            double c = costo(*actual, bloques[b].inicio);
+            if (mejor == n || c < mejorCosto) {
+                mejor = b;
+                mejorCosto = c;
+            }
+        }
+        usado[mejor] = true;
+        orden.push_back(mejor);
+        actual = &bloques[mejor].fin;
+    }
+    return orden;
+}
+
+// 2-opt asimétrico: invertir t[i..j] también invierte el sentido de los
+// tramos internos, cuyo costo se obtiene de sumas prefijas en ambos sentidos.
+void dosOpt(std::vector<size_t>& orden, const std::vector<Tramo>& bloques, const Articular& origen,
+            const Articular* destino, int maxPasadas) {
+    const size_t n = orden.size();
+    if (n < 2) return;
+    std::vector<double> ida(n, 0.0), vuelta(n, 0.0); // prefijos: [k] = suma de aristas < k
+
+    auto nodoInicio = [&](size_t k) -> const Articular& { return bloques[orden[k]].inicio; };
+    auto nodoFin = [&](size_t k) -> const Articular& { return bloques[orden[k]].fin; };
+
+    for (int pasada = 0; pasada < maxPasadas; ++pasada) {
+        for (size_t k = 0; k + 1 < n; ++k) {
+            ida[k + 1] = ida[k] + costo(nodoFin(k), nodoInicio(k + 1));
+            vuelta[k + 1] = vuelta[k] + costo(nodoFin(k + 1), nodoInicio(k));
+        }
+        bool mejoro = false;
+        for (size_t i = 0; i + 1 < n && !mejoro; ++i) {
+            const Articular& previo = i == 0 ? origen : nodoFin(i - 1);
+            for (size_t j = i + 1; j < n; ++j) {
+                double antes = costo(previo, nodoInicio(i)) + (ida[j] - ida[i]);
+                double despues = costo(previo, nodoInicio(j)) + (vuelta[j] - vuelta[i]);
+                if (j + 1 < n) {
+                    antes += costo(nodoFin(j), nodoInicio(j + 1));
+                    despues += costo(nodoFin(i), nodoInicio(j + 1));
+                } else if (destino) {
+                    antes += costo(nodoFin(j), *destino);
+                    despues += costo(nodoFin(i), *destino);
+                }
+                if (despues < antes - kMejoraMinima) {
+                    std::reverse(orden.begin() + static_cast<long>(i), orden.begin() + static_cast<long>(j) + 1);
+                    mejoro = true;
+                    break;
+                }
+            }
+        }
+        if (!mejoro) break;
+    }
+}
+}
+
+namespace gcode {
+
+double costoArticular(const float desde[3], const float hasta[3]) {
+    return costo(articular(desde), articular(hasta));
+}
+
+ProgramaGcode planificarPickPlace(const ProgramaGcode& programa, const OpcionesPlanificador& opciones,
+                                  ReportePlanificacion& reporte) {
+    reporte = ReportePlanificacion{};
+    const auto& ins = programa.instrucciones;
+
+    // 1) Partir el programa en bloques y tramos fijos
+    std::vector<Tramo> tramos;
+    std::vector<EstadoSim> estadoAntes; // estado de la simulación al comienzo de cada tramo
+    EstadoSim st;
+    if (opciones.asumirAbsoluto) st.modoAbs = 1;
+    for (size_t i = 0; i < ins.size();) {
+        Tramo t;
+        EstadoSim previo = st;
+        if (esInicioBloque(st, ins[i])) {
+            size_t j = leerBloque(ins, i, st, t);
+            if (j != i) {
+                tramos.push_back(t);
+                estadoAntes.push_back(previo);
+                ++reporte.bloques;
+                i = j;
+                continue;
+            }
+        }
+        st.avanzar(ins[i]);
+        if (!tramos.empty() && !tramos.back().bloque) {
+            tramos.back().hasta = i + 1;
+        } else {
+            t.desde = i;
+            t.hasta = i + 1;
+            tramos.push_back(t);
+            estadoAntes.push_back(previo);
+        }
+        ++i;
+    }
+
+    // 2) Reordenar cada corrida de bloques consecutivos
+    ProgramaGcode out;
+    out.lineasFuente = programa.lineasFuente;
+    out.instrucciones.reserve(ins.size());
+    auto copiar = [&](const Tramo& t) {
+        out.instrucciones.insert(out.instrucciones.end(), ins.begin() + static_cast<long>(t.desde),
+                                 ins.begin() + static_cast<long>(t.hasta));
+    };
+
+    for (size_t k = 0; k < tramos.size();) {
+        if (!tramos[k].bloque) {
+            copiar(tramos[k++]);
+            continue;
+        }
+        size_t fin = k;
+        while (fin < tramos.size() && tramos[fin].bloque && tramos[fin].usaE == tramos[k].usaE) ++fin;
+
+        const EstadoSim& antes = estadoAntes[k];
+        const Articular origen = articular(antes.pos);
+
+        // Lo que sigue a la corrida decide cómo termina el recorrido: libre
+        // (fin del programa, G28 u otro bloque), hacia un punto fijo (un
+        // movimiento absoluto completo) o con el último bloque fijo (algo
+        // que depende de la posición en que quedó el brazo).
+        bool ultimoFijo = false;
+        bool hayDestino = false;
+        Articular destino;
+        if (fin < tramos.size()) {
+            const Tramo& sig = tramos[fin];
+            const InstruccionGcode& x = ins[sig.desde];
+            if (sig.bloque) {
+                ultimoFijo = tramos[k].usaE && !sig.usaE;
+            } else if (x.valida() && x.op == OpGcode::HOME) {
+                // libre
+            } else if (esInicioBloque(estadoAntes[fin], x) && (!tramos[k].usaE || x.tiene(CAMPO_E))) {
+                float d[kEjes];
+                estadoAntes[fin].destino(x, d);
+                destino = articular(d);
+                hayDestino = true;
+            } else {
+                ultimoFijo = true;
+            }
+        }
+
+        std::vector<Tramo> bloques(tramos.begin() + static_cast<long>(k),
+                                   tramos.begin() + static_cast<long>(fin) - (ultimoFijo ? 1 : 0));
+        if (ultimoFijo) {
+            destino = tramos[fin - 1].inicio;
+            hayDestino = true;
+        }
+        const Articular* pDestino = hayDestino ? &destino : nullptr;
+
+        std::vector<size_t> original(bloques.size());
+        std::iota(original.begin(), original.end(), 0);
+        const double costoOriginal = costoRecorrido(original, bloques, origen, pDestino);
+        std::vector<size_t> orden = original;
+        if (bloques.size() >= 2) {
+            ++reporte.corridas;
+            orden = vecinoMasCercano(bloques, origen);
+            dosOpt(orden, bloques, origen, pDestino, opciones.maxPasadas2Opt);
+            if (costoRecorrido(orden, bloques, origen, pDestino) >= costoOriginal - kMejoraMinima) {
+                orden = original;
+            }
+        }
+        reporte.costoOriginal += costoOriginal;
+        reporte.costoNuevo += costoRecorrido(orden, bloques, origen, pDestino);
+
+        for (size_t p = 0; p < orden.size(); ++p) {
+            if (orden[p] != p) ++reporte.bloquesMovidos;
+            copiar(bloques[orden[p]]);
+        }
+        if (ultimoFijo) copiar(tramos[fin - 1]);
+        k = fin;
+    }
+
+    reporte.segundosAntes = estimarDuracion(programa, opciones.estimador, false).segundosTotales;
+    reporte.segundosDespues = estimarDuracion(out, opciones.estimador, false).segundosTotales;
+    return out;
+}
+
+} // namespace gcode
@@ -0,0 +1,84 @@
+#include "pool_hilos.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+PoolHilos::PoolHilos(unsigned n) {
+    if (n == 0) n = std::max(1u, std::thread::hardware_concurrency());
+    hilos.reserve(n);
+    for (unsigned i = 0; i < n; ++i) hilos.emplace_back(&PoolHilos::bucle, this);
+}
+
+PoolHilos::~PoolHilos() {
+    {
+        std::lock_guard<std::mutex> l(mtx);
+        detener = true;
+    }
+    cv.notify_all();
+    for (auto& h : hilos) h.join();
+}
+
+void PoolHilos::encolar(std::function<void()> tarea) {
+    {
+        std::lock_guard<std::mutex> l(mtx);
+        cola.push_back(std::move(tarea));
+    }
+    cv.notify_one();
+}
+
+bool PoolHilos::intentarEncolar(std::function<void()> tarea, size_t maxPendientes) {
+    {
+        std::lock_guard<std::mutex> l(mtx);
+        if (cola.size() >= maxPendientes) return false;
+        cola.push_back(std::move(tarea));
+    }
+    cv.notify_one();
+    return true;
+}
+
+size_t PoolHilos::pendientes() const {
+    std::lock_guard<std::mutex> l(mtx);
+    return cola.size();
+}
+
+void PoolHilos::bucle() {
+    for (;;) {
+        std::function<void()> tarea;
+        {
+            std::unique_lock<std::mutex> l(mtx);
+            cv.wait(l, [this] { return detener || !cola.empty(); });
+            if (cola.empty()) return;
+            tarea = std::move(cola.front());
+            cola.pop_front();
+        }
+        tarea();
+    }
+}
+
+void PoolHilos::paraCada(size_t n, const std::function<void(size_t)>& tarea) {
+    if (n == 0) return;
+    // Los índices se reparten con un contador: el que termina antes toma el siguiente
+    struct Estado {
+        std::atomic<size_t> siguiente{0};
+        std::atomic<size_t> hechos{0};
+        std::mutex mtx;
+        std::condition_variable cv;
+    };
+    auto estado = std::make_shared<Estado>();
+    auto trabajar = [estado, n, &tarea] {
+        size_t i;
+        while ((i = estado->siguiente.fetch_add(1)) < n) {
+            tarea(i);
+            if (estado->hechos.fetch_add(1) + 1 == n) {
+                std::lock_guard<std::mutex> l(estado->mtx);
+                estado->cv.notify_all();
+            }
+        }
+    };
+    const size_t ayudantes = std::min<size_t>(hilos.size(), n - 1);
+    for (size_t k = 0; k < ayudantes; ++k) encolar(trabajar);
+    trabajar();
+    std::unique_lock<std::mutex> l(estado->mtx);
+    estado->cv.wait(l, [&] { return estado->hechos.load() == n; });
+}
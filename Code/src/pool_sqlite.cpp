@@ -0,0 +1,62 @@
+#include "pool_sqlite.h"
+
+PoolSqlite::PoolSqlite(std::string rutaDb, size_t cantidad, int busyTimeoutMs) : ruta(std::move(rutaDb)) {
+    if (cantidad == 0) cantidad = 1;
+    for (size_t i = 0; i < cantidad; ++i) {
+        auto c = std::make_unique<Conexion>();
+        // Cada conexión la usa un hilo por vez: no hace falta el mutex interno de SQLite
+        const int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX;
+        if (sqlite3_open_v2(ruta.c_str(), &c->db, flags, nullptr) != SQLITE_OK) {
+            error = c->db ? sqlite3_errmsg(c->db) : "sin memoria";
+            sqlite3_close(c->db);
+            break;
+        }
+        sqlite3_busy_timeout(c->db, busyTimeoutMs);
+        // journal_mode=WAL queda grabado en la base; synchronous es por conexión
+        char* err = nullptr;
+        if (sqlite3_exec(c->db, "PRAGMA journal_mode=WAL; PRAGMA synchronous=NORMAL;", nullptr, nullptr, &err) !=
+            SQLITE_OK) {
+            error = err ? err : "PRAGMA falló";
+            sqlite3_free(err);
+        }
+        libres.push_back(c.get());
+        conexiones.push_back(std::move(c));
+    }
+}
+
+PoolSqlite::~PoolSqlite() {
+    for (auto& c : conexiones) {
+        for (auto& [sql, st] : c->sentencias) sqlite3_finalize(st);
+        sqlite3_close(c->db);
+    }
+}
+
+PoolSqlite::Prestamo PoolSqlite::tomar() {
+    std::unique_lock<std::mutex> l(mtx);
+    if (conexiones.empty()) return Prestamo(this, nullptr);
+    cv.wait(l, [&] { return !libres.empty(); });
+    Conexion* c = libres.back();
+    libres.pop_back();
+    return Prestamo(this, c);
+}
+
+void PoolSqlite::devolver(Conexion* c) {
+    {
+        std::lock_guard<std::mutex> l(mtx);
+        libres.push_back(c);
+    }
+    cv.notify_one();
+}
+
+PoolSqlite::Sentencia PoolSqlite::Prestamo::sentencia(const std::string& sql) {
+    if (!c) return Sentencia();
+    auto it = c->sentencias.find(sql);
+    if (it != c->sentencias.end()) return Sentencia(it->second);
+    sqlite3_stmt* st = nullptr;
+    if (sqlite3_prepare_v3(c->db, sql.c_str(), -1, SQLITE_PREPARE_PERSISTENT, &st, nullptr) != SQLITE_OK) {
+        sqlite3_finalize(st);
+        return Sentencia();
+    }
+    c->sentencias.emplace(sql, st);
+    return Sentencia(st);
+}
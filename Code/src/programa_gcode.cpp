@@ -0,0 +1,396 @@
+#include "programa_gcode.h"
+#include "consola.h"
+#include "lector_mapeado.h"
+
+#include <cctype>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+
+CacheGcode cacheGcode; // definición de la instancia global
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr char kMagia[4] = {'G', 'I', 'R', '1'};
+constexpr uint32_t kVersionFormato = 2;
+constexpr char kLetrasCampo[NUM_CAMPOS] = {'X', 'Y', 'Z', 'E', 'F', 'S', 'I', 'J', 'R'};
+
+OpGcode opcodePara(char letra, uint16_t numero) {
+    if (letra == 'G') {
+        switch (numero) {
+            case 0:
+            case 1: return OpGcode::MOVER;
+            case 2: return OpGcode::ARCO_HORARIO;
+            case 3: return OpGcode::ARCO_ANTIHORARIO;
+            case 4: return OpGcode::PAUSA;
+            case 28: return OpGcode::HOME;
+            case 90: return OpGcode::ABSOLUTO;
+            case 91: return OpGcode::RELATIVO;
+            case 92: return OpGcode::OFFSET;
+        }
+    } else if (letra == 'M') {
+        switch (numero) {
+            case 1: return OpGcode::BOMBA_ON;
+            case 2: return OpGcode::BOMBA_OFF;
+            case 3: return OpGcode::GARRA_ON;
+            case 5: return OpGcode::GARRA_OFF;
+            case 6: return OpGcode::LASER_ON;
+            case 7: return OpGcode::LASER_OFF;
+            case 17: return OpGcode::MOTORES_ON;
+            case 18: return OpGcode::MOTORES_OFF;
+            case 106: return OpGcode::VENTILADOR_ON;
+            case 107: return OpGcode::VENTILADOR_OFF;
+            case 114: return OpGcode::POSICION;
+            case 119: return OpGcode::ENDSTOPS;
+        }
+    }
+    return OpGcode::DESCONOCIDO;
+}
+
+int indiceCampo(char letra) {
+    for (int i = 0; i < NUM_CAMPOS; ++i) {
+        if (kLetrasCampo[i] == letra) return i;
+    }
+    return -1;
+}
+
+// Normaliza como Command::processMessage: mayúsculas y sin espacios.
+// Además descarta comentarios ';' y '( ... )' que el firmware no entiende.
+std::string normalizar(std::string_view linea) {
+    std::string out;
+    out.reserve(linea.size());
+    int parentesis = 0;
+    for (char c : linea) {
+        if (c == ';') break;
+        if (c == '(') { ++parentesis; continue; }
+        if (c == ')') { if (parentesis > 0) --parentesis; continue; }
+        if (parentesis > 0) continue;
+        if (std::isspace(static_cast<unsigned char>(c))) continue;
+        out.push_back(static_cast<char>(std::toupper(static_cast<unsigned char>(c))));
+    }
+    return out;
+}
+
+bool parsearFloat(const char* begin, const char* end, float& out) {
+    if (begin == end) return false;
+    if (*begin == '+') ++begin;
+    auto res = std::from_chars(begin, end, out);
+    return res.ec == std::errc() && res.ptr == end;
+}
+
+template <typename T>
+void escribirPod(std::ostream& out, const T& v) {
+    out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+template <typename T>
+bool leerPod(std::istream& in, T& v) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&v), sizeof(T)));
+}
+}
+
+namespace gcode {
+
+uint64_t hashContenido(std::string_view texto, uint64_t semilla) {
+    uint64_t h = semilla;
+    for (unsigned char c : texto) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+std::string hashHex(uint64_t hash) {
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(hash));
+    return buf;
+}
+
+bool compilarLinea(std::string_view linea, uint32_t numeroLinea, InstruccionGcode& out) {
+    const std::string msg = normalizar(linea);
+    if (msg.empty()) return false;
+
+    InstruccionGcode ins;
+    ins.linea = numeroLinea;
+    ins.letra = msg[0];
+    if (ins.letra != 'G' && ins.letra != 'M') {
+        ins.validez = ValidezGcode::SINTAXIS;
+        out = ins;
+        return true;
+    }
+
+    // Número de comando: dígitos hasta la primera letra
+    size_t i = 1;
+    while (i < msg.size() && !std::isalpha(static_cast<unsigned char>(msg[i]))) ++i;
+    unsigned numero = 0;
+    auto res = std::from_chars(msg.data() + 1, msg.data() + i, numero);
+    if (i == 1 || res.ec != std::errc() || res.ptr != msg.data() + i || numero > 0xFFFF) {
+        ins.validez = ValidezGcode::SINTAXIS;
+        out = ins;
+        return true;
+    }
+    ins.numero = static_cast<uint16_t>(numero);
+    ins.op = opcodePara(ins.letra, ins.numero);
+    if (ins.op == OpGcode::DESCONOCIDO) {
+        ins.validez = ValidezGcode::NO_SOPORTADA;
+    }
+
+    // Segmentos <letra><valor>
+    while (i < msg.size()) {
+        char letra = msg[i];
+        size_t j = i + 1;
+        while (j < msg.size() && !std::isalpha(static_cast<unsigned char>(msg[j]))) ++j;
+        float v = 0.0f;
+        if (!parsearFloat(msg.data() + i + 1, msg.data() + j, v)) {
+            ins.validez = ValidezGcode::SINTAXIS;
+        } else {
+            int campo = indiceCampo(letra);
+            if (campo < 0) {
+                if (ins.validez == ValidezGcode::VALIDA) ins.validez = ValidezGcode::NO_SOPORTADA;
+            } else {
+                ins.fijar(static_cast<CampoGcode>(campo), v);
+            }
+        }
+        i = j;
+    }
+
+    // I/J/R sólo tienen sentido en arcos; el firmware no los conoce
+    const uint16_t camposArco = (1u << CAMPO_I) | (1u << CAMPO_J) | (1u << CAMPO_R);
+    if (ins.validez == ValidezGcode::VALIDA) {
+        if (!ins.esArco()) {
+            if (ins.campos & camposArco) ins.validez = ValidezGcode::NO_SOPORTADA;
+        } else {
+            const bool centro = ins.tiene(CAMPO_I) || ins.tiene(CAMPO_J);
+            if (centro == ins.tiene(CAMPO_R)) ins.validez = ValidezGcode::SINTAXIS;
+        }
+    }
+    out = ins;
+    return true;
+}
+
+ProgramaGcode compilar(std::string_view texto) {
+    ProgramaGcode programa;
+    programa.hash = hashContenido(texto);
+    uint32_t numero = 0;
+    size_t pos = 0;
+    while (pos < texto.size()) {
+        size_t fin = texto.find('\n', pos);
+        if (fin == std::string_view::npos) fin = texto.size();
+        ++numero;
+        InstruccionGcode ins;
+        if (compilarLinea(texto.substr(pos, fin - pos), numero, ins)) {
+            if (!ins.valida()) ++programa.invalidas;
+            programa.instrucciones.push_back(ins);
+        }
+        pos = fin + 1;
+    }
+    programa.lineasFuente = numero;
+    return programa;
+}
+
+std::string aTexto(const InstruccionGcode& ins) {
+    std::string out;
+    out.reserve(48);
+    out.push_back(ins.letra);
+    out += std::to_string(ins.numero);
+    char buf[32];
+    for (int c = 0; c < NUM_CAMPOS; ++c) {
+        if (!ins.tiene(static_cast<CampoGcode>(c))) continue;
+        auto res = std::to_chars(buf, buf + sizeof(buf), ins.valores[c]);
+        out.push_back(' ');
+        out.push_back(kLetrasCampo[c]);
+        out.append(buf, res.ptr);
+    }
+    return out;
+}
+
+bool escribirTexto(const ProgramaGcode& programa, const std::string& ruta) {
+    const std::string tmp = ruta + ".tmp";
+    std::ofstream out(tmp, std::ios::out | std::ios::trunc);
+    if (!out) return false;
+    for (const auto& ins : programa.instrucciones) {
+        out << aTexto(ins) << '\n';
+    }
+    out.close();
+    std::error_code ec;
+    if (!out) {
+        fs::remove(tmp, ec);
+        return false;
+    }
+    fs::rename(tmp, ruta, ec);
+    return !ec;
+}
+
+const char* describirValidez(ValidezGcode v) {
+    switch (v) {
+        case ValidezGcode::VALIDA: return "valida";
+        case ValidezGcode::NO_SOPORTADA: return "no soportada por el firmware";
+        case ValidezGcode::SINTAXIS: return "error de sintaxis";
+    }
+    return "desconocida";
+}
+
+bool serializar(const ProgramaGcode& programa, std::ostream& out) {
+    out.write(kMagia, sizeof(kMagia));
+    escribirPod(out, kVersionFormato);
+    escribirPod(out, programa.hash);
+    escribirPod(out, programa.lineasFuente);
+    escribirPod(out, programa.invalidas);
+    uint32_t n = static_cast<uint32_t>(programa.instrucciones.size());
+    escribirPod(out, n);
+    for (const auto& ins : programa.instrucciones) {
+        escribirPod(out, static_cast<uint8_t>(ins.op));
+        escribirPod(out, static_cast<uint8_t>(ins.validez));
+        escribirPod(out, ins.letra);
+        escribirPod(out, ins.numero);
+        escribirPod(out, ins.campos);
+        escribirPod(out, ins.linea);
+        for (int c = 0; c < NUM_CAMPOS; ++c) {
+            if (ins.tiene(static_cast<CampoGcode>(c))) escribirPod(out, ins.valores[c]);
+        }
+    }
+    return static_cast<bool>(out);
+}
+
+bool deserializar(std::istream& in, ProgramaGcode& programa) {
+    char magia[sizeof(kMagia)];
+    uint32_t version = 0, n = 0;
+    if (!in.read(magia, sizeof(magia)) || std::memcmp(magia, kMagia, sizeof(kMagia)) != 0) return false;
+    if (!leerPod(in, version) || version != kVersionFormato) return false;
+    ProgramaGcode p;
+    if (!leerPod(in, p.hash) || !leerPod(in, p.lineasFuente) || !leerPod(in, p.invalidas) || !leerPod(in, n)) {
+        return false;
+    }
+    p.instrucciones.reserve(n);
+    for (uint32_t k = 0; k < n; ++k) {
+        InstruccionGcode ins;
+        uint8_t op = 0, validez = 0;
+        if (!leerPod(in, op) || !leerPod(in, validez) || !leerPod(in, ins.letra) ||
+            !leerPod(in, ins.numero) || !leerPod(in, ins.campos) || !leerPod(in, ins.linea)) {
+            return false;
+        }
+        ins.op = static_cast<OpGcode>(op);
+        ins.validez = static_cast<ValidezGcode>(validez);
+        for (int c = 0; c < NUM_CAMPOS; ++c) {
+            if (ins.tiene(static_cast<CampoGcode>(c)) && !leerPod(in, ins.valores[c])) return false;
+        }
+        p.instrucciones.push_back(ins);
+    }
+    programa = std::move(p);
+    return true;
+}
+
+} // namespace gcode
+
+CacheGcode::CacheGcode(std::string dir) : directorio(std::move(dir)) {}
+
+std::string CacheGcode::rutaBinaria(uint64_t hash) const {
+    return (fs::path(directorio) / (gcode::hashHex(hash) + ".gir")).string();
+}
+
+std::shared_ptr<const ProgramaGcode> CacheGcode::buscar(uint64_t hash) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = programas.find(hash);
+        if (it != programas.end()) return it->second;
+    }
+    std::ifstream in(rutaBinaria(hash), std::ios::binary);
+    if (!in) return nullptr;
+    auto programa = std::make_shared<ProgramaGcode>();
+    if (!gcode::deserializar(in, *programa) || programa->hash != hash) {
+        CONSOLA_AVISO("⚠️ IR en caché corrupto, se recompila: " << rutaBinaria(hash));
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(mtx);
+    programas[hash] = programa;
+    return programa;
+}
+
+void CacheGcode::guardar(std::shared_ptr<const ProgramaGcode> programa) {
+    if (!programa) return;
+    std::error_code ec;
+    fs::create_directories(directorio, ec);
+    const std::string destino = rutaBinaria(programa->hash);
+    const std::string tmp = destino + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (out && gcode::serializar(*programa, out)) {
+            out.close();
+            fs::rename(tmp, destino, ec);
+        } else {
+            fs::remove(tmp, ec);
+        }
+    }
+    std::lock_guard<std::mutex> lock(mtx);
+    programas[programa->hash] = std::move(programa);
+}
+
+bool CacheGcode::firmaActual(const std::string& ruta, uint64_t& tamano, int64_t& modificado) {
+    struct stat st;
+    if (stat(ruta.c_str(), &st) != 0) return false;
+    tamano = static_cast<uint64_t>(st.st_size);
+    modificado = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+    return true;
+}
+
+void CacheGcode::registrarArchivo(const std::string& ruta, uint64_t hash) {
+    uint64_t tamano = 0;
+    int64_t modificado = 0;
+    if (!firmaActual(ruta, tamano, modificado)) return;
+    std::lock_guard<std::mutex> lock(mtx);
+    indiceArchivos[ruta] = FirmaArchivo{tamano, modificado, hash};
+}
+
+std::shared_ptr<const ProgramaGcode> CacheGcode::buscarPorArchivo(const std::string& ruta) {
+    uint64_t tamano = 0;
+    int64_t modificado = 0;
+    if (!firmaActual(ruta, tamano, modificado)) return nullptr;
+    uint64_t hash = 0;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = indiceArchivos.find(ruta);
+        if (it == indiceArchivos.end() || it->second.tamano != tamano ||
+            it->second.modificado != modificado) {
+            return nullptr;
+        }
+        hash = it->second.hash;
+    }
+    return buscar(hash);
+}
+
+std::shared_ptr<const ProgramaGcode> CacheGcode::obtener(const std::string& ruta) {
+    if (auto programa = buscarPorArchivo(ruta)) return programa;
+
+    LectorMapeado lector(ruta);
+    if (!lector.abierto()) return nullptr;
+    const std::string_view texto = lector.contenido();
+
+    const uint64_t hash = gcode::hashContenido(texto);
+    if (auto programa = buscar(hash)) {
+        CONSOLA_INFO("⚡ IR en caché para " << ruta << " (" << gcode::hashHex(hash) << ")");
+        registrarArchivo(ruta, hash);
+        return programa;
+    }
+    auto programa = std::make_shared<ProgramaGcode>(gcode::compilar(texto));
+    CONSOLA_INFO("🧩 Compilado " << ruta << ": " << programa->instrucciones.size()
+                 << " instrucciones, " << programa->invalidas << " inválidas");
+    guardar(programa);
+    registrarArchivo(ruta, hash);
+    std::function<void(const ProgramaGcode&)> aviso;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        aviso = avisoCompilado;
+    }
+    if (aviso) aviso(*programa);
+    return programa;
+}
+
+void CacheGcode::alCompilar(std::function<void(const ProgramaGcode&)> fn) {
+    std::lock_guard<std::mutex> lock(mtx);
+    avisoCompilado = std::move(fn);
+}
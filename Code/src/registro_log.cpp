@@ -0,0 +1,267 @@
+#include "registro_log.h"
+#include "varint.h"
+#include "json.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+#include <unistd.h>
+#include <zlib.h>
+
+namespace {
+constexpr char kMagia[4] = {'B', 'L', 'G', '1'};
+
+void campoCsv(std::string& out, const std::string& s) {
+    out += '"';
+    for (char c : s) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    out += '"';
+}
+}
+
+namespace registro_log {
+
+std::string cabecera(int64_t msBase) {
+    std::string out(kMagia, sizeof(kMagia));
+    escribirVarint(out, static_cast<uint64_t>(msBase));
+    return out;
+}
+
+uint32_t Codificador::id(const std::string& s, std::string& out) {
+    auto it = tabla.find(s);
+    if (it != tabla.end()) return it->second;
+    const uint32_t nuevo = static_cast<uint32_t>(tabla.size());
+    tabla.emplace(s, nuevo);
+    out.push_back(static_cast<char>(kCadena));
+    escribirVarint(out, nuevo);
+    escribirVarint(out, s.size());
+    out += s;
+    return nuevo;
+}
+
+void Codificador::deshacer(const Marca& m) {
+    // Los ids son consecutivos: los >= m.cadenas son los del lote perdido
+    for (auto it = tabla.begin(); it != tabla.end();) {
+        if (it->second >= m.cadenas) it = tabla.erase(it);
+        else ++it;
+    }
+    ultimoMs = m.ultimoMs;
+}
+
+void Codificador::codificar(const RegistroLog& r, std::string& out) {
+    // Las altas de cadenas van antes del registro que las usa
+    uint32_t ids[3];
+    if (r.categoria == RegistroLog::PETICION) {
+        ids[0] = id(r.detalle, out);
+        ids[1] = id(r.usuario, out);
+        ids[2] = id(r.nodo, out);
+    } else {
+        ids[0] = id(r.modulo, out);
+        ids[1] = id(r.usuario, out);
+    }
+    out.push_back(static_cast<char>(r.categoria));
+    escribirVarint(out, zigzag(r.ms - ultimoMs));
+    ultimoMs = r.ms;
+    if (r.categoria == RegistroLog::PETICION) {
+        for (uint32_t i : ids) escribirVarint(out, i);
+        escribirVarint(out, static_cast<uint64_t>(r.codigo < 0 ? 0 : r.codigo));
+    } else {
+        escribirVarint(out, ids[0]);
+        escribirVarint(out, ids[1]);
+        escribirVarint(out, r.mensaje.size());
+        out += r.mensaje;
+    }
+}
+
+bool Lector::cabecera(int64_t* msBase) {
+    if (datos.size() < sizeof(kMagia) || std::memcmp(datos.data(), kMagia, sizeof(kMagia)) != 0) return false;
+    size_t p = sizeof(kMagia);
+    uint64_t base = 0;
+    if (!leerVarint(datos, p, base)) return false;
+    pos = p;
+    ms = static_cast<int64_t>(base);
+    if (msBase) *msBase = ms;
+    return true;
+}
+
+bool Lector::siguiente(RegistroCrudo& r) {
+    size_t p = pos;
+    while (p < datos.size()) {
+        const uint8_t tipo = static_cast<uint8_t>(datos[p++]);
+        uint64_t a = 0, b = 0, c = 0, d = 0;
+        if (tipo == kCadena) {
+            if (!leerVarint(datos, p, a) || !leerVarint(datos, p, b) || b > datos.size() - p) return false;
+            if (a == tabla->size()) {
+                tabla->emplace_back(datos.substr(p, b));
+            } else if (a > tabla->size()) {
+                return false;   // segmento dañado
+            }
+            p += b;
+            pos = p;            // las altas se consumen aunque el registro siguiente esté cortado
+            continue;
+        }
+        if (tipo != RegistroLog::PETICION && tipo != RegistroLog::EVENTO) return false;
+        uint64_t dt = 0;
+        if (!leerVarint(datos, p, dt) || !leerVarint(datos, p, a) || !leerVarint(datos, p, b) ||
+            !leerVarint(datos, p, c)) {
+            return false;
+        }
+        const size_t cadenas = tabla->size();
+        r.categoria = static_cast<RegistroLog::Categoria>(tipo);
+        if (tipo == RegistroLog::PETICION) {
+            if (!leerVarint(datos, p, d) || a >= cadenas || b >= cadenas || c >= cadenas) return false;
+            r.detalle = static_cast<uint32_t>(a);
+            r.usuario = static_cast<uint32_t>(b);
+            r.nodo = static_cast<uint32_t>(c);
+            r.modulo = RegistroCrudo::kSinId;
+            r.codigo = static_cast<int>(d);
+            r.mensaje = {};
+        } else {
+            if (a >= cadenas || b >= cadenas || c > datos.size() - p) return false;
+            r.modulo = static_cast<uint32_t>(a);
+            r.usuario = static_cast<uint32_t>(b);
+            r.detalle = r.nodo = RegistroCrudo::kSinId;
+            r.codigo = 0;
+            r.mensaje = datos.substr(p, c);
+            p += c;
+        }
+        ms += desZigzag(dt);
+        r.ms = ms;
+        pos = p;
+        return true;
+    }
+    return false;
+}
+
+void Lector::materializar(const RegistroCrudo& c, RegistroLog& r) const {
+    static const std::string vacia;
+    auto cadena = [&](uint32_t id) -> const std::string& { return id < tabla->size() ? (*tabla)[id] : vacia; };
+    r.categoria = c.categoria;
+    r.ms = c.ms;
+    r.detalle = cadena(c.detalle);
+    r.usuario = cadena(c.usuario);
+    r.nodo = cadena(c.nodo);
+    r.codigo = c.codigo;
+    r.modulo = cadena(c.modulo);
+    r.mensaje.assign(c.mensaje);
+}
+
+bool recorrer(std::string_view datos, const std::function<bool(const RegistroLog&)>& visitar, int64_t* msBase) {
+    std::vector<std::string> tabla;
+    Lector lector(datos, tabla);
+    if (!lector.cabecera(msBase)) return false;
+    RegistroCrudo c;
+    RegistroLog r;
+    while (lector.siguiente(c)) {
+        lector.materializar(c, r);
+        if (!visitar(r)) break;
+    }
+    return true;
+}
+
+bool cargarSegmento(const std::string& ruta, std::string& datos) {
+    // gzread lee igual un archivo sin comprimir
+    gzFile f = gzopen(ruta.c_str(), "rb");
+    if (!f) return false;
+    gzbuffer(f, 128 * 1024);
+    datos.clear();
+    char buf[64 * 1024];
+    int n;
+    while ((n = gzread(f, buf, sizeof(buf))) > 0) datos.append(buf, static_cast<size_t>(n));
+    gzclose(f);
+    return n == 0 || !datos.empty();
+}
+
+bool leerSegmento(const std::string& ruta, const std::function<bool(const RegistroLog&)>& visitar, int64_t* msBase) {
+    std::string datos;
+    if (!cargarSegmento(ruta, datos)) return false;
+    return recorrer(datos, visitar, msBase);
+}
+
+std::string formatoIso(int64_t ms) {
+    const time_t t = static_cast<time_t>(ms / 1000);
+    std::tm tm;
+    localtime_r(&t, &tm);
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+    return buf;
+}
+
+std::string cabeceraCsv() {
+    return "timestamp,category,detail,user,node,response_code,module,message\n";
+}
+
+std::string aCsv(const RegistroLog& r) {
+    std::string out;
+    out.reserve(96 + r.detalle.size() + r.mensaje.size());
+    campoCsv(out, formatoIso(r.ms));
+    if (r.categoria == RegistroLog::PETICION) {
+        out += ",\"request\",";
+        campoCsv(out, r.detalle);
+        out += ',';
+        campoCsv(out, r.usuario);
+        out += ',';
+        campoCsv(out, r.nodo);
+        out += ',' + std::to_string(r.codigo) + ",,\n";
+    } else {
+        out += ",\"event\",,";
+        if (!r.usuario.empty()) campoCsv(out, r.usuario);
+        out += ",,,";
+        campoCsv(out, r.modulo);
+        out += ',';
+        campoCsv(out, r.mensaje);
+        out += '\n';
+    }
+    return out;
+}
+
+std::string aJson(const RegistroLog& r) {
+    nlohmann::json j = {
+        {"timestamp", formatoIso(r.ms)},
+        {"ms", r.ms},
+        {"category", r.categoria == RegistroLog::PETICION ? "request" : "event"},
+        {"user", r.usuario}
+    };
+    if (r.categoria == RegistroLog::PETICION) {
+        j["detail"] = r.detalle;
+        j["node"] = r.nodo;
+        j["response_code"] = r.codigo;
+    } else {
+        j["module"] = r.modulo;
+        j["message"] = r.mensaje;
+    }
+    return j.dump();
+}
+
+bool comprimir(const std::string& origen) {
+    FILE* in = std::fopen(origen.c_str(), "rb");
+    if (!in) return false;
+    const std::string destino = origen + ".gz";
+    const std::string tmp = destino + ".tmp";
+    gzFile out = gzopen(tmp.c_str(), "wb6");
+    if (!out) {
+        std::fclose(in);
+        return false;
+    }
+    char buf[64 * 1024];
+    size_t n;
+    bool ok = true;
+    while (ok && (n = std::fread(buf, 1, sizeof(buf), in)) > 0) {
+        ok = gzwrite(out, buf, static_cast<unsigned>(n)) == static_cast<int>(n);
+    }
+    ok = !std::ferror(in) && ok;
+    std::fclose(in);
+    ok = (gzclose(out) == Z_OK) && ok;
+    if (!ok || std::rename(tmp.c_str(), destino.c_str()) != 0) {
+        ::unlink(tmp.c_str());
+        return false;
+    }
+    ::unlink(origen.c_str());
+    return true;
+}
+
+} // namespace registro_log
@@ -0,0 +1,87 @@
+#include "respuesta_firmware.h"
+
+#include <charconv>
+#include <cmath>
+
+namespace {
+constexpr std::string_view kPrefijoInfo = "INFO: ";
+constexpr std::string_view kPrefijoError = "ERROR: ";
+constexpr char kEjes[4] = {'X', 'Y', 'Z', 'E'};
+
+bool empiezaCon(std::string_view s, std::string_view prefijo) {
+    return s.substr(0, prefijo.size()) == prefijo;
+}
+
+std::string_view recortar(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t' || s.front() == '\r')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) s.remove_suffix(1);
+    return s;
+}
+
+// "[X:1.00 Y:170.00 Z:120.00 E:0.00]" tal como lo arma String(float) en
+// el Arduino. Devuelve false si falta algún eje o el valor no es numérico
+// (String(float) imprime "nan" u "ovf" en esos casos).
+bool parsearPosicion(std::string_view s, float out[4]) {
+    size_t desde = s.find('[');
+    if (desde == std::string_view::npos) return false;
+    for (int e = 0; e < 4; ++e) {
+        const char etiqueta[2] = {kEjes[e], ':'};
+        size_t p = s.find(std::string_view(etiqueta, 2), desde);
+        if (p == std::string_view::npos) return false;
+        p += 2;
+        size_t fin = p;
+        while (fin < s.size() && s[fin] != ' ' && s[fin] != ']') ++fin;
+        auto res = std::from_chars(s.data() + p, s.data() + fin, out[e]);
+        if (res.ec != std::errc() || res.ptr != s.data() + fin || !std::isfinite(out[e])) return false;
+        desde = fin;
+    }
+    return true;
+}
+
+void interpretarInfo(std::string_view msg, RespuestaFirmware& r) {
+    if (empiezaCon(msg, "CURRENT POSITION:")) {
+        r.tienePosicion = parsearPosicion(msg, r.posicion);
+    } else if (empiezaCon(msg, "LINEAR MOVE:")) {
+        r.tieneObjetivo = parsearPosicion(msg, r.objetivo);
+    } else if (msg == "HOMING COMPLETE") {
+        r.homing = true;
+    } else if (empiezaCon(msg, "ABSOLUTE MODE")) {   // M114 y "ABSOLUTE MODE ON" de G90
+        r.modoAbs = 1;
+    } else if (empiezaCon(msg, "RELATIVE MODE")) {
+        r.modoAbs = 0;
+    } else if (msg == "MOTORS ENABLED") {
+        r.motores = 1;
+    } else if (msg == "MOTORS DISABLED") {
+        r.motores = 0;
+    } else if (msg == "GRIPPER ON") {
+        r.garra = 1;
+    } else if (msg == "GRIPPER OFF") {
+        r.garra = 0;
+    }
+}
+}
+
+namespace firmware {
+
+RespuestaFirmware interpretar(std::string_view texto) {
+    RespuestaFirmware r;
+    size_t pos = 0;
+    while (pos <= texto.size()) {
+        size_t fin = texto.find('\n', pos);
+        if (fin == std::string_view::npos) fin = texto.size();
+        std::string_view linea = recortar(texto.substr(pos, fin - pos));
+        pos = fin + 1;
+
+        if (empiezaCon(linea, kPrefijoInfo)) {
+            interpretarInfo(linea.substr(kPrefijoInfo.size()), r);
+        } else if (empiezaCon(linea, kPrefijoError)) {
+            r.error = true;
+            if (linea.substr(kPrefijoError.size()) == "POINT IS OUTSIDE OF WORKSPACE") r.fueraDeEspacio = true;
+        } else if (linea == "OK" || linea == "ok") {
+            r.ok = true;
+        }
+    }
+    return r;
+}
+
+} // namespace firmware
@@ -1,8 +1,23 @@
 #include "robot_controller_simple.h"
+#include "lector_mapeado.h"
+#include "modelo_brazo.h"
+#include "respuesta_firmware.h"
+#include "diario_estado.h"
+#include "consola.h"
+
+#include <chrono>
+#include <iomanip>
+
+namespace {
+// Por encima de este tamaño el archivo sólo se ejecuta en streaming
+constexpr size_t kMaxBytesIrEnCache = 16u << 20;
+// Respuesta de ComunicacionControladorSimple cuando no hay puerto abierto
+constexpr const char* kRespuestaSimulada = "SIM:OK";
+}
 
 void RobotControllerSimple::mover(float x, float y, float z, float f, bool abs) {
-    std::cout << "🎯 MOVER - X:" << x << " Y:" << y << " Z:" << z 
-              << " F:" << f << " ABS:" << abs << std::endl;
+    CONSOLA_DEBUG("🎯 MOVER - X:" << x << " Y:" << y << " Z:" << z
+                  << " F:" << f << " ABS:" << abs);
     
     // Convertir a absoluto si está en modo relativo
     if (!abs) {
@@ -10,12 +25,10 @@ void RobotControllerSimple::mover(float x, float y, float z, float f, bool abs)
         x += s.x; 
         y += s.y; 
         z += s.z;
-        std::cout << "🔄 Convertido a absoluto - X:" << x << " Y:" << y << " Z:" << z << std::endl;
+        CONSOLA_DEBUG("🔄 Convertido a absoluto - X:" << x << " Y:" << y << " Z:" << z);
     }
     
-    // Actualizar estado
-    estado.setPos(x, y, z);
-    
+    // La posición se actualiza con lo que responda el firmware
     // Generar comando G-code
     std::ostringstream cmd;
     cmd << "G1 X" << x << " Y" << y << " Z" << z << " F" << f;
@@ -25,7 +38,7 @@ void RobotControllerSimple::mover(float x, float y, float z, float f, bool abs)
 }
 
 void RobotControllerSimple::setAbs(bool abs) {
-    std::cout << "🎛️ MODO: " << (abs ? "ABSOLUTO" : "RELATIVO") << std::endl;
+    CONSOLA_DEBUG("🎛️ MODO: " << (abs ? "ABSOLUTO" : "RELATIVO"));
     estado.setModo(abs);
     ejecutarComando(abs ? "G90" : "G91");
     registrarAprendizaje(abs ? "G90" : "G91");
@@ -34,12 +47,12 @@ void RobotControllerSimple::setAbs(bool abs) {
 void RobotControllerSimple::setMotores(bool on) {
     auto estado_actual = estado.leer();
     if (estado_actual.motores == on) {
-        std::cout << "⚙️ MOTORES: solicitud ignorada, estado ya es "
-                  << (on ? "ENCENDIDOS" : "APAGADOS") << std::endl;
+        CONSOLA_DEBUG("⚙️ MOTORES: solicitud ignorada, estado ya es "
+                      << (on ? "ENCENDIDOS" : "APAGADOS"));
         return;
     }
-    std::cout << "⚙️ MOTORES: " << (estado_actual.motores ? "ENCENDIDOS" : "APAGADOS")
-              << " -> " << (on ? "ENCENDER" : "APAGAR") << std::endl;
+    CONSOLA_DEBUG("⚙️ MOTORES: " << (estado_actual.motores ? "ENCENDIDOS" : "APAGADOS")
+                  << " -> " << (on ? "ENCENDER" : "APAGAR"));
     
     estado.setMotores(on);
     const char* comando = on ? "M17" : "M18";
@@ -47,19 +60,19 @@ void RobotControllerSimple::setMotores(bool on) {
     registrarAprendizaje(comando);
 
     auto nuevo_estado = estado.leer();
-    std::cout << "✅ MOTORES: " << (nuevo_estado.motores ? "ENCENDIDOS" : "APAGADOS") << std::endl;
+    CONSOLA_INFO("✅ MOTORES: " << (nuevo_estado.motores ? "ENCENDIDOS" : "APAGADOS"));
 }
 
 void RobotControllerSimple::setGarra(bool on) {
     auto estado_actual = estado.leer();
     if (estado_actual.garra == on) {
-        std::cout << "🦾 GARRA: solicitud ignorada, estado ya es "
-                  << (on ? "ACTIVADA" : "DESACTIVADA") << std::endl;
+        CONSOLA_DEBUG("🦾 GARRA: solicitud ignorada, estado ya es "
+                      << (on ? "ACTIVADA" : "DESACTIVADA"));
         return;
     }
 
-    std::cout << "🦾 GARRA: " << (estado_actual.garra ? "ACTIVADA" : "DESACTIVADA")
-              << " -> " << (on ? "ACTIVAR" : "DESACTIVAR") << std::endl;
+    CONSOLA_DEBUG("🦾 GARRA: " << (estado_actual.garra ? "ACTIVADA" : "DESACTIVADA")
+                  << " -> " << (on ? "ACTIVAR" : "DESACTIVAR"));
 
     estado.setGarra(on);
     const char* comando = on ? "M3" : "M5";
@@ -67,70 +80,313 @@ void RobotControllerSimple::setGarra(bool on) {
     registrarAprendizaje(comando);
 
     auto nuevo_estado = estado.leer();
-    std::cout << "✅ GARRA: " << (nuevo_estado.garra ? "ACTIVADA" : "DESACTIVADA") << std::endl;
+    CONSOLA_INFO("✅ GARRA: " << (nuevo_estado.garra ? "ACTIVADA" : "DESACTIVADA"));
 }
 
 void RobotControllerSimple::emergencia() {
-    std::cout << "🛑 EMERGENCIA ACTIVADA" << std::endl;
+    CONSOLA_AVISO("🛑 EMERGENCIA ACTIVADA");
     estado.setEmergencia(true);
     ejecutarComando("M112");
     registrarAprendizaje("M112");
 }
 
 void RobotControllerSimple::resetEmergencia() {
-    std::cout << "🔄 RESET EMERGENCIA" << std::endl;
+    CONSOLA_INFO("🔄 RESET EMERGENCIA");
     estado.setEmergencia(false);
     // No enviamos comando, solo reset estado interno
 }
 
 void RobotControllerSimple::ejecutarArchivo(const std::string& ruta) {
-    std::cout << "📁 EJECUTANDO ARCHIVO: " << ruta << std::endl;
-    // Implementación simple - puedes expandir esto
-    std::ifstream file(ruta);
-    std::string line;
-    while (std::getline(file, line)) {
-        if (!line.empty()) {
-            ejecutarComando(line);
-            registrarAprendizaje(line);
+    CONSOLA_INFO("📁 EJECUTANDO ARCHIVO: " << ruta);
+    // El IR se compila una sola vez por contenido; re-ejecuciones no re-parsean
+    if (auto programa = cacheGcode.buscarPorArchivo(ruta)) {
+        diarioEstado.inicioTrabajo(ruta, programa->hash);
+        ejecutarPrograma(*programa);
+        diarioEstado.finTrabajo();
+        return;
+    }
+
+    // Primera ejecución: se recorre el archivo mapeado línea a línea y cada
+    // instrucción se envía apenas se compila, así el arranque no depende del
+    // tamaño del archivo. El IR sólo se conserva si el archivo es chico.
+    LectorMapeado lector(ruta);
+    if (!lector.abierto()) {
+        CONSOLA_ERROR("❌ No se pudo leer el archivo: " << ruta);
+        return;
+    }
+    std::shared_ptr<ProgramaGcode> programa;
+    if (lector.tamano() <= kMaxBytesIrEnCache) {
+        // Sólo los chicos tienen IR en caché: para ellos vale hashear antes.
+        // Encuentra el .gir tras un reinicio o con el mismo contenido en otra ruta.
+        const uint64_t hashArchivo = gcode::hashContenido(lector.contenido());
+        if (auto enCache = cacheGcode.buscar(hashArchivo)) {
+            cacheGcode.registrarArchivo(ruta, hashArchivo);
+            diarioEstado.inicioTrabajo(ruta, hashArchivo);
+            ejecutarPrograma(*enCache);
+            diarioEstado.finTrabajo();
+            return;
+        }
+        programa = std::make_shared<ProgramaGcode>();
+    }
+    // En streaming el hash recién se conoce al final; el diario guarda la ruta
+    diarioEstado.inicioTrabajo(ruta, 0);
+    uint64_t hash = gcode::kSemillaHash;
+    size_t hashHasta = 0;
+    uint32_t numero = 0;
+    std::string_view linea;
+    while (lector.siguienteLinea(linea)) {
+        ++numero;
+        hash = gcode::hashContenido(lector.contenido().substr(hashHasta, lector.posicion() - hashHasta), hash);
+        hashHasta = lector.posicion();
+        InstruccionGcode ins;
+        if (!gcode::compilarLinea(linea, numero, ins)) continue;
+        ejecutarInstruccion(ins);
+        if (programa) {
+            if (!ins.valida()) ++programa->invalidas;
+            programa->instrucciones.push_back(ins);
         }
     }
+    diarioEstado.finTrabajo();
+    if (programa) {
+        programa->hash = hash;
+        programa->lineasFuente = numero;
+        cacheGcode.guardar(programa);
+        cacheGcode.registrarArchivo(ruta, hash);
+    }
 }
-void RobotControllerSimple::procesarRespuestaArduino(const std::string& respuesta) {
-    // Convertir a minúsculas para comparación case-insensitive
+
+void RobotControllerSimple::ejecutarPrograma(const ProgramaGcode& programa) {
+    for (const auto& ins : programa.instrucciones) {
+        ejecutarInstruccion(ins);
+    }
+}
+
+void RobotControllerSimple::ejecutarInstruccion(const InstruccionGcode& ins) {
+    if (!ins.valida()) {
+        CONSOLA_AVISO("⚠️ Línea " << ins.linea << " omitida: "
+                      << gcode::describirValidez(ins.validez));
+        return;
+    }
+    const std::string line = gcode::aTexto(ins);
+    if (ins.esArco()) {
+        if (!ejecutarArco(ins)) return;
+    } else {
+        modal.avanzar(ins);
+        enviar(line);
+    }
+    diarioEstado.progresoTrabajo(ins.linea);
+    registrarAprendizaje(line);
+}
+
+bool RobotControllerSimple::ejecutarArco(const InstruccionGcode& arco) {
+    // Los G1 se generan al vuelo, sólo para este arco; nunca llegan a disco
+    ResultadoArco r = gcode::segmentarArco(arco, modal.pos, modal.offset, modal.relativo,
+                                           opcionesArco, segmentosArco);
+    if (r != ResultadoArco::OK) {
+        CONSOLA_AVISO("⚠️ Línea " << arco.linea << " omitida: " << gcode::describirResultado(r));
+        return false;
+    }
+    CONSOLA_DEBUG("🌀 Arco línea " << arco.linea << ": " << segmentosArco.size() << " segmentos");
+    for (const auto& g1 : segmentosArco) {
+        modal.avanzar(g1);
+        enviar(gcode::aTexto(g1));
+    }
+    return true;
+}
+
+bool RobotControllerSimple::procesarRespuestaArduino(const std::string& cmd, const std::string& respuesta) {
+    if (respuesta == kRespuestaSimulada) {
+        CONSOLA_TRAZA("🔵 Simulación: Comando aceptado");
+        // Sin brazo que informe, la posición es la que sigue el host
+        estado.setPos(modal.pos[0] - modal.offset[0], modal.pos[1] - modal.offset[1],
+                      modal.pos[2] - modal.offset[2], modal.pos[3] - modal.offset[3]);
+        estado.setModo(!modal.relativo);
+        return false;
+    }
+    if (respuesta.empty() || respuesta == "TIMEOUT") {
+        CONSOLA_AVISO("⚠️  Arduino no respondió (timeout)");
+        return false;
+    }
+
+    const RespuestaFirmware r = firmware::interpretar(respuesta);
+    if (r.tieneObjetivo) {
+        estado.setObjetivo(r.objetivo[0], r.objetivo[1], r.objetivo[2]);
+        estado.setFueraDeEspacio(false);
+        // Sin sondeo, el destino aceptado es lo mejor que se sabe
+        if (periodoSondeo() <= 0) estado.setPos(r.objetivo[0], r.objetivo[1], r.objetivo[2], r.objetivo[3]);
+    }
+    if (r.homing) {
+        estado.setPos(brazo::kInicialX, brazo::kInicialY, brazo::kInicialZ, brazo::kInicialE);
+    }
+    if (r.tienePosicion) {
+        estado.setPos(r.posicion[0], r.posicion[1], r.posicion[2], r.posicion[3]);
+    }
+    if (r.modoAbs >= 0) estado.setModo(r.modoAbs == 1);
+    if (r.motores >= 0) estado.setMotores(r.motores == 1);
+    if (r.garra >= 0) estado.setGarra(r.garra == 1);
+
+    if (r.fueraDeEspacio) {
+        CONSOLA_AVISO("🚧 Punto fuera del espacio de trabajo (" << cmd << ")");
+        estado.setFueraDeEspacio(true);
+    } else if (r.error) {
+        CONSOLA_ERROR("🔴 Arduino reporta: ERROR");
+    } else if (r.ok) {
+        CONSOLA_TRAZA("🟢 Arduino reporta: OK");
+    }
+
     std::string respLower = respuesta;
     std::transform(respLower.begin(), respLower.end(), respLower.begin(), ::tolower);
-    
-    if (respLower.find("ok") != std::string::npos) {
-        std::cout << "🟢 Arduino reporta: OK" << std::endl;
-    } else if (respLower.find("error") != std::string::npos) {
-        std::cerr << "🔴 Arduino reporta: ERROR" << std::endl;
-        // estado.setError(true); // Si tienes este método en EstadoRobot
-    } else if (respLower.find("alarm") != std::string::npos) {
-        std::cerr << "🚨 ALARMA del Arduino" << std::endl;
+    if (respLower.find("alarm") != std::string::npos) {
+        CONSOLA_ERROR("🚨 ALARMA del Arduino");
         estado.setEmergencia(true);
-    } else if (respLower.find("sim:ok") != std::string::npos) {
-        std::cout << "🔵 Simulación: Comando aceptado" << std::endl;
-    } else if (respuesta.empty()) {
-        std::cout << "⚠️  Arduino no respondió (timeout)" << std::endl;
     }
+    return r.fueraDeEspacio;
 }
 
 void RobotControllerSimple::ejecutarComando(const std::string& cmd) {
-    std::string respuesta = comm.enviarComando(cmd);
+    InstruccionGcode ins;
+    if (gcode::compilarLinea(cmd, 0, ins) && ins.valida()) {
+        if (ins.esArco()) {
+            ejecutarArco(ins);
+            return;
+        }
+        modal.avanzar(ins);
+    }
+    enviar(cmd);
+}
+
+void RobotControllerSimple::enviar(const std::string& cmd) {
+    std::string respuesta;
+    {
+        std::lock_guard<std::mutex> lock(mtxSerie);
+        respuesta = comm.enviarComando(cmd);
+    }
     
-    std::cout << "✅ Comando '" << cmd << "' | Respuesta: '" << respuesta << "'" << std::endl;
+    CONSOLA_DEBUG("✅ Comando '" << cmd << "' | Respuesta: '" << respuesta << "'");
     
     // Procesar respuesta del Arduino
-    procesarRespuestaArduino(respuesta);
+    const bool fuera = procesarRespuestaArduino(cmd, respuesta);
+
+    // El firmware cortó el movimiento en el último punto permitido: se
+    // pregunta dónde quedó para que los arcos y movimientos relativos
+    // siguientes partan de la posición real.
+    if (fuera && cmd != "M114") {
+        std::string pos;
+        {
+            std::lock_guard<std::mutex> lock(mtxSerie);
+            pos = comm.enviarComando("M114");
+        }
+        const RespuestaFirmware r = firmware::interpretar(pos);
+        if (r.tienePosicion) {
+            estado.setPos(r.posicion[0], r.posicion[1], r.posicion[2], r.posicion[3]);
+            for (int e = 0; e < 4; ++e) modal.pos[e] = r.posicion[e] + modal.offset[e];
+        }
+    }
     
     // Solo si quieres verificar errores específicos
     if (respuesta.find("ERROR") != std::string::npos || respuesta.empty()) {
-        std::cerr << "❌ El Arduino reportó un error" << std::endl;
+        CONSOLA_ERROR("❌ El Arduino reportó un error");
     }
 }
 
 void RobotControllerSimple::registrarAprendizaje(const std::string& cmd) {
     if (aprendizaje && aprendizaje->estaActivo()) {
         aprendizaje->registrar(cmd);
+        // Fotograma con lo que quedó vigente tras el comando
+        Fotograma f;
+        f.x = modal.pos[0] - modal.offset[0];
+        f.y = modal.pos[1] - modal.offset[1];
+        f.z = modal.pos[2] - modal.offset[2];
+        f.e = modal.pos[3] - modal.offset[3];
+        f.feed = modal.feed;
+        f.garra = estado.leer().garra;
+        aprendizaje->registrarFotograma(f);
+    }
+}
+
+ResultadoReproduccion RobotControllerSimple::reproducirGrabacion(const std::string& ruta, OpcionesReproduccion opciones,
+                                                                 bool ejecutar) {
+    ResultadoReproduccion r;
+    std::vector<Fotograma> grabados;
+    if (!fotogramas::leer(ruta, grabados, r.bytesDescartados, r.error)) return r;
+    for (int e = 0; e < 4; ++e) opciones.offset[e] = modal.offset[e];
+    r.plan = fotogramas::planificar(grabados, opciones);
+    if (!ejecutar) return r;
+    if (!r.plan.valido()) {
+        r.error = r.plan.pasos.empty() ? "La grabación está vacía" : "La grabación sale del espacio de trabajo";
+        return r;
+    }
+
+    CONSOLA_INFO("⏯️ REPRODUCIENDO " << ruta << " x" << opciones.velocidad << " (" << r.plan.pasos.size()
+                 << " pasos, " << r.plan.duracionMs << " ms)");
+    const bool eraRelativo = modal.relativo;
+    if (eraRelativo) ejecutarComando("G90");
+    r.ejecutada = true;
+    const auto inicio = std::chrono::steady_clock::now();
+    for (const auto& paso : r.plan.pasos) {
+        if (estado.leer().emergencia) {
+            r.error = "Reproducción cortada por emergencia";
+            break;
+        }
+        const auto objetivo = inicio + std::chrono::milliseconds(paso.ms);
+        std::this_thread::sleep_until(objetivo);
+        const int64_t retraso = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                    std::chrono::steady_clock::now() - objetivo).count();
+        r.retrasoMaxMs = std::max(r.retrasoMaxMs, retraso);
+        if (paso.tipo == PasoReproduccion::MOVER) {
+            std::ostringstream cmd;
+            cmd << std::fixed << std::setprecision(2) << "G1 X" << paso.x << " Y" << paso.y << " Z" << paso.z
+                << " E" << paso.e << std::setprecision(0) << " F" << paso.feed;
+            ejecutarComando(cmd.str());
+        } else {
+            const bool on = paso.tipo == PasoReproduccion::GARRA_ON;
+            estado.setGarra(on);
+            ejecutarComando(on ? "M3" : "M5");
+        }
+        ++r.enviados;
+    }
+    if (eraRelativo) ejecutarComando("G91");
+    return r;
+}
+
+void RobotControllerSimple::iniciarSondeo(int periodoMs) {
+    detenerSondeo();
+    if (periodoMs <= 0) return;
+    {
+        std::lock_guard<std::mutex> lock(mtxSondeo);
+        detenerSondeoPedido = false;
+    }
+    periodoSondeoMs = periodoMs;
+    hiloSondeo = std::thread(&RobotControllerSimple::bucleSondeo, this, periodoMs);
+    CONSOLA_INFO("📡 Sondeo de posición cada " << periodoMs << " ms");
+}
+
+void RobotControllerSimple::detenerSondeo() {
+    {
+        std::lock_guard<std::mutex> lock(mtxSondeo);
+        detenerSondeoPedido = true;
+    }
+    cvSondeo.notify_all();
+    if (hiloSondeo.joinable()) hiloSondeo.join();
+    periodoSondeoMs = 0;
+}
+
+void RobotControllerSimple::bucleSondeo(int periodoMs) {
+    std::unique_lock<std::mutex> lk(mtxSondeo);
+    while (!cvSondeo.wait_for(lk, std::chrono::milliseconds(periodoMs), [this] { return detenerSondeoPedido; })) {
+        lk.unlock();
+        // En simulación no hay nada que preguntar
+        if (comm.isOpen()) {
+            std::string respuesta;
+            {
+                std::lock_guard<std::mutex> lock(mtxSerie);
+                respuesta = comm.enviarComando("M114");
+            }
+            const RespuestaFirmware r = firmware::interpretar(respuesta);
+            if (r.tienePosicion) estado.setPos(r.posicion[0], r.posicion[1], r.posicion[2], r.posicion[3]);
+            if (r.modoAbs >= 0) estado.setModo(r.modoAbs == 1);
+            if (r.motores >= 0) estado.setMotores(r.motores == 1);
+        }
+        lk.lock();
     }
 }
@@ -1,7 +1,16 @@
 #include "server.h"
 #include "logger.h"
+#include "estimador_trabajo.h"
+#include "optimizador_gcode.h"
+#include "planificador_pick_place.h"
+#include "telemetria.h"
+#include "diario_estado.h"
+#include "catalogo_trabajos.h"
+#include "almacen_blobs.h"
+#include "consulta_log.h"
 
 #include <algorithm>
+#include <cmath>
 #include <cctype>
 #include <fstream>
 #include <iomanip>
@@ -53,6 +62,52 @@ std::string buildStructResponse(const std::vector<std::pair<std::string, std::st
     return out.str();
 }
 
+// Carpetas de programas que los RPC pueden leer y en las que pueden
+// escribir (las mismas que vigila el catálogo)
+const char* const kCarpetasTrabajo[] = {"jobs", "uploads", "aprendizajes", "aprendizaje gcode"};
+
+// Ruta canónica de `ruta` si queda dentro de alguna de kCarpetasTrabajo.
+// Se resuelven "..", y los enlaces simbólicos que existan, antes de
+// comparar: "jobs/../../etc/x" o un enlace en jobs/ hacia afuera no pasan.
+std::optional<std::string> rutaTrabajoPermitida(const std::string& ruta) {
+    if (ruta.empty()) return std::nullopt;
+    std::error_code ec;
+    const fs::path pedida = fs::weakly_canonical(ruta, ec);
+    if (ec) return std::nullopt;
+    for (const char* carpeta : kCarpetasTrabajo) {
+        const fs::path base = fs::weakly_canonical(carpeta, ec);
+        if (ec) continue;
+        // Componente a componente: "jobs2/x" no está dentro de "jobs"
+        auto b = base.begin();
+        auto p = pedida.begin();
+        while (b != base.end() && p != pedida.end() && *b == *p) {
+            ++b;
+            ++p;
+        }
+        if (b == base.end() && p != pedida.end()) return pedida.string();
+    }
+    return std::nullopt;
+}
+
+// Destino de un programa generado a partir de `entrada`. `nombre` sólo
+// puede ser un nombre de archivo .gcode (sin directorios ni ".."): se
+// escribe junto a la entrada. Vacío: <entrada>_<sufijo>.gcode. El destino
+// también tiene que quedar en una carpeta de trabajos.
+std::optional<std::string> rutaSalidaGcode(const std::string& entrada, const std::string& nombre,
+                                           const std::string& sufijo) {
+    const fs::path origen(entrada);
+    if (nombre.empty()) {
+        const fs::path destino = origen.parent_path() / (origen.stem().string() + "_" + sufijo + ".gcode");
+        return rutaTrabajoPermitida(destino.string());
+    }
+    const fs::path p(nombre);
+    if (p.is_absolute() || p.has_parent_path() || nombre.find('\\') != std::string::npos ||
+        p.extension() != ".gcode" || p.stem().empty() || p.stem() == "." || p.stem() == "..") {
+        return std::nullopt;
+    }
+    return rutaTrabajoPermitida((origen.parent_path() / p).string());
+}
+
 std::string buildFault(const std::string& message) {
     std::ostringstream out;
     out << "<?xml version=\"1.0\"?>"
@@ -254,6 +309,70 @@ void Server::parseHttpRequest(const std::string& request, std::string& method, s
     if (path.empty()) path = "/";
 }
 
+bool Server::extraerCredenciales(const std::string& body, std::string& user, std::string& pass) {
+    if (!extractParams(body, user, pass)) {
+        json payload;
+        if (extractJsonParam(body, payload)) {
+            user = payload.value("username", std::string());
+            pass = payload.value("password", std::string());
+        }
+    }
+    return !user.empty() && !pass.empty();
+}
+
+std::string Server::respuestaLogin(const Login::AuthResult& auth, const std::string& user) {
+    if (!auth.success) {
+        return buildStructResponse({{"status", "error"}, {"message", auth.message}});
+    }
+    logger.logEvent("auth", "Login de " + user + " como " + auth.privilege, user);
+    return buildStructResponse({
+        {"status", "success"},
+        {"message", auth.message},
+        {"token", auth.token},
+        {"privilege", auth.privilege},
+        {"user", user}
+    });
+}
+
+Server::IdentidadRPC Server::identificarRPC(const std::string& body, Login& login) {
+    IdentidadRPC id;
+    id.metodo = extractMethodName(body);
+    const std::string& m = id.metodo;
+    if (m == "emergencyStop") {
+        id.critica = true;
+        return id;
+    }
+    if (m == "move" || m == "home" || m == "gripper" || m == "motors" || m == "setAbs" || m == "setRel" ||
+        m == "sendGcode" || m == "runFile" || m == "playTeach") {
+        id.clase = ClaseTrafico::MOVIMIENTO;
+    } else if (m == "getEstado" || m == "getHistory" || m == "ping") {
+        id.clase = ClaseTrafico::ESTADO;
+    }
+    // El login se limita sólo por IP: por usuario, cualquiera podría
+    // agotarle el presupuesto a otro
+    if (m == "login") return id;
+    // consultarSesion y no resolverSesion: una petición rechazada no
+    // debe renovar la inactividad del token
+    json payload;
+    if (extractJsonParam(body, payload) && payload.contains("token") && payload["token"].is_string()) {
+        if (auto activa = login.consultarSesion(payload["token"].get<std::string>())) id.usuario = std::move(activa->usuario);
+    }
+    return id;
+}
+
+bool Server::procesarLoginAsync(const std::string& body, Login& login,
+                                std::function<void(const std::string&)> responder) {
+    if (extractMethodName(body) != "login") return false;
+    std::string user, pass;
+    // Sin credenciales no hay nada que derivar: la falla la arma procesarRPC
+    if (!extraerCredenciales(body, user, pass)) return false;
+    auto listo = [this, user, responder](const Login::AuthResult& auth) { responder(respuestaLogin(auth, user)); };
+    if (!login.authenticateAsync(user, pass, listo)) {
+        responder(buildStructResponse({{"status", "error"}, {"message", "Demasiados logins en curso, reintente en unos segundos"}}));
+    }
+    return true;
+}
+
 std::string Server::procesarRPC(const std::string& body, Login& login, RobotControllerSimple& robot,
                         EstadoRobot& estado, Aprendizaje& aprendizaje, AdministradorSistema& admin,
                         bool quiet) {
@@ -269,28 +388,10 @@ std::string Server::procesarRPC(const std::string& body, Login& login, RobotCont
 
     if (method == "login") {
         std::string user, pass;
-        if (!extractParams(body, user, pass)) {
-            json payload;
-            if (extractJsonParam(body, payload)) {
-                user = payload.value("username", std::string());
-                pass = payload.value("password", std::string());
-            }
-        }
-        if (user.empty() || pass.empty()) {
+        if (!extraerCredenciales(body, user, pass)) {
             return buildFault("Credenciales incompletas");
         }
-        auto auth = login.authenticate(user, pass);
-        if (!auth.success) {
-            return buildStructResponse({{"status", "error"}, {"message", auth.message}});
-        }
-        logger.logEvent("auth", "Login de " + user + " como " + auth.privilege);
-        return buildStructResponse({
-            {"status", "success"},
-            {"message", auth.message},
-            {"token", auth.token},
-            {"privilege", auth.privilege},
-            {"user", user}
-        });
+        return respuestaLogin(login.authenticate(user, pass), user);
     }
 
     json payload = json::object();
@@ -311,18 +412,17 @@ std::string Server::procesarRPC(const std::string& body, Login& login, RobotCont
             session = {"local", "admin", false};
             return true;
         }
-        auto username = login.usernameForToken(token);
-        if (username.empty()) {
+        auto activa = login.resolverSesion(token);
+        if (!activa) {
             error = "Token inválido";
             return false;
         }
-        auto privilege = login.privilegeForToken(token);
-        if (privilege.empty()) privilege = "viewer";
-        if (privilegeLevel(privilege) < minLevel) {
+        if (activa->privilegio.empty()) activa->privilegio = "viewer";
+        if (privilegeLevel(activa->privilegio) < minLevel) {
             error = "Privilegios insuficientes";
             return false;
         }
-        session = {username, privilege, true};
+        session = {std::move(activa->usuario), std::move(activa->privilegio), true};
         return true;
     };
 
@@ -336,18 +436,88 @@ std::string Server::procesarRPC(const std::string& body, Login& login, RobotCont
         if (!resolveSession(0, session, err)) {
             return buildFault(err);
         }
+        // Un cliente que ya tiene la versión N no necesita el estado completo
+        if (payload.contains("sinceVersion") && payload["sinceVersion"].is_number()) {
+            const uint64_t desde = payload.value("sinceVersion", static_cast<uint64_t>(0));
+            if (!estado.cambioDesde(desde)) {
+                return buildStructResponse({
+                    {"status", "ok"},
+                    {"sinCambios", "SI"},
+                    {"version", std::to_string(desde)}
+                });
+            }
+        }
         auto snapshot = estado.leer();
         bool remoto = admin.getRemoto();
+        // Último trabajo según el diario (sigue ahí tras un reinicio)
+        const EstadoPersistido::Trabajo trabajo = diarioEstado.trabajo();
         return buildStructResponse({
             {"status", "ok"},
             {"x", formatFloat(snapshot.x)},
             {"y", formatFloat(snapshot.y)},
             {"z", formatFloat(snapshot.z)},
+            {"e", formatFloat(snapshot.e)},
+            {"objetivoX", formatFloat(snapshot.ox)},
+            {"objetivoY", formatFloat(snapshot.oy)},
+            {"objetivoZ", formatFloat(snapshot.oz)},
+            {"fueraDeEspacio", snapshot.fueraDeEspacio ? "SI" : "NO"},
+            {"sondeoMs", std::to_string(robot.periodoSondeo())},
             {"motores", snapshot.motores ? "ON" : "OFF"},
             {"garra", snapshot.garra ? "ON" : "OFF"},
             {"modo", snapshot.modoAbs ? "ABS" : "REL"},
             {"emergencia", snapshot.emergencia ? "SI" : "NO"},
-            {"remoto", remoto ? "ON" : "OFF"}
+            {"remoto", remoto ? "ON" : "OFF"},
+            {"trabajo", trabajo.ruta},
+            {"trabajoLinea", std::to_string(trabajo.linea)},
+            {"trabajoActivo", trabajo.activo ? "SI" : "NO"},
+            {"version", std::to_string(snapshot.version)}
+        });
+    }
+
+    if (method == "getHistory") {
+        RpcSession session;
+        std::string err;
+        if (!resolveSession(0, session, err)) {
+            return buildFault(err);
+        }
+        const int64_t ahora = Telemetria::ahoraMs();
+        const int64_t hasta = payload.value("to", ahora);
+        const int64_t desde = payload.value("from", hasta - 60000);
+        const std::string resolucion = payload.value("resolution", std::string("100ms"));
+        ResolucionTelemetria r;
+        if (resolucion == "raw") r = ResolucionTelemetria::CRUDA;
+        else if (resolucion == "100ms") r = ResolucionTelemetria::DECIMAS;
+        else if (resolucion == "1s") r = ResolucionTelemetria::SEGUNDOS;
+        else return buildFault("Resolución inválida (raw, 100ms o 1s)");
+        const size_t maxPuntos = payload.value("maxPoints", static_cast<size_t>(2000));
+        auto muestras = telemetria.historial(desde, hasta, r, maxPuntos);
+
+        // Arreglos por columna; los tiempos como diferencias respecto de t0
+        const int64_t t0 = muestras.empty() ? desde : muestras.front().ms;
+        json dt = json::array(), xs = json::array(), ys = json::array(), zs = json::array(),
+             es = json::array(), flags = json::array();
+        int64_t previo = t0;
+        auto redondear = [](float v) { return std::round(v * 100.0f) / 100.0f; };
+        for (const auto& m : muestras) {
+            dt.push_back(m.ms - previo);
+            previo = m.ms;
+            xs.push_back(redondear(m.x));
+            ys.push_back(redondear(m.y));
+            zs.push_back(redondear(m.z));
+            es.push_back(redondear(m.e));
+            flags.push_back(m.flags);
+        }
+        return buildStructResponse({
+            {"status", "ok"},
+            {"resolucion", resolucion},
+            {"t0", std::to_string(t0)},
+            {"muestras", std::to_string(muestras.size())},
+            {"dt", dt.dump()},
+            {"x", xs.dump()},
+            {"y", ys.dump()},
+            {"z", zs.dump()},
+            {"e", es.dump()},
+            {"flags", flags.dump()}
         });
     }
 
@@ -361,6 +531,13 @@ std::string Server::procesarRPC(const std::string& body, Login& login, RobotCont
 
     RpcSession session;
 
+    if (method == "logout") {
+        if (auto err = requireUser(0, session)) return buildFault(*err);
+        if (!session.authenticated) return buildFault("Token requerido");
+        login.cerrarSesion(payload.value("token", std::string()));
+        logger.logEvent("auth", "Logout de " + session.username, session.username);
+        return ok("Sesión cerrada");
+    }
     if (method == "move") {
         if (auto err = requireUser(1, session)) return buildFault(*err);
         double x = payload.value("x", 0.0);
@@ -369,7 +546,8 @@ std::string Server::procesarRPC(const std::string& body, Login& login, RobotCont
         double f = payload.value("f", 1200.0);
         bool abs = payload.value("abs", true);
         robot.mover(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z), static_cast<float>(f), abs);
-        logger.logEvent("rpc", session.username + " move x:" + std::to_string(x) + " y:" + std::to_string(y));
+        logger.logEvent("rpc", session.username + " move x:" + std::to_string(x) + " y:" + std::to_string(y),
+                        session.username);
         return ok("Movimiento enviado");
     }
     if (method == "motors") {
@@ -406,23 +584,392 @@ std::string Server::procesarRPC(const std::string& body, Login& login, RobotCont
         robot.ejecutarComando(line);
         return ok("Comando enviado");
     }
+    if (method == "setPositionPolling") {
+        if (auto err = requireUser(1, session)) return buildFault(*err);
+        int periodo = payload.value("periodMs", 0);
+        if (periodo < 0) return buildFault("Periodo inválido");
+        if (periodo > 0 && periodo < 100) periodo = 100; // M114 tarda ~30 ms sólo en el serie
+        robot.iniciarSondeo(periodo);
+        return ok(periodo > 0 ? "Sondeo de posición cada " + std::to_string(periodo) + " ms"
+                              : "Sondeo de posición desactivado");
+    }
     if (method == "runFile") {
         if (auto err = requireUser(1, session)) return buildFault(*err);
         auto path = payload.value("path", std::string());
         if (path.empty()) return buildFault("Ruta vacía");
+        if (payload.value("optimize", false)) {
+            auto programa = cacheGcode.obtener(path);
+            if (!programa) return buildFault("No se pudo leer " + path);
+            OpcionesOptimizador opciones;
+            opciones.toleranciaColineal = payload.value("tolerance", opciones.toleranciaColineal);
+            ReporteOptimizacion reporte;
+            robot.ejecutarPrograma(gcode::optimizar(*programa, opciones, reporte));
+            return ok("Archivo optimizado en ejecución (" + std::to_string(reporte.lineasAhorradas()) +
+                      " líneas menos)");
+        }
         robot.ejecutarArchivo(path);
         return ok("Archivo en ejecución");
     }
+    if (method == "listJobs" || method == "searchJobs") {
+        if (auto err = requireUser(0, session)) return buildFault(*err);
+        const uint32_t desde = payload.value("offset", 0u);
+        const uint32_t cantidad = payload.value("limit", 50u);
+        PaginaCatalogo pagina;
+        if (method == "searchJobs") {
+            const auto consulta = payload.value("query", std::string());
+            if (consulta.empty()) return buildFault("Consulta vacía");
+            pagina = catalogoTrabajos.buscar(consulta, desde, cantidad);
+        } else {
+            const auto orden = payload.value("sort", std::string("modified"));
+            OrdenCatalogo o = OrdenCatalogo::MODIFICADO;
+            if (orden == "name") o = OrdenCatalogo::NOMBRE;
+            else if (orden == "duration") o = OrdenCatalogo::DURACION;
+            else if (orden != "modified") return buildFault("sort debe ser modified, name o duration");
+            pagina = catalogoTrabajos.listar(payload.value("folder", std::string()), o, desde, cantidad);
+        }
+        json trabajos = json::array();
+        for (const auto& f : pagina.fichas) {
+            json t = {
+                {"ruta", f.ruta}, {"nombre", f.nombre}, {"carpeta", f.carpeta}, {"hash", f.hash},
+                {"lineas", f.lineas}, {"instrucciones", f.instrucciones}, {"invalidas", f.invalidas},
+                {"segundos", f.segundos}, {"bytes", f.bytes}, {"creador", f.creador},
+                {"creado", f.creado}, {"modificado", f.modificado}, {"analizado", f.analizado}
+            };
+            if (f.tieneCaja) {
+                t["min"] = {f.min[0], f.min[1], f.min[2]};
+                t["max"] = {f.max[0], f.max[1], f.max[2]};
+            }
+            trabajos.push_back(std::move(t));
+        }
+        return buildStructResponse({
+            {"status", "ok"},
+            {"total", std::to_string(pagina.total)},
+            {"offset", std::to_string(desde)},
+            {"cantidad", std::to_string(pagina.fichas.size())},
+            {"trabajos", trabajos.dump()}
+        });
+    }
+    if (method == "getStorageStats") {
+        if (auto err = requireUser(0, session)) return buildFault(*err);
+        const EstadisticasBlobs e = almacenBlobs.estadisticas();
+        return buildStructResponse({
+            {"status", "ok"},
+            {"blobs", std::to_string(e.blobs)},
+            {"bytes", std::to_string(e.bytes)},
+            {"referencias", std::to_string(e.referencias)},
+            {"bytesLogicos", std::to_string(e.bytesLogicos)},
+            {"ahorrado", std::to_string(e.bytesLogicos > e.bytes ? e.bytesLogicos - e.bytes : 0)}
+        });
+    }
+    if (method == "getAuthStats") {
+        if (auto err = requireUser(2, session)) return buildFault(*err);
+        const EstadisticasAuth e = login.estadisticas();
+        const EstadisticasSesiones ses = login.estadisticasSesiones();
+        return buildStructResponse({
+            {"status", "ok"},
+            {"exitos", std::to_string(e.exitos)},
+            {"fallos", std::to_string(e.fallos)},
+            {"errores", std::to_string(e.errores)},
+            {"rechazados", std::to_string(e.rechazados)},
+            {"migrados", std::to_string(e.migrados)},
+            {"conexiones", std::to_string(e.conexiones)},
+            {"hilos", std::to_string(e.hilos)},
+            {"pendientes", std::to_string(e.pendientes)},
+            {"iteraciones", std::to_string(e.iteraciones)},
+            {"muestras", std::to_string(e.latencia.muestras)},
+            {"p50Us", std::to_string(e.latencia.p50Us)},
+            {"p90Us", std::to_string(e.latencia.p90Us)},
+            {"p99Us", std::to_string(e.latencia.p99Us)},
+            {"maxUs", std::to_string(e.latencia.maxUs)},
+            {"mediaUs", formatFloat(static_cast<float>(e.latencia.mediaUs))},
+            {"sesionesActivas", std::to_string(ses.activas)},
+            {"sesionesVencidas", std::to_string(ses.vencidas)},
+            {"sesionesCerradas", std::to_string(ses.cerradas)}
+        });
+    }
+    if (method == "getRateLimitStats") {
+        if (auto err = requireUser(2, session)) return buildFault(*err);
+        const EstadisticasLimitador e = limitadorTasa.estadisticas();
+        json clases = json::array();
+        for (size_t i = 0; i < EstadisticasLimitador::kClases; ++i) {
+            const auto clase = static_cast<ClaseTrafico>(i);
+            const PresupuestoTasa p = limitadorTasa.presupuesto(clase);
+            clases.push_back({{"clase", LimitadorTasa::nombreClase(clase)},
+                              {"admitidas", e.admitidas[i]},
+                              {"rechazadas", e.rechazadas[i]},
+                              {"porSegundo", p.porSegundo},
+                              {"rafaga", p.rafaga}});
+        }
+        return buildStructResponse({
+            {"status", "ok"},
+            {"clases", clases.dump()},
+            {"rechazadasPorIp", std::to_string(e.rechazadasPorIp)},
+            {"rechazadasPorUsuario", std::to_string(e.rechazadasPorUsuario)},
+            {"exentas", std::to_string(e.exentas)},
+            {"cubetas", std::to_string(e.cubetas)}
+        });
+    }
+    if (method == "queryLogs") {
+        if (auto err = requireUser(2, session)) return buildFault(*err);
+        FiltroLog filtro;
+        const int64_t ahora = Telemetria::ahoraMs();
+        filtro.hastaMs = payload.value("to", ahora);
+        const int64_t minutos = payload.value("lastMinutes", static_cast<int64_t>(0));
+        filtro.desdeMs = payload.value("from", minutos > 0 ? filtro.hastaMs - minutos * 60000 : INT64_MIN);
+        filtro.usuario = payload.value("user", std::string());
+        filtro.nodo = payload.value("node", std::string());
+        filtro.modulo = payload.value("module", std::string());
+        filtro.texto = payload.value("text", std::string());
+        const auto categoria = payload.value("category", std::string());
+        if (categoria == "request") filtro.categorias = 1 << RegistroLog::PETICION;
+        else if (categoria == "event") filtro.categorias = 1 << RegistroLog::EVENTO;
+        else if (!categoria.empty()) return buildFault("category debe ser request o event");
+        if (payload.contains("code")) {
+            filtro.codigoMin = filtro.codigoMax = payload.value("code", 0);
+        } else {
+            filtro.codigoMin = payload.value("minCode", 0);
+            filtro.codigoMax = payload.value("maxCode", 0);
+        }
+        const size_t limite = std::clamp(payload.value("limit", static_cast<size_t>(500)), static_cast<size_t>(1),
+                                         static_cast<size_t>(10000));
+        // cursor "ms:n": seguir tras las n primeras filas con ese ms
+        int64_t msCursor = 0;
+        size_t saltar = 0;
+        const auto cursor = payload.value("cursor", std::string());
+        if (!cursor.empty()) {
+            const auto dosPuntos = cursor.find(':');
+            if (dosPuntos == std::string::npos) return buildFault("cursor inválido");
+            msCursor = std::atoll(cursor.c_str());
+            saltar = static_cast<size_t>(std::atoll(cursor.c_str() + dosPuntos + 1));
+            filtro.desdeMs = std::max(filtro.desdeMs, msCursor);
+        }
+
+        logger.flush();     // lo encolado hasta ahora también cuenta
+        // Las filas se escriben directo en el arreglo JSON a medida que aparecen
+        std::string filas = "[";
+        size_t cantidad = 0, mismoMs = 0;     // filas ya entregadas con ms == ultimoMs
+        int64_t ultimoMs = msCursor;
+        bool truncado = false;
+        const EstadisticasConsulta est = indiceLog.consultar(filtro, [&](const RegistroLog& r) {
+            if (saltar > 0 && r.ms == msCursor) {
+                --saltar;
+                ++mismoMs;
+                return true;
+            }
+            if (cantidad == limite) {
+                truncado = true;
+                return false;
+            }
+            if (cantidad > 0) filas += ',';
+            filas += registro_log::aJson(r);
+            mismoMs = r.ms == ultimoMs ? mismoMs + 1 : 1;
+            ultimoMs = r.ms;
+            ++cantidad;
+            return true;
+        });
+        filas += ']';
+        return buildStructResponse({
+            {"status", "ok"},
+            {"cantidad", std::to_string(cantidad)},
+            {"truncado", truncado ? "SI" : "NO"},
+            {"cursor", truncado ? std::to_string(ultimoMs) + ":" + std::to_string(mismoMs) : std::string()},
+            {"registros", filas},
+            {"segmentos", std::to_string(est.segmentos)},
+            {"segmentosLeidos", std::to_string(est.segmentosLeidos)},
+            {"bloques", std::to_string(est.bloques)},
+            {"bloquesLeidos", std::to_string(est.bloquesLeidos)},
+            {"registrosLeidos", std::to_string(est.registrosLeidos)},
+            {"milisegundos", formatFloat(static_cast<float>(est.milisegundos))}
+        });
+    }
+    if (method == "playTeach") {
+        if (auto err = requireUser(1, session)) return buildFault(*err);
+        auto path = payload.value("path", std::string());
+        if (path.empty()) return buildFault("Ruta vacía");
+        // Se acepta también el .gcode de la sesión
+        if (fs::path(path).extension() != ".teach") path = fotogramas::rutaGrabacion(path);
+        OpcionesReproduccion opciones;
+        opciones.velocidad = payload.value("speed", opciones.velocidad);
+        opciones.pasoMinimoMs = payload.value("minStepMs", opciones.pasoMinimoMs);
+        opciones.feedMaximo = payload.value("maxFeed", opciones.feedMaximo);
+        if (!(opciones.velocidad > 0.0 && opciones.velocidad <= 10.0)) {
+            return buildFault("speed debe estar entre 0 y 10");
+        }
+        const bool ejecutar = !payload.value("dryRun", false);
+        const ResultadoReproduccion r = robot.reproducirGrabacion(path, opciones, ejecutar);
+        if (!r.error.empty() && !r.ejecutada && r.plan.fotogramas == 0) return buildFault(r.error);
+        const PlanReproduccion& plan = r.plan;
+        return buildStructResponse({
+            {"status", r.error.empty() ? "ok" : "error"},
+            {"message", r.error.empty() ? (r.ejecutada ? "Grabación reproducida" : "Grabación validada") : r.error},
+            {"valida", plan.valido() ? "SI" : "NO"},
+            {"fotogramas", std::to_string(plan.fotogramas)},
+            {"pasos", std::to_string(plan.pasos.size())},
+            {"omitidos", std::to_string(plan.omitidos)},
+            {"feedLimitado", std::to_string(plan.feedLimitado)},
+            {"fueraDeEspacio", std::to_string(plan.fueraDeEspacio)},
+            {"primerFuera", plan.tieneFuera ? formatFloat(plan.primerFuera.x) + "," + formatFloat(plan.primerFuera.y) +
+                                                  "," + formatFloat(plan.primerFuera.z)
+                                            : std::string()},
+            {"duracionMs", std::to_string(plan.duracionMs)},
+            {"bytesDescartados", std::to_string(r.bytesDescartados)},
+            {"ejecutada", r.ejecutada ? "SI" : "NO"},
+            {"enviados", std::to_string(r.enviados)},
+            {"retrasoMaxMs", std::to_string(r.retrasoMaxMs)}
+        });
+    }
+    if (method == "optimizeJob") {
+        if (auto err = requireUser(1, session)) return buildFault(*err);
+        auto path = payload.value("path", std::string());
+        if (path.empty()) return buildFault("Ruta vacía");
+        const auto permitida = rutaTrabajoPermitida(path);
+        if (!permitida) return buildFault("path debe estar en una carpeta de trabajos");
+        path = *permitida;
+        auto programa = cacheGcode.obtener(path);
+        if (!programa) return buildFault("No se pudo leer " + path);
+
+        OpcionesOptimizador opciones;
+        opciones.toleranciaColineal = payload.value("tolerance", opciones.toleranciaColineal);
+        opciones.fusionarColineales = payload.value("mergeCollinear", opciones.fusionarColineales);
+        opciones.asumirAbsoluto = payload.value("assumeAbsolute", opciones.asumirAbsoluto);
+        ReporteOptimizacion reporte;
+        auto optimizado = gcode::optimizar(*programa, opciones, reporte);
+
+        const auto salida = rutaSalidaGcode(path, payload.value("output", std::string()), "opt");
+        if (!salida) return buildFault("output debe ser un nombre de archivo .gcode, sin directorios");
+        const std::string& destino = *salida;
+        if (!gcode::escribirTexto(optimizado, destino)) {
+            return buildFault("No se pudo escribir " + destino);
+        }
+        logger.logEvent("rpc", session.username + " optimizeJob " + path + " -> " + destino + " (-" +
+                        std::to_string(reporte.lineasAhorradas()) + " líneas)", session.username);
+        return buildStructResponse({
+            {"status", "ok"},
+            {"message", "Programa optimizado"},
+            {"output", destino},
+            {"lineasOriginales", std::to_string(reporte.lineasOriginales)},
+            {"lineasResultantes", std::to_string(reporte.lineasResultantes)},
+            {"movimientosNulos", std::to_string(reporte.movimientosNulos)},
+            {"modosRedundantes", std::to_string(reporte.modosRedundantes)},
+            {"motoresRedundantes", std::to_string(reporte.motoresRedundantes)},
+            {"garraRedundante", std::to_string(reporte.garraRedundante)},
+            {"segmentosFusionados", std::to_string(reporte.segmentosFusionados)},
+            {"segundosAntes", formatFloat(static_cast<float>(reporte.segundosAntes))},
+            {"segundosDespues", formatFloat(static_cast<float>(reporte.segundosDespues))},
+            {"segundosAhorrados", formatFloat(static_cast<float>(reporte.segundosAhorrados()))}
+        });
+    }
+    if (method == "planPickPlace") {
+        if (auto err = requireUser(1, session)) return buildFault(*err);
+        auto path = payload.value("path", std::string());
+        if (path.empty()) return buildFault("Ruta vacía");
+        const auto permitida = rutaTrabajoPermitida(path);
+        if (!permitida) return buildFault("path debe estar en una carpeta de trabajos");
+        path = *permitida;
+        auto programa = cacheGcode.obtener(path);
+        if (!programa) return buildFault("No se pudo leer " + path);
+
+        OpcionesPlanificador opciones;
+        opciones.asumirAbsoluto = payload.value("assumeAbsolute", opciones.asumirAbsoluto);
+        ReportePlanificacion reporte;
+        auto planificado = gcode::planificarPickPlace(*programa, opciones, reporte);
+
+        const auto salida = rutaSalidaGcode(path, payload.value("output", std::string()), "reordenado");
+        if (!salida) return buildFault("output debe ser un nombre de archivo .gcode, sin directorios");
+        const std::string& destino = *salida;
+        if (!gcode::escribirTexto(planificado, destino)) {
+            return buildFault("No se pudo escribir " + destino);
+        }
+        logger.logEvent("rpc", session.username + " planPickPlace " + path + " -> " + destino + " (" +
+                        std::to_string(reporte.bloquesMovidos) + " bloques movidos)", session.username);
+        return buildStructResponse({
+            {"status", "ok"},
+            {"message", "Bloques pick-and-place reordenados"},
+            {"output", destino},
+            {"bloques", std::to_string(reporte.bloques)},
+            {"corridas", std::to_string(reporte.corridas)},
+            {"bloquesMovidos", std::to_string(reporte.bloquesMovidos)},
+            {"costoOriginal", formatFloat(static_cast<float>(reporte.costoOriginal))},
+            {"costoNuevo", formatFloat(static_cast<float>(reporte.costoNuevo))},
+            {"segundosAntes", formatFloat(static_cast<float>(reporte.segundosAntes))},
+            {"segundosDespues", formatFloat(static_cast<float>(reporte.segundosDespues))},
+            {"segundosAhorrados", formatFloat(static_cast<float>(reporte.segundosAhorrados()))}
+        });
+    }
+    if (method == "estimateJob") {
+        if (auto err = requireUser(0, session)) return buildFault(*err);
+        auto path = payload.value("path", std::string());
+        if (path.empty()) return buildFault("Ruta vacía");
+        // Cualquier sesión puede estimar: sin esto leería (y dejaría en la
+        // caché .gir) cualquier archivo del disco
+        const auto permitida = rutaTrabajoPermitida(path);
+        if (!permitida) return buildFault("path debe estar en una carpeta de trabajos");
+        path = *permitida;
+        auto programa = cacheGcode.obtener(path);
+        if (!programa) return buildFault("No se pudo leer " + path);
+
+        OpcionesEstimador opciones;
+        int perfil = payload.value("profile", static_cast<int>(opciones.perfil));
+        if (perfil < 0 || perfil > 2) return buildFault("Perfil de velocidad inválido");
+        opciones.perfil = static_cast<brazo::PerfilVelocidad>(perfil);
+        opciones.incluirHost = payload.value("host", opciones.incluirHost);
+        const size_t maxSegmentos = payload.value("maxSegments", static_cast<size_t>(1000));
+        auto estimacion = gcode::estimarDuracion(*programa, opciones, maxSegmentos > 0);
+
+        // [línea, inicio_s, duración_s, fuera_de_espacio] por instrucción
+        json segmentos = json::array();
+        for (size_t i = 0; i < estimacion.segmentos.size() && i < maxSegmentos; ++i) {
+            const auto& seg = estimacion.segmentos[i];
+            segmentos.push_back({seg.linea, std::round(seg.inicio * 1000.0) / 1000.0,
+                                 std::round(seg.duracion * 1000.0) / 1000.0, seg.fueraDeEspacio ? 1 : 0});
+        }
+        return buildStructResponse({
+            {"status", "ok"},
+            {"segundosTotales", formatFloat(static_cast<float>(estimacion.segundosTotales))},
+            {"segundosFirmware", formatFloat(static_cast<float>(estimacion.segundosFirmware))},
+            {"distanciaMm", formatFloat(static_cast<float>(estimacion.distanciaMm))},
+            {"instrucciones", std::to_string(estimacion.instrucciones)},
+            {"fueraDeEspacio", std::to_string(estimacion.fueraDeEspacio)},
+            {"segmentosTruncados", estimacion.segmentos.size() > maxSegmentos ? "SI" : "NO"},
+            {"segmentos", segmentos.dump()}
+        });
+    }
     if (method == "startLearning") {
         if (auto err = requireUser(1, session)) return buildFault(*err);
         auto file = payload.value("file", std::string());
-        aprendizaje.iniciar(file);
+        aprendizaje.iniciar(file, session.username);
         return ok("Aprendizaje iniciado");
     }
     if (method == "stopLearning") {
         if (auto err = requireUser(1, session)) return buildFault(*err);
-        aprendizaje.detener();
-        return ok("Aprendizaje detenido");
+        // La exportación (CSV + copias) sigue en segundo plano: ver getLearningExport
+        const uint64_t id = aprendizaje.detener();
+        if (id == 0) return ok("Aprendizaje detenido");
+        return buildStructResponse({
+            {"status", "ok"},
+            {"message", "Aprendizaje detenido, exportando"},
+            {"exportId", std::to_string(id)}
+        });
+    }
+    if (method == "getLearningExport") {
+        if (auto err = requireUser(1, session)) return buildFault(*err);
+        const EstadoExportacion ex = aprendizaje.estadoExportacion();
+        static const char* const kFases[] = {"ninguna", "en_curso", "lista", "fallida"};
+        return buildStructResponse({
+            {"status", "ok"},
+            {"exportId", std::to_string(ex.id)},
+            {"fase", kFases[ex.fase]},
+            {"origen", ex.origen},
+            {"csv", ex.csv},
+            {"gcode", ex.gcode},
+            {"jobs", ex.jobs},
+            {"teach", ex.teach},
+            {"metodoCopia", ex.metodoCopia},
+            {"lineas", std::to_string(ex.lineas)},
+            {"bytes", std::to_string(ex.bytes)},
+            {"milisegundos", formatFloat(static_cast<float>(ex.milisegundos))},
+            {"mensaje", ex.mensaje}
+        });
     }
     if (method == "emergencyStop") {
         if (auto err = requireUser(1, session)) return buildFault(*err);
@@ -0,0 +1,156 @@
+#include "telemetria.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+Telemetria telemetria; // definición de la instancia global
+
+namespace {
+constexpr size_t kCapacidadCrudas = 1u << 14;     // ~16 mil cambios
+constexpr size_t kCapacidadDecimas = 1u << 15;    // ~55 min a 100 ms
+constexpr size_t kCapacidadSegundos = 1u << 16;   // ~18 h a 1 s
+
+uint64_t empaquetar(float a, float b) {
+    uint32_t ia, ib;
+    std::memcpy(&ia, &a, sizeof(ia));
+    std::memcpy(&ib, &b, sizeof(ib));
+    return (static_cast<uint64_t>(ia) << 32) | ib;
+}
+
+void desempaquetar(uint64_t v, float& a, float& b) {
+    const uint32_t ia = static_cast<uint32_t>(v >> 32), ib = static_cast<uint32_t>(v);
+    std::memcpy(&a, &ia, sizeof(a));
+    std::memcpy(&b, &ib, sizeof(b));
+}
+}
+
+Telemetria::Anillo::Anillo(size_t capacidad)
+    : casillas(new Casilla[capacidad]), mascara(capacidad - 1) {}
+
+void Telemetria::Anillo::escribir(uint64_t indice, const MuestraTelemetria& m) {
+    Casilla& c = casillas[indice & mascara];
+    constexpr auto r = std::memory_order_relaxed;
+    const uint64_t s = c.secuencia.load(r);
+    c.secuencia.store(s + 1, r);
+    std::atomic_thread_fence(std::memory_order_release);
+    c.indice.store(indice, r);
+    c.ms.store(m.ms, r);
+    c.xy.store(empaquetar(m.x, m.y), r);
+    c.ze.store(empaquetar(m.z, m.e), r);
+    c.flags.store(m.flags, r);
+    c.secuencia.store(s + 2, std::memory_order_release);
+}
+
+void Telemetria::Anillo::agregar(const MuestraTelemetria& m) {
+    const uint64_t h = cabeza.load(std::memory_order_relaxed);
+    escribir(h, m);
+    cabeza.store(h + 1, std::memory_order_release);
+}
+
+void Telemetria::Anillo::reemplazarUltima(const MuestraTelemetria& m) {
+    const uint64_t h = cabeza.load(std::memory_order_relaxed);
+    if (h == 0) {
+        agregar(m);
+        return;
+    }
+    escribir(h - 1, m);
+}
+
+bool Telemetria::Anillo::leer(uint64_t indice, MuestraTelemetria& m) const {
+    const Casilla& c = casillas[indice & mascara];
+    constexpr auto r = std::memory_order_relaxed;
+    const uint64_t antes = c.secuencia.load(std::memory_order_acquire);
+    if (antes & 1u) return false;
+    const uint64_t idx = c.indice.load(r);
+    m.ms = c.ms.load(r);
+    desempaquetar(c.xy.load(r), m.x, m.y);
+    desempaquetar(c.ze.load(r), m.z, m.e);
+    m.flags = c.flags.load(r);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return c.secuencia.load(r) == antes && idx == indice;
+}
+
+void Telemetria::Anillo::rango(int64_t desdeMs, int64_t hastaMs, std::vector<MuestraTelemetria>& out) const {
+    const uint64_t h = cabeza.load(std::memory_order_acquire);
+    const uint64_t capacidad = mascara + 1;
+    // Se deja un margen por si el productor avanza mientras se lee
+    const uint64_t margen = std::min<uint64_t>(capacidad / 8, 64);
+    uint64_t lo = h > capacidad - margen ? h - (capacidad - margen) : 0;
+    uint64_t hi = h;
+
+    // Primera muestra con ms >= desdeMs (una casilla pisada cuenta como vieja)
+    while (lo < hi) {
+        const uint64_t mid = lo + (hi - lo) / 2;
+        MuestraTelemetria m;
+        if (!leer(mid, m) || m.ms < desdeMs) lo = mid + 1;
+        else hi = mid;
+    }
+    for (uint64_t i = lo; i < h; ++i) {
+        MuestraTelemetria m;
+        if (!leer(i, m)) continue;
+        if (m.ms > hastaMs) break;
+        if (m.ms >= desdeMs) out.push_back(m);
+    }
+}
+
+Telemetria::Telemetria()
+    : crudas(kCapacidadCrudas),
+      niveles{{100, Anillo(kCapacidadDecimas)}, {1000, Anillo(kCapacidadSegundos)}} {}
+
+int64_t Telemetria::ahoraMs() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+void Telemetria::registrar(const EstadoRobot::Snapshot& s) {
+    MuestraTelemetria m;
+    m.ms = ahoraMs();
+    m.x = s.x;
+    m.y = s.y;
+    m.z = s.z;
+    m.e = s.e;
+    m.flags = static_cast<uint8_t>((s.motores ? kFlagMotores : 0) | (s.garra ? kFlagGarra : 0) |
+                                   (s.modoAbs ? kFlagAbsoluto : 0) | (s.emergencia ? kFlagEmergencia : 0) |
+                                   (s.fueraDeEspacio ? kFlagFueraDeEspacio : 0));
+    registrar(m);
+}
+
+void Telemetria::registrar(const MuestraTelemetria& muestra) {
+    MuestraTelemetria m = muestra;
+    // La búsqueda binaria necesita tiempos no decrecientes aunque el reloj retroceda
+    m.ms = std::max(m.ms, ultimoMs);
+    ultimoMs = m.ms;
+
+    crudas.agregar(m);
+    for (Nivel& n : niveles) {
+        const int64_t intervalo = m.ms / n.periodoMs;
+        if (intervalo == n.intervalo) {
+            n.anillo.reemplazarUltima(m);
+        } else {
+            n.intervalo = intervalo;
+            n.anillo.agregar(m);
+        }
+    }
+}
+
+std::vector<MuestraTelemetria> Telemetria::historial(int64_t desdeMs, int64_t hastaMs, ResolucionTelemetria r,
+                                                     size_t maxPuntos) const {
+    std::vector<MuestraTelemetria> out;
+    if (hastaMs < desdeMs) return out;
+    switch (r) {
+        case ResolucionTelemetria::CRUDA: crudas.rango(desdeMs, hastaMs, out); break;
+        case ResolucionTelemetria::DECIMAS: niveles[0].anillo.rango(desdeMs, hastaMs, out); break;
+        case ResolucionTelemetria::SEGUNDOS: niveles[1].anillo.rango(desdeMs, hastaMs, out); break;
+    }
+    if (maxPuntos == 0 || out.size() <= maxPuntos) return out;
+
+    std::vector<MuestraTelemetria> diezmado;
+    diezmado.reserve(maxPuntos);
+    const double paso = static_cast<double>(out.size() - 1) / (maxPuntos > 1 ? maxPuntos - 1 : 1);
+    for (size_t k = 0; k < maxPuntos; ++k) {
+        diezmado.push_back(out[std::min(out.size() - 1, static_cast<size_t>(k * paso + 0.5))]);
+    }
+    diezmado.back() = out.back();
+    return diezmado;
+}
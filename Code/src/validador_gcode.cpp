@@ -0,0 +1,225 @@
+#include "validador_gcode.h"
+#include "lector_mapeado.h"
+#include "modelo_brazo.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+
+// definición de la instancia global
+PoolHilos poolValidacion;
+
+namespace {
+constexpr int kEjes = 4;
+constexpr CampoGcode kCampoEje[kEjes] = {CAMPO_X, CAMPO_Y, CAMPO_Z, CAMPO_E};
+constexpr size_t kNumTipos = static_cast<size_t>(TipoProblema::NUM_TIPOS);
+
+struct Bloque {
+    std::string_view texto;
+    uint32_t lineas = 0;
+    std::vector<InstruccionGcode> instrucciones;
+    PosicionModal inicio;           // estado al empezar el bloque (fase 2)
+    std::vector<ProblemaValidacion> problemas;
+    uint64_t porTipo[kNumTipos] = {};
+    uint64_t conProblemas = 0;
+    uint64_t movimientos = 0;
+    uint32_t ultimaLinea = 0;       // última línea contada en conProblemas
+    size_t maxDetalles = 0;
+
+    void anotar(uint32_t linea, TipoProblema tipo, std::string detalle) {
+        ++porTipo[static_cast<size_t>(tipo)];
+        if (linea != ultimaLinea) {
+            ++conProblemas;
+            ultimaLinea = linea;
+        }
+        if (problemas.size() < maxDetalles) problemas.push_back({linea, tipo, std::move(detalle)});
+    }
+};
+
+// Un arco llega (si es válido) al mismo destino que un G1 con sus ejes
+InstruccionGcode comoRecta(const InstruccionGcode& arco) {
+    InstruccionGcode g1 = arco;
+    g1.op = OpGcode::MOVER;
+    g1.numero = 1;
+    return g1;
+}
+
+void avanzar(PosicionModal& modal, const InstruccionGcode& ins) {
+    if (ins.esArco()) modal.avanzar(comoRecta(ins));
+    else modal.avanzar(ins);
+}
+
+std::string formatoPunto(const float p[kEjes]) {
+    char buf[96];
+    std::snprintf(buf, sizeof(buf), "(%.2f, %.2f, %.2f, E%.2f) fuera del espacio de trabajo", p[0], p[1], p[2], p[3]);
+    return buf;
+}
+
+void compilarBloque(Bloque& b) {
+    const std::string_view t = b.texto;
+    size_t pos = 0;
+    uint32_t numero = 0;
+    while (pos < t.size()) {
+        size_t fin = t.find('\n', pos);
+        if (fin == std::string_view::npos) fin = t.size();
+        ++numero;
+        InstruccionGcode ins;
+        if (gcode::compilarLinea(t.substr(pos, fin - pos), numero, ins)) {
+            if (ins.validez == ValidezGcode::SINTAXIS) {
+                b.anotar(numero, TipoProblema::SINTAXIS, gcode::describirValidez(ins.validez));
+            } else if (ins.validez == ValidezGcode::NO_SOPORTADA) {
+                b.anotar(numero, TipoProblema::NO_SOPORTADA,
+                         std::string(1, ins.letra) + std::to_string(ins.numero) + ": " + gcode::describirValidez(ins.validez));
+            }
+            b.instrucciones.push_back(ins);
+        }
+        pos = fin + 1;
+    }
+    b.lineas = numero;
+    b.ultimaLinea = 0;
+}
+
+void verificarBloque(Bloque& b, const OpcionesValidacion& opciones) {
+    PosicionModal modal = b.inicio;
+    std::vector<InstruccionGcode> segmentos;
+    for (const auto& ins : b.instrucciones) {
+        if (!ins.valida()) continue;
+        if (ins.op != OpGcode::MOVER && !ins.esArco()) {
+            modal.avanzar(ins);
+            continue;
+        }
+        ++b.movimientos;
+        if (ins.tiene(CAMPO_F)) {
+            const float f = ins.valor(CAMPO_F);
+            if (f < opciones.feedMinimo || f > opciones.feedMaximo) {
+                char buf[96];
+                std::snprintf(buf, sizeof(buf), "F%.1f fuera de [%.1f, %.1f]", f, opciones.feedMinimo, opciones.feedMaximo);
+                b.anotar(ins.linea, TipoProblema::AVANCE_FUERA_DE_RANGO, buf);
+            }
+        }
+
+        if (ins.esArco()) {
+            const ResultadoArco r = gcode::segmentarArco(ins, modal.pos, modal.offset, modal.relativo,
+                                                         opciones.arcos, segmentos);
+            if (r == ResultadoArco::FUERA_DE_ESPACIO) {
+                b.anotar(ins.linea, TipoProblema::FUERA_DE_ESPACIO, gcode::describirResultado(r));
+            } else if (r != ResultadoArco::OK) {
+                b.anotar(ins.linea, TipoProblema::ARCO_INVALIDO, gcode::describirResultado(r));
+            }
+            avanzar(modal, ins);
+            continue;
+        }
+
+        // Recta: el firmware la interpola y se detiene en el primer punto no permitido
+        const PosicionModal antes = modal;
+        modal.avanzar(ins);
+        double d[kEjes];
+        for (int e = 0; e < kEjes; ++e) d[e] = static_cast<double>(modal.pos[e]) - antes.pos[e];
+        const double distancia = std::max(std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]), std::fabs(d[3]));
+        const int muestras = std::max(1, static_cast<int>(std::ceil(distancia / opciones.muestreoMm)));
+        for (int k = 1; k <= muestras; ++k) {
+            const double p = static_cast<double>(k) / muestras;
+            float q[kEjes];
+            for (int e = 0; e < kEjes; ++e) q[e] = static_cast<float>(antes.pos[e] + p * d[e]);
+            if (!brazo::dentroDelEspacio(q[0], q[1], q[2], q[3])) {
+                b.anotar(ins.linea, TipoProblema::FUERA_DE_ESPACIO, formatoPunto(q));
+                break;
+            }
+        }
+    }
+}
+}
+
+namespace gcode {
+
+ReporteValidacion validar(std::string_view texto, const OpcionesValidacion& opciones) {
+    const auto inicio = std::chrono::steady_clock::now();
+    ReporteValidacion r;
+
+    // Bloques de ~bytesPorBloque cortados en un fin de línea
+    std::vector<Bloque> bloques;
+    const size_t tamBloque = std::max<size_t>(opciones.bytesPorBloque, 4096);
+    for (size_t pos = 0; pos < texto.size();) {
+        size_t fin = std::min(texto.size(), pos + tamBloque);
+        if (fin < texto.size()) {
+            const size_t nl = texto.find('\n', fin - 1);
+            fin = nl == std::string_view::npos ? texto.size() : nl + 1;
+        }
+        Bloque b;
+        b.texto = texto.substr(pos, fin - pos);
+        b.maxDetalles = opciones.maxProblemas;
+        bloques.push_back(std::move(b));
+        pos = fin;
+    }
+
+    // 1. Compilación
+    poolValidacion.paraCada(bloques.size(), [&](size_t i) { compilarBloque(bloques[i]); });
+
+    // 2. Numeración global y estado de arranque de cada bloque
+    PosicionModal modal;
+    uint32_t base = 0;
+    for (auto& b : bloques) {
+        b.inicio = modal;
+        for (auto& ins : b.instrucciones) {
+            ins.linea += base;
+            avanzar(modal, ins);
+        }
+        for (auto& p : b.problemas) p.linea += base;
+        base += b.lineas;
+        r.instrucciones += b.instrucciones.size();
+    }
+    r.lineas = base;
+
+    // 3. Alcance y avances
+    poolValidacion.paraCada(bloques.size(), [&](size_t i) { verificarBloque(bloques[i], opciones); });
+
+    uint64_t total = 0;
+    for (auto& b : bloques) {
+        r.movimientos += b.movimientos;
+        r.conProblemas += b.conProblemas;
+        for (size_t t = 0; t < kNumTipos; ++t) {
+            r.porTipo[t] += b.porTipo[t];
+            total += b.porTipo[t];
+        }
+        // Los de compilación y los de movimiento están en líneas distintas
+        std::stable_sort(b.problemas.begin(), b.problemas.end(),
+                         [](const ProblemaValidacion& a, const ProblemaValidacion& c) { return a.linea < c.linea; });
+        for (auto& p : b.problemas) {
+            if (r.problemas.size() >= opciones.maxProblemas) break;
+            r.problemas.push_back(std::move(p));
+        }
+    }
+    r.truncado = total > r.problemas.size();
+    r.bloques = bloques.size();
+    r.hilos = poolValidacion.tamano();
+    r.milisegundos = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - inicio).count();
+    return r;
+}
+
+bool validarArchivo(const std::string& ruta, const OpcionesValidacion& opciones, ReporteValidacion& reporte) {
+    std::error_code ec;
+    if (std::filesystem::file_size(ruta, ec) == 0 && !ec) {
+        reporte = validar(std::string_view(), opciones);
+        return true;
+    }
+    LectorMapeado lector(ruta);
+    if (!lector.abierto()) return false;
+    reporte = validar(lector.contenido(), opciones);
+    return true;
+}
+
+const char* describirProblema(TipoProblema t) {
+    switch (t) {
+        case TipoProblema::SINTAXIS: return "sintaxis";
+        case TipoProblema::NO_SOPORTADA: return "no_soportada";
+        case TipoProblema::FUERA_DE_ESPACIO: return "fuera_de_espacio";
+        case TipoProblema::ARCO_INVALIDO: return "arco_invalido";
+        case TipoProblema::AVANCE_FUERA_DE_RANGO: return "avance_fuera_de_rango";
+        case TipoProblema::NUM_TIPOS: break;
+    }
+    return "desconocido";
+}
+
+} // namespace gcode
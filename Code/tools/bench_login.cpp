@@ -0,0 +1,111 @@
+// Benchmark de logins por segundo con un costo PBKDF2 dado.
+//
+//   bin/bench_login [--iteraciones N] [--logins N] [--hilos N]
+//   bin/bench_login --autoprueba
+//
+// Reproduce lo que hace Login con cada intento: la verificación
+// PBKDF2-HMAC-SHA256 en un PoolHilos del tamaño del pool de autenticación,
+// con todos los logins encolados de golpe (cambio de turno). La consulta
+// a SQLite no se incluye: con el pool de conexiones son decenas de µs,
+// despreciables frente al hash. Informa logins/s, el tiempo de hash y la
+// latencia desde que se encola (espera + hash). Antes de medir compara
+// SHA-256 y PBKDF2 con los vectores conocidos; --autoprueba hace sólo eso
+// (código de salida 1 si alguno no coincide).
+
+#include "hash_clave.h"
+#include "histograma_latencia.h"
+#include "pool_hilos.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace {
+void uso() {
+    std::cerr << "uso: bench_login [--iteraciones N] [--logins N] [--hilos N] | --autoprueba\n";
+}
+
+void imprimir(const char* nombre, const ResumenLatencia& r) {
+    std::printf("%-10s p50 %8.2f ms  p90 %8.2f ms  p99 %8.2f ms  máx %8.2f ms\n", nombre, r.p50Us / 1000.0,
+                r.p90Us / 1000.0, r.p99Us / 1000.0, r.maxUs / 1000.0);
+}
+}
+
+int main(int argc, char* argv[]) {
+    unsigned long iteraciones = hash_clave::kIteracionesPorDefecto;
+    unsigned long logins = 200;
+    unsigned long hilos = std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u);
+    bool soloAutoprueba = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--autoprueba") == 0) {
+            soloAutoprueba = true;
+            continue;
+        }
+        unsigned long* destino = nullptr;
+        if (std::strcmp(argv[i], "--iteraciones") == 0) destino = &iteraciones;
+        else if (std::strcmp(argv[i], "--logins") == 0) destino = &logins;
+        else if (std::strcmp(argv[i], "--hilos") == 0) destino = &hilos;
+        if (!destino || i + 1 >= argc || (*destino = std::strtoul(argv[++i], nullptr, 10)) == 0) {
+            uso();
+            return 2;
+        }
+    }
+    std::string fallo;
+    if (!hash_clave::autoprueba(&fallo)) {
+        std::fprintf(stderr, "autoprueba: %s no coincide con el vector conocido\n", fallo.c_str());
+        return 1;
+    }
+    if (soloAutoprueba) {
+        std::printf("autoprueba: SHA-256 (FIPS 180-4) y PBKDF2-HMAC-SHA256 (RFC 7914) correctos\n");
+        return 0;
+    }
+    iteraciones = std::clamp<unsigned long>(iteraciones, hash_clave::kIteracionesMin, hash_clave::kIteracionesMax);
+
+    const std::string clave = "ADMIN";
+    const std::string almacenado = hash_clave::derivar(clave, static_cast<uint32_t>(iteraciones));
+
+    PoolHilos pool(static_cast<unsigned>(hilos));
+    HistogramaLatencia hash, total;
+    std::atomic<unsigned long> hechos{0}, incorrectos{0};
+    std::mutex mtx;
+    std::condition_variable cv;
+
+    const auto inicio = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < logins; ++i) {
+        const auto encolado = std::chrono::steady_clock::now();
+        pool.encolar([&, encolado] {
+            const auto t0 = std::chrono::steady_clock::now();
+            if (!hash_clave::verificar(clave, almacenado)) incorrectos.fetch_add(1);
+            const auto t1 = std::chrono::steady_clock::now();
+            hash.registrar(std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count());
+            total.registrar(std::chrono::duration_cast<std::chrono::microseconds>(t1 - encolado).count());
+            if (hechos.fetch_add(1) + 1 == logins) {
+                std::lock_guard<std::mutex> l(mtx);
+                cv.notify_one();
+            }
+        });
+    }
+    {
+        std::unique_lock<std::mutex> l(mtx);
+        cv.wait(l, [&] { return hechos.load() == logins; });
+    }
+    const double segundos = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+
+    std::printf("%lu logins, %lu iteraciones, %lu hilos: %.1f s, %.1f logins/s\n", logins, iteraciones, hilos, segundos,
+                logins / segundos);
+    imprimir("hash", hash.resumen());
+    imprimir("encolado", total.resumen());
+    if (incorrectos.load()) {
+        std::printf("⚠️ %lu verificaciones fallaron\n", incorrectos.load());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,86 @@
+// Decodificador de los segmentos binarios de log (logs/server_log*.blog[.gz]).
+//
+//   bin/decodificar_log [--json] [--desde AAAA-MM-DDTHH:MM:SS] [--hasta ...] [archivos...]
+//
+// Sin archivos recorre logs/server_log-*.blog[.gz] en orden y al final el
+// segmento activo. Escribe CSV (mismas columnas que el server_log.csv de
+// antes) o una línea JSON por registro en la salida estándar.
+
+#include "registro_log.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+bool leerFecha(const char* texto, int64_t& ms) {
+    std::tm tm{};
+    if (!strptime(texto, "%Y-%m-%dT%H:%M:%S", &tm)) return false;
+    tm.tm_isdst = -1;
+    ms = static_cast<int64_t>(std::mktime(&tm)) * 1000;
+    return true;
+}
+
+void uso() {
+    std::cerr << "uso: decodificar_log [--json] [--desde AAAA-MM-DDTHH:MM:SS] [--hasta ...] [archivos...]\n";
+}
+}
+
+int main(int argc, char* argv[]) {
+    bool json = false;
+    int64_t desde = INT64_MIN, hasta = INT64_MAX;
+    std::vector<std::string> archivos;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if ((std::strcmp(argv[i], "--desde") == 0 || std::strcmp(argv[i], "--hasta") == 0) && i + 1 < argc) {
+            int64_t& destino = argv[i][2] == 'd' ? desde : hasta;
+            if (!leerFecha(argv[++i], destino)) {
+                uso();
+                return 2;
+            }
+        } else if (argv[i][0] == '-') {
+            uso();
+            return 2;
+        } else {
+            archivos.emplace_back(argv[i]);
+        }
+    }
+
+    if (archivos.empty()) {
+        std::error_code ec;
+        for (const auto& e : fs::directory_iterator("logs", ec)) {
+            const std::string nombre = e.path().filename().string();
+            if (nombre.rfind("server_log-", 0) == 0 &&
+                (e.path().extension() == ".blog" || (nombre.size() > 8 && nombre.compare(nombre.size() - 8, 8, ".blog.gz") == 0))) {
+                archivos.push_back(e.path().string());
+            }
+        }
+        // El nombre lleva la fecha de inicio del segmento: orden alfabético = cronológico
+        std::sort(archivos.begin(), archivos.end());
+        if (fs::exists("logs/server_log.blog", ec)) archivos.emplace_back("logs/server_log.blog");
+    }
+
+    if (!json) std::fputs(registro_log::cabeceraCsv().c_str(), stdout);
+    int errores = 0;
+    for (const auto& ruta : archivos) {
+        const bool ok = registro_log::leerSegmento(ruta, [&](const RegistroLog& r) {
+            if (r.ms < desde || r.ms > hasta) return true;
+            const std::string fila = json ? registro_log::aJson(r) + "\n" : registro_log::aCsv(r);
+            std::fwrite(fila.data(), 1, fila.size(), stdout);
+            return true;
+        });
+        if (!ok) {
+            std::cerr << "⚠️ " << ruta << ": no es un segmento de log\n";
+            ++errores;
+        }
+    }
+    return errores ? 1 : 0;
+}